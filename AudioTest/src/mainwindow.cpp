@@ -1,15 +1,20 @@
 #include "mainwindow.h"
+#include "audioresampler.h"
+#include "mediapipeline.h"
+#include "pcmdsp.h"
+#include "tracing.h"
 
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libswresample/swresample.h>
 }
 
 #include <QApplication>
 #include <QAudioOutput>
+#include <QDateTime>
 #include <QDropEvent>
+#include <QFileInfo>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QLabel>
@@ -17,6 +22,7 @@ extern "C"
 #include <QPushButton>
 #include <QPainter>
 #include <QScreen>
+#include <QShortcut>
 #include <QSlider>
 #include <QTimer>
 #include <QDebug>
@@ -24,7 +30,7 @@ extern "C"
 AudioDecoder::AudioDecoder(QObject *parent)
     : QThread (parent)
 {
-
+    m_frameQueue.monitor().setMetricsName("audio.frames");
 }
 
 AudioDecoder::~AudioDecoder()
@@ -71,58 +77,39 @@ QByteArray AudioDecoder::currentFrame()
 
 void AudioDecoder::run()
 {
+    TRACE_THREAD_NAME("AudioDecoder");
     demuxing_decoding();
 }
 
 void AudioDecoder::demuxing_decoding()
 {
-    AVFormatContext *formatContext = nullptr;
-    AVCodecContext *codecContext = nullptr;
-    AVCodec *audioDecoder = nullptr;
+    MediaSource source;
+    StreamDecoder decoder;
+    AudioResampler resampler;
+    MediaPipeline pipeline;
     AVStream *audioStream = nullptr;
     int audioIndex = -1;
 
     //打开输入文件，并分配格式上下文
-    avformat_open_input(&formatContext, m_filename.toStdString().c_str(), nullptr, nullptr);
-    avformat_find_stream_info(formatContext, nullptr);
-
-    //找到音频流的索引
-    audioIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-
-    if (audioIndex < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    audioStream = formatContext->streams[audioIndex];
+    decoder.setMetricsName("audio.decoder");
 
-    if (!audioStream) {
+    if (!source.open(m_filename.toStdString())) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    audioDecoder = avcodec_find_decoder(audioStream->codecpar->codec_id);
 
-    if (!audioDecoder) {
+    //找到音频流的索引，并打开解码器
+    audioIndex = source.findStream(AVMEDIA_TYPE_AUDIO);
+    audioStream = source.stream(audioIndex);
+    if (!decoder.open(audioStream)) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    codecContext = avcodec_alloc_context3(audioDecoder);
-
-    if (!codecContext) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-   avcodec_parameters_to_context(codecContext, audioStream->codecpar);
-
-    if (!codecContext) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    avcodec_open2(codecContext, audioDecoder, nullptr);
 
     //打印相关信息
-    av_dump_format(formatContext, 0, "format", 0);
-    fflush(stderr);
+    source.dump();
 
+    AVCodecContext *codecContext = decoder.context();
     QAudioFormat format;
     format.setCodec("audio/pcm");
     format.setSampleRate(codecContext->sample_rate);
@@ -131,58 +118,31 @@ void AudioDecoder::demuxing_decoding()
     format.setChannelCount(codecContext->channels);
     m_format = format;
 
-    m_duration = audioStream->duration * av_q2d(audioStream->time_base);
+    //流没有时长时使用容器的时长
+    m_duration = audioStream->duration != AV_NOPTS_VALUE ? audioStream->duration * av_q2d(audioStream->time_base) : source.duration();
 
     emit resolved();
 
-    SwrContext *swrContext = swr_alloc_set_opts(nullptr, int64_t(codecContext->channel_layout), AV_SAMPLE_FMT_S32, codecContext->sample_rate,
-                                    int64_t(codecContext->channel_layout), codecContext->sample_fmt, codecContext->sample_rate,
-                                    0, nullptr);
-    swr_init(swrContext);
-
-    //分配并初始化一个临时的帧和包
-    AVPacket *packet = av_packet_alloc();
-    AVFrame *frame = av_frame_alloc();
-    packet->data = nullptr;
-    packet->size = 0;
+    //每帧单独重采样为交错的S32并入队
+    pipeline.addDecoder(&decoder);
+    pipeline.addStage(audioIndex, [&](AVFrame *frame) {
+        int size = AudioResampler::bufferSize(frame, AV_SAMPLE_FMT_S32);
+        if (size <= 0) return false;
 
-    //读取下一帧
-    while (m_runnable && av_read_frame(formatContext, packet) >= 0) {
-        if (packet->stream_index == audioIndex) {
-            //发送给解码器
-            int ret = avcodec_send_packet(codecContext, packet);
+        QByteArray data(size, Qt::Uninitialized);
+        int samples = resampler.convert(frame, AV_SAMPLE_FMT_S32, reinterpret_cast<uint8_t *>(data.data()), frame->nb_samples);
+        if (samples <= 0) return false;
+        data.resize(samples * frame->channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S32));
 
-            QByteArray data;
-            while (ret >= 0) {
-                //从解码器接收解码后的帧
-                ret = avcodec_receive_frame(codecContext, frame);
+        qreal time = (frame->pts + frame->pkt_duration) * av_q2d(audioStream->time_base);
+        m_currentTime = time;
 
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                else if (ret < 0) return;
-
-                int size = av_samples_get_buffer_size(nullptr, frame->channels, frame->nb_samples, AV_SAMPLE_FMT_S32, 0);
-                uint8_t *buf = new uint8_t[size];
-                swr_convert(swrContext, &buf, frame->nb_samples, const_cast<const uint8_t**>(frame->data), frame->nb_samples);
-                data += QByteArray((const char *)buf, size);
-                delete[] buf;
-
-                qreal time = frame->pts * av_q2d(audioStream->time_base) + frame->pkt_duration * av_q2d(audioStream->time_base);
-                m_currentTime = time;
-
-                m_frameQueue.enqueue({ data, time });
-
-                av_frame_unref(frame);
-            }
-        }
-
-        av_packet_unref(packet);
-    }
+        m_frameQueue.enqueue({ data, time });
+        return true;
+    });
 
-    if (frame) av_frame_free(&frame);
-    if (packet) av_packet_free(&packet);
-    if (swrContext) swr_free(&swrContext);
-    if (codecContext) avcodec_free_context(&codecContext);
-    if (formatContext) avformat_close_input(&formatContext);
+    if (pipeline.run(source, m_runnable) < 0)
+        qDebug() << "Has Error: line =" << __LINE__;
 }
 
 MainWindow::MainWindow(QWidget *parent)
@@ -192,6 +152,16 @@ MainWindow::MainWindow(QWidget *parent)
     setGeometry(size.width(), size.height(), 600, 380);
     setAcceptDrops(true);
 
+#ifdef ENABLE_TRACING
+    //F12 导出追踪数据(Chrome trace JSON)，拖进 Perfetto 查看
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        QString filename = QDateTime::currentDateTime().toString("'trace_'yyyyMMdd_hhmmss'.json'");
+        qDebug() << "[Trace:" << filename << (Tracing::dump(filename.toStdString()) ? "]" : "failed]");
+    });
+#endif
+    TRACE_THREAD_NAME("GUI");
+
     QWidget *widget = new QWidget(this);
     widget->setFixedHeight(40);
     QHBoxLayout *layout = new QHBoxLayout;
@@ -205,7 +175,8 @@ MainWindow::MainWindow(QWidget *parent)
     volumeLabel->setFixedHeight(30);
     connect(m_volume, &QSlider::valueChanged, this, [volumeLabel, this](int value) {
         volumeLabel->setText(QString("当前音量: %1 / 100").arg(value));
-        if (m_output) m_output->setVolume(qreal(value) / m_volume->maximum());
+        //使用软件增益代替QAudioOutput::setVolume
+        m_gain = float(value) / m_volume->maximum();
     });
     m_suspendButton = new QPushButton("暂停");
     m_resumeButton = new QPushButton("继续");
@@ -238,7 +209,12 @@ MainWindow::MainWindow(QWidget *parent)
                 int len = pcm.size();
                 m_currentFrame.remove(0, len);
 
-                if (len) m_device->write(pcm);
+                if (len) {
+                    //解码输出的格式固定为S32
+                    mix_tracks(pcm);
+                    PcmDsp::applyGain(reinterpret_cast<int32_t *>(pcm.data()), len / int(sizeof(int32_t)), m_gain);
+                    m_device->write(pcm);
+                }
                 if (len != readSize) break;
             }
         }
@@ -249,24 +225,141 @@ MainWindow::MainWindow(QWidget *parent)
         centralWidget()->show();
         if (m_output) m_output->deleteLater();
         m_output = new QAudioOutput(m_decoder->format());
-        m_volume->setValue(int(qreal(m_volume->maximum()) * m_output->volume()));
+        m_volume->setValue(int(m_gain * m_volume->maximum()));
         m_device = m_output->start();
         m_timer->start(10);
     });
     connect(m_decoder, &AudioDecoder::finish, this, [this]() {
         centralWidget()->hide();
     });
+
+    m_peakBuilder = new PeakIndexBuilder(this);
+    connect(m_peakBuilder, &PeakIndexBuilder::built, this, [this](const QString &peakFile) {
+        if (m_peaks.open(peakFile)) update();
+    });
 }
 
 MainWindow::~MainWindow()
 {
+    m_peakBuilder->stop();
+    open_mix_tracks(QStringList());
+}
 
+void MainWindow::open_mix_tracks(const QStringList &filenames)
+{
+    for (MixTrack &track : m_mixTracks) {
+        track.decoder->stop();
+        delete track.decoder;
+    }
+    m_mixTracks.clear();
+
+    for (const QString &filename : filenames) {
+        AudioDecoder *decoder = new AudioDecoder;
+        m_mixTracks.push_back(MixTrack { decoder, QAudioFormat(), QByteArray(), 0 });
+        connect(decoder, &AudioDecoder::resolved, this, [this, decoder]() {
+            for (MixTrack &track : m_mixTracks) {
+                if (track.decoder == decoder) track.format = decoder->format();
+            }
+        });
+        decoder->open(filename);
+    }
+}
+
+void MainWindow::mix_tracks(QByteArray &pcm)
+{
+    for (MixTrack &track : m_mixTracks) {
+        if (!m_output) continue;
+        //resolved 是排队送达的，格式到达之前队列里可能已经有帧，不能按主音频的格式混入
+        //这段时间照常累计缺的字节数，格式相同时从对应的采样位置开始混入；采样率、声道不同的文件不混入
+        if (!track.format.isValid()) {
+            track.skip += pcm.size();
+            continue;
+        }
+        if (track.format != m_output->format()) continue;
+
+        while (track.pending.size() < pcm.size()) {
+            QByteArray frame = track.decoder->currentFrame();
+            if (frame.isEmpty()) break;
+            track.pending += frame;
+            //按采样位置对齐：之前缺的那一段到达时丢弃
+            int drop = int(qMin<qint64>(track.skip, track.pending.size()));
+            track.pending.remove(0, drop);
+            track.skip -= drop;
+        }
+
+        int bytes = qMin(pcm.size(), track.pending.size());
+        PcmDsp::mix(reinterpret_cast<int32_t *>(pcm.data()), reinterpret_cast<const int32_t *>(track.pending.constData()),
+                    bytes / int(sizeof(int32_t)));
+        track.pending.remove(0, bytes);
+        track.skip += pcm.size() - bytes;
+    }
+}
+
+void MainWindow::load_peaks(const QString &filename)
+{
+    m_peaks.close();
+    update();
+
+    //峰值文件与音频文件放在一起，比音频文件旧则重新生成
+    QString peakFile = filename + ".peak";
+    QFileInfo peakInfo(peakFile);
+    if (peakInfo.exists() && peakInfo.lastModified() >= QFileInfo(filename).lastModified() && m_peaks.open(peakFile))
+        return;
+
+    m_peakBuilder->build(filename, peakFile);
+}
+
+void MainWindow::draw_waveform(QPainter *painter, const QRect &rect)
+{
+    int channels = m_peaks.channels();
+    int pixels = rect.width();
+    if (pixels <= 0 || m_peaks.frames() <= 0) return;
+
+    qreal framesPerPixel = qreal(m_peaks.frames()) / pixels;
+    int level = m_peaks.levelFor(qint64(framesPerPixel));
+    qint64 blocks = 0;
+    const PeakEntry *peaks = m_peaks.level(level, &blocks);
+    qreal blocksPerPixel = framesPerPixel / m_peaks.blockFrames(level);
+    qreal laneHeight = qreal(rect.height()) / channels;
+
+    for (int c = 0; c < channels; c++) {
+        qreal center = rect.top() + laneHeight * (c + 0.5);
+        qreal scale = laneHeight / 2 / 32768.0;
+
+        for (int x = 0; x < pixels; x++) {
+            //每个像素至少取一个块，块比像素宽时相邻像素会取到同一个块
+            qint64 begin = qMin(qint64(x * blocksPerPixel), blocks - 1);
+            qint64 end = qMax(begin + 1, qMin(qint64((x + 1) * blocksPerPixel), blocks));
+
+            int min = 32767, max = -32768, rms = 0;
+            for (qint64 b = begin; b < end; b++) {
+                const PeakEntry &entry = peaks[b * channels + c];
+                min = qMin(min, int(entry.min));
+                max = qMax(max, int(entry.max));
+                rms = qMax(rms, int(entry.rms));
+            }
+
+            int px = rect.left() + x;
+            painter->setPen(QColor(80, 140, 220));
+            painter->drawLine(QPointF(px, center - max * scale), QPointF(px, center - min * scale));
+            qreal r = rms / 65535.0 * laneHeight / 2;
+            painter->setPen(QColor(30, 70, 150));
+            painter->drawLine(QPointF(px, center - r), QPointF(px, center + r));
+        }
+    }
 }
 
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
+    TRACE_SCOPE("paint");
     QPainter painter(this);
+    if (m_peaks.isOpen()) {
+        //顶部留给控制栏
+        draw_waveform(&painter, rect().adjusted(0, 40, 0, 0));
+        return;
+    }
+
     QString text("<请拖入音频或视频>");
     QFont f = font();
     f.setPointSize(20);
@@ -288,6 +381,12 @@ void MainWindow::dropEvent(QDropEvent *event)
     if(mimeData->hasUrls()) {
         QList<QUrl> urlList = mimeData->urls();
         m_decoder->open(urlList[0].toLocalFile());
+        load_peaks(urlList[0].toLocalFile());
+
+        //一次拖入多个文件时，其余的文件混入第一个文件的输出
+        QStringList mixFiles;
+        for (int i = 1; i < urlList.size(); i++) mixFiles.append(urlList[i].toLocalFile());
+        open_mix_tracks(mixFiles);
     }
 }
 
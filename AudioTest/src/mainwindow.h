@@ -1,7 +1,8 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include "bufferqueue.h"
+#include "meteredqueue.h"
+#include "peakindex.h"
 
 #include <QAudioFormat>
 #include <QMainWindow>
@@ -9,6 +10,9 @@
 #include <QQueue>
 #include <QThread>
 
+#include <atomic>
+#include <vector>
+
 struct Packet
 {
     QByteArray data;
@@ -42,13 +46,14 @@ private:
 
     qreal m_duration = 0.0;
     qreal m_currentTime = 0.0;
-    bool m_runnable = true;
+    std::atomic_bool m_runnable { true };
     QAudioFormat m_format;
     QMutex m_mutex;
     QString m_filename;
-    BufferQueue<Packet> m_frameQueue;
+    MeteredBufferQueue<Packet> m_frameQueue;
 };
 
+class QPainter;
 class QSlider;
 class QAudioOutput;
 class QPushButton;
@@ -69,14 +74,33 @@ protected:
     void dropEvent(QDropEvent *event) override;
 
 private:
+    //同时拖入的其他文件，与主音频对齐后混入输出
+    struct MixTrack
+    {
+        AudioDecoder *decoder;
+        QAudioFormat format;
+        QByteArray pending;
+        //解码跟不上时已经错过的字节数，到达后丢弃
+        qint64 skip;
+    };
+
+    void open_mix_tracks(const QStringList &filenames);
+    void mix_tracks(QByteArray &pcm);
+    void load_peaks(const QString &filename);
+    void draw_waveform(QPainter *painter, const QRect &rect);
+
     QTimer *m_timer = nullptr;
     QByteArray m_currentFrame = QByteArray();
     QAudioOutput *m_output = nullptr;
     QIODevice *m_device = nullptr;
     AudioDecoder *m_decoder = nullptr;
+    std::vector<MixTrack> m_mixTracks;
     QSlider *m_volume;
+    float m_gain = 1.0f;
     QPushButton *m_suspendButton = nullptr;
     QPushButton *m_resumeButton = nullptr;
+    PeakIndex m_peaks;
+    PeakIndexBuilder *m_peakBuilder = nullptr;
 };
 
 #endif // MAINWINDOW_H
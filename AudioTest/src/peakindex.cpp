@@ -0,0 +1,345 @@
+#include "peakindex.h"
+#include "audioresampler.h"
+#include "mediapipeline.h"
+#include "mpmcqueue.h"
+#include "tracing.h"
+
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint32_t PEAK_VERSION = 1;
+//最底层每块的帧数
+const int BASE_FRAMES = 256;
+//分发给分析线程的单位，必须是 BASE_FRAMES 的整数倍，保证块边界对齐
+const int CHUNK_FRAMES = BASE_FRAMES * 256;
+
+struct PeakChunk
+{
+    qint64 index;
+    int frames;
+    std::vector<float> samples;
+    std::vector<PeakEntry> peaks;
+};
+
+PeakEntry make_entry(float min, float max, double sumSquares, int frames)
+{
+    PeakEntry entry;
+    entry.min = int16_t(std::lrint(std::max(-1.0f, std::min(1.0f, min)) * 32767.0f));
+    entry.max = int16_t(std::lrint(std::max(-1.0f, std::min(1.0f, max)) * 32767.0f));
+    double rms = frames > 0 ? std::sqrt(sumSquares / frames) : 0.0;
+    entry.rms = uint16_t(std::lrint(std::min(1.0, rms) * 65535.0));
+
+    return entry;
+}
+
+//计算一个块的最底层峰值，samples 为交错的 float
+void analyze_chunk(PeakChunk *chunk, int channels)
+{
+    int blocks = (chunk->frames + BASE_FRAMES - 1) / BASE_FRAMES;
+    chunk->peaks.resize(size_t(blocks) * channels);
+
+    for (int b = 0; b < blocks; b++) {
+        int begin = b * BASE_FRAMES;
+        int end = std::min(begin + BASE_FRAMES, chunk->frames);
+
+        for (int c = 0; c < channels; c++) {
+            const float *p = chunk->samples.data() + size_t(begin) * channels + c;
+            float min = *p, max = *p;
+            double sumSquares = 0.0;
+            for (int i = begin; i < end; i++, p += channels) {
+                min = std::min(min, *p);
+                max = std::max(max, *p);
+                sumSquares += double(*p) * *p;
+            }
+            chunk->peaks[size_t(b) * channels + c] = make_entry(min, max, sumSquares, end - begin);
+        }
+    }
+
+    //采样数据不再需要，只保留峰值
+    std::vector<float>().swap(chunk->samples);
+}
+
+//由上一层两两合并出下一层，RMS 按各自覆盖的帧数加权
+std::vector<PeakEntry> merge_level(const std::vector<PeakEntry> &prev, qint64 prevBlocks, qint64 prevBlockFrames,
+                                   qint64 totalFrames, int channels)
+{
+    qint64 blocks = (prevBlocks + 1) / 2;
+    std::vector<PeakEntry> level(size_t(blocks) * channels);
+
+    auto framesOf = [&](qint64 block) {
+        return std::min(prevBlockFrames, totalFrames - block * prevBlockFrames);
+    };
+
+    for (qint64 i = 0; i < blocks; i++) {
+        qint64 a = 2 * i, b = 2 * i + 1;
+        for (int c = 0; c < channels; c++) {
+            PeakEntry entry = prev[size_t(a) * channels + c];
+            if (b < prevBlocks) {
+                const PeakEntry &other = prev[size_t(b) * channels + c];
+                double na = double(framesOf(a)), nb = double(framesOf(b));
+                double ra = entry.rms / 65535.0, rb = other.rms / 65535.0;
+                entry.min = std::min(entry.min, other.min);
+                entry.max = std::max(entry.max, other.max);
+                entry.rms = uint16_t(std::lrint(std::sqrt((ra * ra * na + rb * rb * nb) / (na + nb)) * 65535.0));
+            }
+            level[size_t(i) * channels + c] = entry;
+        }
+    }
+
+    return level;
+}
+
+} //namespace
+
+bool PeakIndex::open(const QString &filename)
+{
+    close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QFile::ReadOnly) || m_file.size() < qint64(sizeof(PeakFileHeader))) {
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_file.size());
+    const PeakFileHeader *header = reinterpret_cast<const PeakFileHeader *>(m_data);
+    if (!m_data || std::memcmp(header->magic, "PEAK", 4) != 0 || header->version != PEAK_VERSION ||
+            header->levelCount == 0 || header->levelCount > PeakFileHeader::MaxLevels || header->channels == 0) {
+        qDebug() << "Invalid peak file:" << filename;
+        close();
+        return false;
+    }
+
+    //检查每一层都在文件范围内
+    for (uint32_t l = 0; l < header->levelCount; l++) {
+        uint64_t end = header->levelOffsets[l] + header->levelBlocks[l] * header->channels * sizeof(PeakEntry);
+        if (end > uint64_t(m_file.size())) {
+            qDebug() << "Invalid peak file:" << filename;
+            close();
+            return false;
+        }
+    }
+    m_header = header;
+
+    return true;
+}
+
+void PeakIndex::close()
+{
+    if (m_data) m_file.unmap(m_data);
+    m_data = nullptr;
+    m_header = nullptr;
+    m_file.close();
+}
+
+int PeakIndex::levelFor(qint64 framesPerPixel) const
+{
+    int level = 0;
+    while (level + 1 < levelCount() && blockFrames(level + 1) <= framesPerPixel) level++;
+
+    return level;
+}
+
+const PeakEntry *PeakIndex::level(int level, qint64 *blocks) const
+{
+    if (blocks) *blocks = qint64(m_header->levelBlocks[level]);
+    return reinterpret_cast<const PeakEntry *>(m_data + m_header->levelOffsets[level]);
+}
+
+PeakIndexBuilder::PeakIndexBuilder(QObject *parent)
+    : QThread (parent)
+{
+
+}
+
+PeakIndexBuilder::~PeakIndexBuilder()
+{
+    stop();
+}
+
+void PeakIndexBuilder::build(const QString &audioFile, const QString &peakFile)
+{
+    stop();
+
+    m_audioFile = audioFile;
+    m_peakFile = peakFile;
+    m_runnable = true;
+
+    start();
+}
+
+void PeakIndexBuilder::stop()
+{
+    m_runnable = false;
+    wait();
+}
+
+void PeakIndexBuilder::run()
+{
+    TRACE_THREAD_NAME("PeakIndex");
+    if (analyze()) emit built(m_peakFile);
+}
+
+bool PeakIndexBuilder::analyze()
+{
+    //FFmpeg 资源在任何一条返回路径上都会释放
+    MediaSource source;
+    StreamDecoder decoder;
+    AudioResampler resampler;
+    MediaPipeline pipeline;
+    AVCodecContext *codecContext = nullptr;
+    int audioIndex = -1, channels = 0;
+    bool success = false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::unique_ptr<PeakChunk>> chunks;
+    //所有分析线程共用一个队列(一个生产者、多个消费者)，空闲的线程先取，慢的线程不会挡住分发
+    const int workerCount = std::max(1, QThread::idealThreadCount() - 1);
+    MpmcQueue<PeakChunk *> queue(workerCount * 4);
+    std::vector<std::thread> workers;
+    std::unique_ptr<PeakChunk> current;
+    qint64 totalFrames = 0;
+
+    //切好的块交给任意一个空闲的分析线程
+    auto dispatch = [&]() {
+        if (!current || current->frames == 0) return;
+        PeakChunk *chunk = current.get();
+        chunks.push_back(std::move(current));
+        queue.enqueue(chunk);
+    };
+
+    auto append = [&](const float *samples, int frames) {
+        while (frames > 0) {
+            if (!current) {
+                current.reset(new PeakChunk);
+                current->index = qint64(chunks.size());
+                current->frames = 0;
+                current->samples.resize(size_t(CHUNK_FRAMES) * channels);
+            }
+            int n = std::min(frames, CHUNK_FRAMES - current->frames);
+            std::memcpy(current->samples.data() + size_t(current->frames) * channels, samples, sizeof(float) * size_t(n) * channels);
+            current->frames += n;
+            samples += size_t(n) * channels;
+            frames -= n;
+            totalFrames += n;
+            if (current->frames == CHUNK_FRAMES) dispatch();
+        }
+    };
+
+    //打开输入文件，并分配格式上下文
+    if (!source.open(m_audioFile.toStdString())) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return false;
+    }
+
+    //只需要音频流，其余的流由流水线在解封装层丢弃
+    audioIndex = source.findStream(AVMEDIA_TYPE_AUDIO);
+    if (audioIndex < 0 || !decoder.open(source.stream(audioIndex))) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return false;
+    }
+    codecContext = decoder.context();
+    channels = codecContext->channels;
+    if (channels <= 0) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return false;
+    }
+
+    //分析使用交错的 float，便于计算 RMS；块按固定声道数排列，中途声道数变化的帧跳过
+    std::vector<float> buffer;
+    pipeline.addDecoder(&decoder);
+    pipeline.addStage(audioIndex, [&](AVFrame *frame) {
+        if (frame->channels != channels) return false;
+
+        buffer.resize(size_t(frame->nb_samples) * channels);
+        int samples = resampler.convert(frame, AV_SAMPLE_FMT_FLT, reinterpret_cast<uint8_t *>(buffer.data()), frame->nb_samples);
+        if (samples > 0) append(buffer.data(), samples);
+        return true;
+    });
+
+    //解码线程本身占一个核
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back([&queue, channels]() {
+            TRACE_THREAD_NAME("PeakWorker");
+            //nullptr 为结束标记，每个线程取走一个
+            while (PeakChunk *chunk = queue.dequeue()) {
+                TRACE_SCOPE("analyze_chunk");
+                analyze_chunk(chunk, channels);
+            }
+        });
+    }
+
+    if (pipeline.run(source, m_runnable) < 0)
+        qDebug() << "Has Error: line =" << __LINE__;
+    dispatch();
+
+    for (int i = 0; i < int(workers.size()); i++) queue.enqueue(nullptr);
+    for (std::thread &worker : workers) worker.join();
+    workers.clear();
+
+    if (m_runnable && totalFrames > 0) {
+        PeakFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "PEAK", 4);
+        header.version = PEAK_VERSION;
+        header.sampleRate = uint32_t(codecContext->sample_rate);
+        header.channels = uint32_t(channels);
+        header.baseFrames = BASE_FRAMES;
+        header.frames = uint64_t(totalFrames);
+
+        //拼接最底层，再逐层合并直到只剩一个块
+        std::vector<std::vector<PeakEntry>> levels(1);
+        for (const auto &chunk : chunks)
+            levels[0].insert(levels[0].end(), chunk->peaks.begin(), chunk->peaks.end());
+        chunks.clear();
+
+        qint64 blocks = qint64(levels[0].size()) / channels;
+        qint64 blockFrames = BASE_FRAMES;
+        header.levelBlocks[0] = uint64_t(blocks);
+        while (blocks > 1 && levels.size() < PeakFileHeader::MaxLevels) {
+            levels.push_back(merge_level(levels.back(), blocks, blockFrames, totalFrames, channels));
+            blocks = (blocks + 1) / 2;
+            blockFrames *= 2;
+            header.levelBlocks[levels.size() - 1] = uint64_t(blocks);
+        }
+        header.levelCount = uint32_t(levels.size());
+
+        uint64_t offset = sizeof(PeakFileHeader);
+        for (size_t l = 0; l < levels.size(); l++) {
+            header.levelOffsets[l] = offset;
+            offset += levels[l].size() * sizeof(PeakEntry);
+        }
+
+        QFile file(m_peakFile);
+        if (file.open(QFile::WriteOnly | QFile::Truncate)) {
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            for (const auto &level : levels)
+                file.write(reinterpret_cast<const char *>(level.data()), qint64(level.size() * sizeof(PeakEntry)));
+            file.close();
+            success = true;
+        } else {
+            qDebug() << "Write peak file failed:" << m_peakFile;
+        }
+
+        qreal seconds = timer.nsecsElapsed() / 1e9;
+        qDebug() << "[Peak index:" << m_peakFile << "]" << endl
+                 << "[Samples:" << totalFrames * channels << "] [Levels:" << header.levelCount
+                 << "] [Workers:" << workerCount << "]" << endl
+                 << "[Total:" << seconds << "s] [Decode:" << pipeline.statistics().decodeTime / 1e9 << "s]" << endl
+                 << "[Throughput:" << totalFrames * channels / seconds / 1e6 << "M samples/s]";
+    }
+
+    return success;
+}
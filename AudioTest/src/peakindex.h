@@ -0,0 +1,103 @@
+#ifndef PEAKINDEX_H
+#define PEAKINDEX_H
+
+#include <QFile>
+#include <QThread>
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * 峰值文件格式(小端)：
+ *   PeakFileHeader
+ *   level 0 ... level N-1，每层按 [块][声道] 顺序存放 PeakEntry
+ * 第 L 层每个块覆盖 baseFrames << L 个采样帧，相当于按缩放级别做的 mipmap
+ */
+struct PeakEntry
+{
+    int16_t min;
+    int16_t max;
+    //均方根，满幅为 65535
+    uint16_t rms;
+};
+
+struct PeakFileHeader
+{
+    enum { MaxLevels = 32 };
+
+    char magic[4];
+    uint32_t version;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t baseFrames;
+    uint32_t levelCount;
+    uint64_t frames;
+    uint64_t levelOffsets[MaxLevels];
+    uint64_t levelBlocks[MaxLevels];
+};
+
+/**
+ * @brief PeakIndex
+ * @note 以内存映射方式打开峰值文件，不做任何解析和拷贝，数小时的音频也能立即显示
+ */
+class PeakIndex
+{
+public:
+    PeakIndex() { }
+    ~PeakIndex() { close(); }
+
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    int sampleRate() const { return int(m_header->sampleRate); }
+    int channels() const { return int(m_header->channels); }
+    qint64 frames() const { return qint64(m_header->frames); }
+    int levelCount() const { return int(m_header->levelCount); }
+    qint64 blockFrames(int level) const { return qint64(m_header->baseFrames) << level; }
+
+    /**
+     * @brief levelFor
+     * @return 块大小不超过 framesPerPixel 的最粗一层
+     */
+    int levelFor(qint64 framesPerPixel) const;
+    const PeakEntry *level(int level, qint64 *blocks) const;
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    const PeakFileHeader *m_header = nullptr;
+};
+
+/**
+ * @brief PeakIndexBuilder
+ * @note 解码一次音频流并生成峰值文件
+ *       解码线程按固定大小切块，轮流分发给多个分析线程(每个线程一个队列)计算最底层的峰值，
+ *       全部完成后再逐层合并出更粗的层级
+ */
+class PeakIndexBuilder : public QThread
+{
+    Q_OBJECT
+
+public:
+    PeakIndexBuilder(QObject *parent = nullptr);
+    ~PeakIndexBuilder();
+
+    void build(const QString &audioFile, const QString &peakFile);
+    void stop();
+
+signals:
+    void built(const QString &peakFile);
+
+protected:
+    void run();
+
+private:
+    bool analyze();
+
+    std::atomic_bool m_runnable { true };
+    QString m_audioFile;
+    QString m_peakFile;
+};
+
+#endif // PEAKINDEX_H
@@ -0,0 +1,63 @@
+#-------------------------------------------------
+#
+# Benchmark for Utility
+#
+#-------------------------------------------------
+
+TARGET = Benchmark
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../ffmpeg/include \
+        $$PWD/../Utility
+
+include($$PWD/../MediaCore/mediacore.pri)
+
+LIBS += -L$$PWD/../ffmpeg/lib/ -lavfilter -lavformat -lavcodec -lswscale -lavutil
+
+# leak 检查读取进程的常驻内存
+win32: LIBS += -lpsapi
+# queue / sync 的线程绑定
+unix:!macx: LIBS += -lpthread
+
+CONFIG += console c++11 debug_and_release
+CONFIG -= app_bundle qt
+
+# qmake CONFIG+=tracing 打开热路径追踪(TRACE_* 宏)，否则宏展开为空
+tracing: DEFINES += ENABLE_TRACING
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$shell_path(./debug)
+} else {
+    DESTDIR = $$shell_path(./release)
+}
+
+win32 {
+    ffmpeg_dll = $$shell_path($$PWD/../ffmpeg/dll)
+    QMAKE_POST_LINK = \
+        copy $$ffmpeg_dll $$DESTDIR
+}
+
+HEADERS += \
+        src/benchmark.h \
+        $$PWD/../Utility/bufferqueue.h \
+        $$PWD/../Utility/metrics.h \
+        $$PWD/../Utility/mpmcqueue.h \
+        $$PWD/../Utility/queuemonitor.h \
+        $$PWD/../Utility/semaphore.h \
+        $$PWD/../Utility/spinlock.h \
+        $$PWD/../Utility/threadpool.h \
+        $$PWD/../Utility/pcmdsp.h \
+        $$PWD/../Utility/filtergraph.h
+
+SOURCES += \
+        src/main.cpp \
+        src/pcmbenchmark.cpp \
+        src/imagebenchmark.cpp \
+        src/filterbenchmark.cpp \
+        src/leakbenchmark.cpp \
+        src/queuebenchmark.cpp \
+        src/syncbenchmark.cpp \
+        src/poolbenchmark.cpp \
+        src/slicebenchmark.cpp \
+        $$PWD/../Utility/pcmdsp.cpp \
+        $$PWD/../Utility/filtergraph.cpp
@@ -0,0 +1,67 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief measure
+ * @note 运行 func 共 rounds 轮，每轮 iterations 次，返回最快一轮中单次调用的平均耗时(ns)
+ *       取最快一轮可以排除调度和频率切换带来的抖动
+ */
+template <class Func>
+double measure(Func func, int iterations, int rounds = 5)
+{
+    double best = 0.0;
+    for (int r = 0; r < rounds; r++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) func();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+        if (r == 0 || ns < best) best = ns;
+    }
+
+    return best;
+}
+
+//防止编译器把没有使用的结果优化掉
+template <class T>
+inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T *sink;
+    sink = &value;
+#endif
+}
+
+//检查类的测试(如 leak)未通过时加一，main 据此返回非零
+inline int &benchmarkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void printHeader(const std::string &title)
+{
+    std::printf("\n==== %s ====\n", title.c_str());
+}
+
+/**
+ * @brief pinCurrentThread
+ * @note 把调用线程绑定到第 cpu 个逻辑核(超出核数时取模)，不支持的平台返回false
+ */
+bool pinCurrentThread(int cpu);
+
+void runPcmBenchmark();
+void runImageBenchmark();
+void runFilterBenchmark();
+void runLeakBenchmark();
+void runQueueBenchmark();
+void runSyncBenchmark();
+void runPoolBenchmark();
+void runSliceBenchmark();
+
+#endif
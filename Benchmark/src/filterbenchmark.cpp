@@ -0,0 +1,152 @@
+#include "benchmark.h"
+#include "filtergraph.h"
+
+#include <cstdio>
+
+namespace
+{
+
+//1080p，25fps，共 10 秒
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int FRAMES = 250;
+const AVRational TIME_BASE = { 1, 25 };
+//同时显示的卡拉OK行数，每个音节都用 \kf 逐帧扫色，libass 每帧都要重新渲染
+const int LINES = 12;
+const int SYLLABLES = 16;
+const char *SUBTITLE_FILE = "benchmark_karaoke.ass";
+
+void write_time(FILE *file, int centiseconds)
+{
+    std::fprintf(file, "%d:%02d:%02d.%02d", centiseconds / 360000, centiseconds / 6000 % 60,
+                 centiseconds / 100 % 60, centiseconds % 100);
+}
+
+bool write_subtitle()
+{
+    FILE *file = std::fopen(SUBTITLE_FILE, "w");
+    if (!file) return false;
+
+    std::fprintf(file,
+                 "[Script Info]\nScriptType: v4.00+\nPlayResX: %d\nPlayResY: %d\n\n"
+                 "[V4+ Styles]\nFormat: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, OutlineColour, BackColour, "
+                 "Bold, Italic, Underline, StrikeOut, ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, "
+                 "Alignment, MarginL, MarginR, MarginV, Encoding\n"
+                 "Style: Default,Arial,56,&H00FFFFFF,&H000080FF,&H00000000,&H80000000,"
+                 "0,0,0,0,100,100,0,0,1,3,2,8,20,20,20,1\n\n"
+                 "[Events]\nFormat: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, Effect, Text\n",
+                 WIDTH, HEIGHT);
+
+    //每行 2 秒，错开半秒，任何时刻都有 LINES 行在扫色
+    int duration = FRAMES * 100 / TIME_BASE.den;
+    for (int start = 0; start < duration; start += 50) {
+        for (int line = 0; line < LINES; line++) {
+            std::fprintf(file, "Dialogue: 0,");
+            write_time(file, start);
+            std::fputc(',', file);
+            write_time(file, start + 200);
+            std::fprintf(file, ",Default,,0,0,0,,{\\pos(%d,%d)\\blur2}", WIDTH / 2, 40 + line * (HEIGHT - 80) / LINES);
+            for (int s = 0; s < SYLLABLES; s++)
+                std::fprintf(file, "{\\kf%d}ka%c ", 200 / SYLLABLES, 'a' + s);
+            std::fputc('\n', file);
+        }
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+//模拟解码：每帧生成一幅移动的渐变，代价大致相当于一次较轻的 1080p 解码
+void decode_frame(AVFrame *frame, int index)
+{
+    frame->width = WIDTH;
+    frame->height = HEIGHT;
+    frame->format = AV_PIX_FMT_YUV420P;
+    av_frame_get_buffer(frame, 32);
+    frame->pts = index;
+
+    for (int y = 0; y < HEIGHT; y++) {
+        uint8_t *line = frame->data[0] + y * frame->linesize[0];
+        for (int x = 0; x < WIDTH; x++) line[x] = uint8_t((x + y + index * 4) * 7 >> 3);
+    }
+    for (int p = 1; p < 3; p++) {
+        for (int y = 0; y < HEIGHT / 2; y++) {
+            uint8_t *line = frame->data[p] + y * frame->linesize[p];
+            for (int x = 0; x < WIDTH / 2; x++) line[x] = uint8_t(128 + ((x - y + index) & 31) - 16);
+        }
+    }
+}
+
+void report(const char *name, double seconds, const FilterGraph *graph, int output)
+{
+    double filter = graph ? graph->statistics().pullTime / 1e9 : 0.0;
+    std::printf("%-24s %7.1f fps  total %6.2f s  filter %6.2f s  frames %d\n",
+                name, FRAMES / seconds, seconds, filter, output);
+}
+
+void runSync(const char *name, int threads, const std::string &description)
+{
+    FilterGraphManager manager;
+    manager.setThreadCount(threads);
+    FilterGraph *graph = nullptr;
+    AVFramePtr frame = makeFrame();
+    AVFramePtr filtered = makeFrame();
+    int output = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+        decode_frame(frame.get(), i);
+        graph = manager.acquire(graph, frame.get(), TIME_BASE, description);
+        if (!graph) break;
+        if (graph->push(frame.get()) < 0) break;
+        while (graph->pull(filtered.get()) >= 0) {
+            output++;
+            av_frame_unref(filtered.get());
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report(name, seconds, graph, output);
+}
+
+void runThreaded(const char *name, int threads, const std::string &description)
+{
+    FilterGraphManager manager;
+    manager.setThreadCount(threads);
+    FilterThread filterThread;
+    AVFramePtr frame = makeFrame();
+    std::atomic_int output { 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    filterThread.start(&manager, TIME_BASE, description, [&output](AVFrame *) { output++; });
+    for (int i = 0; i < FRAMES; i++) {
+        decode_frame(frame.get(), i);
+        filterThread.push(frame.get());
+    }
+    filterThread.finish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    report(name, seconds, filterThread.graph(), output);
+}
+
+} //namespace
+
+void runFilterBenchmark()
+{
+    printHeader("FilterGraph (subtitles, " + std::to_string(WIDTH) + "x" + std::to_string(HEIGHT) + ", " +
+                std::to_string(LINES) + " karaoke lines)");
+
+    if (!write_subtitle()) {
+        std::printf("can not write %s\n", SUBTITLE_FILE);
+        return;
+    }
+    //相对路径，避免 Windows 盘符的转义
+    std::string description = std::string("subtitles=filename=") + SUBTITLE_FILE;
+
+    runSync("sync, 1 thread", 1, description);
+    runSync("sync, auto threads", 0, description);
+    runThreaded("filter thread, 1 thread", 1, description);
+    runThreaded("filter thread, auto", 0, description);
+
+    std::remove(SUBTITLE_FILE);
+}
@@ -0,0 +1,235 @@
+#include "benchmark.h"
+#include "imageconverter.h"
+#include "imagedsp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+//1080p 画面底部两行字幕的大小
+const int WIDTH = 1920;
+const int HEIGHT = 120;
+const int ITERATIONS = 200;
+
+//YUV -> RGB 用 1080p 整帧
+const int FRAME_WIDTH = 1920;
+const int FRAME_HEIGHT = 1080;
+const int FRAME_ITERATIONS = 20;
+//比较时 swscale 用 SWS_ACCURATE_RND(不走查表的快速路径)，剩下的差别只来自取整方式；
+//矩阵、范围或通道顺序出错时差别远大于此
+const int MAX_SWSCALE_DIFF = 2;
+const double MAX_SWSCALE_MEAN = 0.5;
+const int CHECK_FLAGS = SWS_BILINEAR | SWS_ACCURATE_RND;
+
+struct YuvCase
+{
+    const char *name;
+    AVPixelFormat src;
+    AVPixelFormat dst;
+};
+
+const YuvCase YUV_CASES[] = {
+    { "yuv420p -> rgb24", AV_PIX_FMT_YUV420P, AV_PIX_FMT_RGB24 },
+    { "yuv420p -> bgra", AV_PIX_FMT_YUV420P, AV_PIX_FMT_BGRA },
+    { "nv12 -> rgb24", AV_PIX_FMT_NV12, AV_PIX_FMT_RGB24 },
+    { "nv12 -> bgra", AV_PIX_FMT_NV12, AV_PIX_FMT_BGRA }
+};
+
+void runCase(const char *name, const std::function<void()> &func, int pixels)
+{
+    static const ImageDsp::Backend backends[] = { ImageDsp::SSE2, ImageDsp::AVX2, ImageDsp::NEON };
+
+    ImageDsp::setBackend(ImageDsp::Scalar);
+    double scalar = measure(func, ITERATIONS);
+    std::printf("%-14s %-7s %9.1f Mpixels/s\n", name, "Scalar", pixels / scalar * 1000.0);
+
+    for (ImageDsp::Backend backend : backends) {
+        if (ImageDsp::setBackend(backend) != backend) continue;
+        double ns = measure(func, ITERATIONS);
+        std::printf("%-14s %-7s %9.1f Mpixels/s  x%.2f\n", name, ImageDsp::backendName(backend),
+                    pixels / ns * 1000.0, scalar / ns);
+    }
+}
+
+/**
+ * @brief make_video_frame
+ * @note 内容平滑变化(亮度为三角波，色度为正弦)：swscale 的 NV12 路径会在水平方向插值色度，
+ *       随机噪声下与逐样本复制的结果没有可比性
+ */
+AVFramePtr make_video_frame(AVPixelFormat format, bool bt709, bool fullRange)
+{
+    AVFramePtr frame = makeFrame();
+    frame->width = FRAME_WIDTH;
+    frame->height = FRAME_HEIGHT;
+    frame->format = format;
+    frame->colorspace = bt709 ? AVCOL_SPC_BT709 : AVCOL_SPC_BT470BG;
+    frame->color_range = fullRange ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+    if (av_frame_get_buffer(frame.get(), 32) < 0) return AVFramePtr();
+
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        for (int x = 0; x < FRAME_WIDTH; x++) {
+            int t = (x / 4 + y / 2) % 512;
+            frame->data[0][y * frame->linesize[0] + x] = uint8_t(t < 256 ? t : 511 - t);
+        }
+    }
+    for (int y = 0; y < FRAME_HEIGHT / 2; y++) {
+        for (int x = 0; x < FRAME_WIDTH / 2; x++) {
+            uint8_t u = uint8_t(128 + 100 * std::sin(x * 0.011 + y * 0.017));
+            uint8_t v = uint8_t(128 + 100 * std::cos(x * 0.013 - y * 0.007));
+            if (format == AV_PIX_FMT_NV12) {
+                frame->data[1][y * frame->linesize[1] + x * 2] = u;
+                frame->data[1][y * frame->linesize[1] + x * 2 + 1] = v;
+            } else {
+                frame->data[1][y * frame->linesize[1] + x] = u;
+                frame->data[2][y * frame->linesize[2] + x] = v;
+            }
+        }
+    }
+
+    return frame;
+}
+
+int bytes_per_pixel(AVPixelFormat format)
+{
+    return format == AV_PIX_FMT_RGB24 ? 3 : 4;
+}
+
+//ImageConverter 的 swscale 回退路径：矩阵和范围由 ImageConverter::context() 按 ColorSpace::of(frame) 设置
+bool convert_swscale(ImageConverter &converter, const AVFrame *frame, std::vector<uint8_t> &image,
+                     AVPixelFormat format, int flags = SWS_BILINEAR)
+{
+    SwsContext *context = converter.context(frame->width, frame->height, AVPixelFormat(frame->format),
+                                            frame->width, frame->height, format, flags, ColorSpace::of(frame));
+    if (!context) return false;
+
+    uint8_t *dst[4] = { image.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { FRAME_WIDTH * bytes_per_pixel(format), 0, 0, 0 };
+
+    return sws_scale(context, frame->data, frame->linesize, 0, frame->height, dst, dstStride) > 0;
+}
+
+bool convert_direct(const AVFrame *frame, std::vector<uint8_t> &image, AVPixelFormat format)
+{
+    uint8_t *dst[4] = { image.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { FRAME_WIDTH * bytes_per_pixel(format), 0, 0, 0 };
+
+    return ImageConverter::convertDirect(frame, format, dst, dstStride, 0, frame->height);
+}
+
+//各个实现与 swscale 的速度对比
+void run_yuv_speed(const YuvCase &c)
+{
+    static const ImageDsp::Backend backends[] = { ImageDsp::Scalar, ImageDsp::SSE2, ImageDsp::AVX2, ImageDsp::NEON };
+    const int pixels = FRAME_WIDTH * FRAME_HEIGHT;
+
+    AVFramePtr frame = make_video_frame(c.src, true, false);
+    ImageConverter converter;
+    if (!frame || !converter.context(FRAME_WIDTH, FRAME_HEIGHT, c.src, FRAME_WIDTH, FRAME_HEIGHT, c.dst,
+                                     SWS_BILINEAR, ColorSpace::of(frame.get()))) {
+        std::printf("%-18s can not create frame or SwsContext\n", c.name);
+        benchmarkFailures()++;
+        return;
+    }
+
+    std::vector<uint8_t> image(size_t(pixels) * bytes_per_pixel(c.dst));
+    double swscale = measure([&] { convert_swscale(converter, frame.get(), image, c.dst); }, FRAME_ITERATIONS);
+    std::printf("%-18s %-7s %9.1f Mpixels/s\n", c.name, "swscale", pixels / swscale * 1000.0);
+
+    for (ImageDsp::Backend backend : backends) {
+        if (ImageDsp::setBackend(backend) != backend) continue;
+        double ns = measure([&] { convert_direct(frame.get(), image, c.dst); doNotOptimize(image[0]); }, FRAME_ITERATIONS);
+        std::printf("%-18s %-7s %9.1f Mpixels/s  x%.2f\n", c.name, ImageDsp::backendName(backend),
+                    pixels / ns * 1000.0, swscale / ns);
+    }
+}
+
+/**
+ * @brief run_yuv_check
+ * @note 每种矩阵、范围下：SIMD 实现必须与 Scalar 逐字节相同，Scalar 与 swscale 的差别在容许范围内
+ */
+void run_yuv_check(const YuvCase &c, bool bt709, bool fullRange)
+{
+    static const ImageDsp::Backend backends[] = { ImageDsp::SSE2, ImageDsp::AVX2, ImageDsp::NEON };
+    const size_t size = size_t(FRAME_WIDTH) * FRAME_HEIGHT * bytes_per_pixel(c.dst);
+
+    AVFramePtr frame = make_video_frame(c.src, bt709, fullRange);
+    ImageConverter converter;
+    std::vector<uint8_t> expected(size), reference(size), image(size);
+    ImageDsp::setBackend(ImageDsp::Scalar);
+    if (!frame || !convert_swscale(converter, frame.get(), expected, c.dst, CHECK_FLAGS) ||
+            !convert_direct(frame.get(), reference, c.dst)) {
+        std::printf("%-18s can not convert\n", c.name);
+        benchmarkFailures()++;
+        return;
+    }
+
+    int maxDiff = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < size; i++) {
+        int diff = std::abs(int(expected[i]) - int(reference[i]));
+        maxDiff = std::max(maxDiff, diff);
+        sum += diff;
+    }
+    double mean = sum / size;
+
+    std::string simd;
+    for (ImageDsp::Backend backend : backends) {
+        if (ImageDsp::setBackend(backend) != backend) continue;
+        convert_direct(frame.get(), image, c.dst);
+        bool same = image == reference;
+        simd += std::string(" ") + ImageDsp::backendName(backend) + (same ? " ok" : " DIFFERENT");
+        if (!same) {
+            std::printf("FAILED: %s %s differs from Scalar\n", c.name, ImageDsp::backendName(backend));
+            benchmarkFailures()++;
+        }
+    }
+
+    std::printf("%-18s %-6s %-7s swscale max %d mean %.3f %s\n", c.name, bt709 ? "BT.709" : "BT.601",
+                fullRange ? "full" : "limited", maxDiff, mean, simd.c_str());
+    if (maxDiff > MAX_SWSCALE_DIFF || mean > MAX_SWSCALE_MEAN) {
+        std::printf("FAILED: %s differs from swscale (max %d, mean %.3f)\n", c.name, maxDiff, mean);
+        benchmarkFailures()++;
+    }
+}
+
+} //namespace
+
+void runImageBenchmark()
+{
+    printHeader("ImageDsp (" + std::to_string(WIDTH) + "x" + std::to_string(HEIGHT) + ")");
+
+    std::mt19937 rng(2019);
+    std::vector<uint8_t> dst(WIDTH * HEIGHT), src(WIDTH * HEIGHT), opaque(WIDTH * HEIGHT), sparse(WIDTH * HEIGHT);
+    for (int i = 0; i < WIDTH * HEIGHT; i++) {
+        dst[i] = uint8_t(rng());
+        src[i] = uint8_t(rng());
+        opaque[i] = uint8_t(rng() | 1);
+        //字幕位图大部分是透明的：只有约 1/4 的 32 像素块有内容
+        sparse[i] = (i / 32) % 4 == 0 ? uint8_t(rng()) : 0;
+    }
+
+    auto blend = [&](const std::vector<uint8_t> &alpha) {
+        for (int y = 0; y < HEIGHT; y++)
+            ImageDsp::blend(dst.data() + y * WIDTH, src.data() + y * WIDTH, alpha.data() + y * WIDTH, WIDTH);
+        doNotOptimize(dst[0]);
+    };
+
+    runCase("blend opaque", [&] { blend(opaque); }, WIDTH * HEIGHT);
+    runCase("blend sparse", [&] { blend(sparse); }, WIDTH * HEIGHT);
+
+    printHeader("YUV -> RGB (" + std::to_string(FRAME_WIDTH) + "x" + std::to_string(FRAME_HEIGHT) + ", unscaled)");
+    for (const YuvCase &c : YUV_CASES) run_yuv_speed(c);
+    for (const YuvCase &c : YUV_CASES) {
+        for (int matrix = 0; matrix < 2; matrix++) {
+            for (int range = 0; range < 2; range++) run_yuv_check(c, matrix == 1, range == 1);
+        }
+    }
+
+    ImageDsp::setBackend(ImageDsp::Auto);
+}
@@ -0,0 +1,153 @@
+#include "benchmark.h"
+#include "filtergraph.h"
+#include "imageconverter.h"
+#include "mediasource.h"
+#include "streamdecoder.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+
+//小尺寸的 yuv4mpeg 片段，rawvideo 解码几乎没有开销，循环主要测打开和释放
+const int WIDTH = 64;
+const int HEIGHT = 48;
+const int FRAMES = 4;
+const int CYCLES = 10000;
+//前面的循环让分配器和 FFmpeg 内部的静态表达到稳定状态，之后才开始比较
+const int WARMUP = 500;
+//每次泄漏一个 AVFrame 结构(约 500 字节)，一万次也会超过这个值
+const long long MAX_GROWTH = 2 * 1024 * 1024;
+const char *CLIP_FILE = "benchmark_leak.y4m";
+
+bool write_clip()
+{
+    FILE *file = std::fopen(CLIP_FILE, "wb");
+    if (!file) return false;
+
+    std::fprintf(file, "YUV4MPEG2 W%d H%d F25:1 Ip A1:1 C420jpeg\n", WIDTH, HEIGHT);
+    std::vector<unsigned char> frame(size_t(WIDTH) * HEIGHT * 3 / 2);
+    for (int i = 0; i < FRAMES; i++) {
+        for (size_t p = 0; p < frame.size(); p++) frame[p] = (unsigned char)(p * 3 + i * 16);
+        std::fprintf(file, "FRAME\n");
+        std::fwrite(frame.data(), 1, frame.size(), file);
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+//常驻内存(字节)，不支持的平台返回 0
+long long resident_size()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return (long long)counters.WorkingSetSize;
+#elif defined(__linux__)
+    long long pages = 0, resident = 0;
+    FILE *file = std::fopen("/proc/self/statm", "r");
+    if (file) {
+        if (std::fscanf(file, "%lld %lld", &pages, &resident) != 2) resident = 0;
+        std::fclose(file);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+/**
+ * @brief open_decode_close
+ * @note 与各个解码器相同的流程：打开输入和解码器，解码、过滤、转换，然后全部释放
+ * @param partial 为true时转换完第一帧就返回，检查中途退出的路径同样没有泄漏
+ * @return 转换的帧数，出错返回 -1
+ */
+int open_decode_close(std::vector<uint8_t> &image, bool partial)
+{
+    MediaSource source;
+    StreamDecoder decoder;
+    ImageConverter converter;
+    FilterGraph graph;
+    AVFramePtr filtered = makeFrame();
+    int frames = 0;
+
+    if (!filtered || !source.open(CLIP_FILE)) return -1;
+    int index = source.findStream(AVMEDIA_TYPE_VIDEO);
+    if (index < 0 || !decoder.open(source.stream(index), 1)) return -1;
+
+    FilterGraph::Format format = { WIDTH, HEIGHT, decoder.context()->pix_fmt, decoder.timeBase(), { 1, 1 } };
+    if (!graph.init(format, "null", 1)) return -1;
+
+    uint8_t *dst[4] = { image.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { WIDTH * 3, 0, 0, 0 };
+    auto handler = [&](AVFrame *frame) {
+        if (graph.push(frame) < 0) return false;
+        while (graph.pull(filtered.get()) >= 0) {
+            if (converter.convert(filtered.get(), WIDTH, HEIGHT, AV_PIX_FMT_RGB24, dst, dstStride)) frames++;
+            av_frame_unref(filtered.get());
+        }
+        return !partial;
+    };
+
+    AVPacketPtr packet = makePacket();
+    while (packet && source.read(packet.get()) >= 0) {
+        int ret = packet->stream_index == index ? decoder.decode(packet.get(), handler) : 0;
+        av_packet_unref(packet.get());
+        if (ret == AVERROR_EXIT) return frames;
+        else if (ret < 0) return -1;
+    }
+    decoder.decode(nullptr, handler);
+
+    return frames;
+}
+
+} //namespace
+
+void runLeakBenchmark()
+{
+    printHeader("Open / decode / close x" + std::to_string(CYCLES) + " (" + std::to_string(WIDTH) + "x" +
+                std::to_string(HEIGHT) + " y4m, " + std::to_string(FRAMES) + " frames)");
+
+    if (!write_clip()) {
+        std::printf("can not write %s\n", CLIP_FILE);
+        benchmarkFailures()++;
+        return;
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+    std::vector<uint8_t> image(size_t(WIDTH) * HEIGHT * 3);
+    long long baseline = 0, peak = 0;
+    int errors = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < CYCLES; i++) {
+        bool partial = i % 2 == 1;
+        if (open_decode_close(image, partial) != (partial ? 1 : FRAMES)) errors++;
+        if (i + 1 == WARMUP) baseline = resident_size();
+        if (i + 1 > WARMUP && (i + 1) % 500 == 0) peak = std::max(peak, resident_size());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove(CLIP_FILE);
+
+    std::printf("%-24s %9.1f us / cycle  errors %d\n", "open/decode/close", seconds * 1e6 / CYCLES, errors);
+    if (baseline <= 0) {
+        std::printf("%-24s not available on this platform\n", "resident size");
+    } else {
+        long long growth = peak - baseline;
+        std::printf("%-24s baseline %.1f MB  peak %.1f MB  growth %lld KB (max %lld KB)\n", "resident size",
+                    baseline / 1048576.0, peak / 1048576.0, growth / 1024, MAX_GROWTH / 1024);
+        if (growth > MAX_GROWTH) {
+            std::printf("FAILED: resident size keeps growing, FFmpeg resources are leaking\n");
+            benchmarkFailures()++;
+        }
+    }
+    if (errors > 0) benchmarkFailures()++;
+}
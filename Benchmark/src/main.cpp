@@ -0,0 +1,64 @@
+#include "benchmark.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <cstring>
+#include <thread>
+
+struct BenchmarkEntry
+{
+    const char *name;
+    void (*run)();
+};
+
+static const BenchmarkEntry benchmarks[] = {
+    { "pcm", runPcmBenchmark },
+    { "image", runImageBenchmark },
+    { "filter", runFilterBenchmark },
+    { "leak", runLeakBenchmark },
+    { "queue", runQueueBenchmark },
+    { "sync", runSyncBenchmark },
+    { "pool", runPoolBenchmark },
+    { "slice", runSliceBenchmark }
+};
+
+bool pinCurrentThread(int cpu)
+{
+    int count = int(std::thread::hardware_concurrency());
+    if (count <= 0) return false;
+    cpu %= count;
+
+#if defined(_WIN32)
+    //超过 64 核时只使用第一个处理器组
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << (cpu % 64)) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+//用法: Benchmark [名称...]，不带参数时运行全部
+int main(int argc, char *argv[])
+{
+    for (const BenchmarkEntry &entry : benchmarks) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            if (std::strcmp(argv[i], entry.name) == 0) selected = true;
+        }
+        if (selected) entry.run();
+    }
+
+    return benchmarkFailures() > 0 ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+#include "benchmark.h"
+#include "pcmdsp.h"
+
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+//一次 QAudioOutput 周期左右的数据量：2048 帧 * 2 声道
+const int SAMPLE_COUNT = 4096;
+const int ITERATIONS = 2000;
+
+struct PcmBuffers
+{
+    PcmBuffers() : s32a(SAMPLE_COUNT), s32b(SAMPLE_COUNT), s16a(SAMPLE_COUNT), s16b(SAMPLE_COUNT),
+                   flta(SAMPLE_COUNT), fltb(SAMPLE_COUNT), left(SAMPLE_COUNT / 2), right(SAMPLE_COUNT / 2) {
+        std::mt19937 rng(2019);
+        for (int i = 0; i < SAMPLE_COUNT; i++) {
+            s32a[i] = int32_t(rng());
+            s32b[i] = int32_t(rng());
+            s16a[i] = int16_t(rng());
+            s16b[i] = int16_t(rng());
+            flta[i] = float(s32a[i]) / 2147483648.0f;
+            fltb[i] = float(s32b[i]) / 2147483648.0f;
+        }
+        for (int i = 0; i < SAMPLE_COUNT / 2; i++) {
+            left[i] = int32_t(rng());
+            right[i] = int32_t(rng());
+        }
+    }
+
+    std::vector<int32_t> s32a, s32b;
+    std::vector<int16_t> s16a, s16b;
+    std::vector<float> flta, fltb;
+    std::vector<int32_t> left, right;
+};
+
+bool operator==(const PcmBuffers &a, const PcmBuffers &b)
+{
+    return a.s32a == b.s32a && a.s32b == b.s32b && a.s16a == b.s16a && a.s16b == b.s16b &&
+            a.flta == b.flta && a.fltb == b.fltb && a.left == b.left && a.right == b.right;
+}
+
+void runCase(const char *name, const std::function<void()> &func)
+{
+    static const PcmDsp::Backend backends[] = { PcmDsp::SSE2, PcmDsp::AVX2, PcmDsp::NEON };
+
+    PcmDsp::setBackend(PcmDsp::Scalar);
+    double scalar = measure(func, ITERATIONS);
+    std::printf("%-14s %-7s %9.1f Msamples/s\n", name, "Scalar", SAMPLE_COUNT / scalar * 1000.0);
+
+    for (PcmDsp::Backend backend : backends) {
+        if (PcmDsp::setBackend(backend) != backend) continue;
+        double ns = measure(func, ITERATIONS);
+        std::printf("%-14s %-7s %9.1f Msamples/s  x%.2f\n", name, PcmDsp::backendName(backend),
+                    SAMPLE_COUNT / ns * 1000.0, scalar / ns);
+    }
+}
+
+/**
+ * @brief run_check
+ * @note 各个实现的结果必须与 Scalar(lrint，就近偶数舍入)逐样本相同
+ *       输入的开头放入正好落在两个整数中间的值，舍入方式不同(如向远离零的方向舍入)时会被发现
+ */
+void run_check(const char *name, const std::function<void(PcmBuffers &)> &func)
+{
+    static const PcmDsp::Backend backends[] = { PcmDsp::SSE2, PcmDsp::AVX2, PcmDsp::NEON };
+
+    PcmBuffers input;
+    for (int i = 0; i < 256; i++) {
+        input.flta[i] = (i - 128 + 0.5f) / 32768.0f;
+        input.fltb[i] = (i - 128 + 0.5f) / 2147483648.0f;
+        input.s32a[i] = input.s16a[i] = int16_t(i - 128);
+    }
+
+    PcmDsp::setBackend(PcmDsp::Scalar);
+    PcmBuffers expected = input;
+    func(expected);
+
+    std::string result;
+    for (PcmDsp::Backend backend : backends) {
+        if (PcmDsp::setBackend(backend) != backend) continue;
+        PcmBuffers output = input;
+        func(output);
+        bool same = output == expected;
+        result += std::string(" ") + PcmDsp::backendName(backend) + (same ? " ok" : " DIFFERENT");
+        if (!same) {
+            std::printf("FAILED: %s %s differs from Scalar\n", name, PcmDsp::backendName(backend));
+            benchmarkFailures()++;
+        }
+    }
+    std::printf("%-14s check%s\n", name, result.c_str());
+}
+
+} //namespace
+
+void runPcmBenchmark()
+{
+    printHeader("PcmDsp (" + std::to_string(SAMPLE_COUNT) + " samples)");
+
+    //0.5 的增益让奇数样本正好落在两个整数中间
+    run_check("gain s32", [](PcmBuffers &p) { PcmDsp::applyGain(p.s32a.data(), SAMPLE_COUNT, 0.5f); });
+    run_check("gain s16", [](PcmBuffers &p) { PcmDsp::applyGain(p.s16a.data(), SAMPLE_COUNT, 0.5f); });
+    run_check("mix s32", [](PcmBuffers &p) { PcmDsp::mix(p.s32a.data(), p.s32b.data(), SAMPLE_COUNT); });
+    run_check("mix s16", [](PcmBuffers &p) { PcmDsp::mix(p.s16a.data(), p.s16b.data(), SAMPLE_COUNT); });
+    run_check("gain flt", [](PcmBuffers &p) { PcmDsp::applyGain(p.flta.data(), SAMPLE_COUNT, 0.5f); });
+    run_check("mix flt", [](PcmBuffers &p) { PcmDsp::mix(p.flta.data(), p.fltb.data(), SAMPLE_COUNT); });
+    run_check("s32 -> s16", [](PcmBuffers &p) { PcmDsp::convert(p.s16b.data(), p.s32b.data(), SAMPLE_COUNT); });
+    run_check("s16 -> s32", [](PcmBuffers &p) { PcmDsp::convert(p.s32b.data(), p.s16b.data(), SAMPLE_COUNT); });
+    run_check("s32 -> flt", [](PcmBuffers &p) { PcmDsp::convert(p.fltb.data(), p.s32b.data(), SAMPLE_COUNT); });
+    run_check("flt -> s32", [](PcmBuffers &p) { PcmDsp::convert(p.s32b.data(), p.fltb.data(), SAMPLE_COUNT); });
+    run_check("s16 -> flt", [](PcmBuffers &p) { PcmDsp::convert(p.fltb.data(), p.s16b.data(), SAMPLE_COUNT); });
+    run_check("flt -> s16", [](PcmBuffers &p) { PcmDsp::convert(p.s16b.data(), p.flta.data(), SAMPLE_COUNT); });
+    run_check("interleave", [](PcmBuffers &p) {
+        const int32_t *planes[] = { p.left.data(), p.right.data() };
+        PcmDsp::interleave(p.s32b.data(), planes, 2, SAMPLE_COUNT / 2);
+    });
+    run_check("deinterleave", [](PcmBuffers &p) {
+        int32_t *planes[] = { p.left.data(), p.right.data() };
+        PcmDsp::deinterleave(planes, p.s32b.data(), 2, SAMPLE_COUNT / 2);
+    });
+
+    PcmBuffers b;
+    int32_t *planes[] = { b.left.data(), b.right.data() };
+    const int32_t *constPlanes[] = { b.left.data(), b.right.data() };
+
+    //增益使用 1.0 附近的值，多次迭代后数据不会全部饱和
+    runCase("gain s32", [&] { PcmDsp::applyGain(b.s32a.data(), SAMPLE_COUNT, 0.999f); doNotOptimize(b.s32a[0]); });
+    runCase("gain s16", [&] { PcmDsp::applyGain(b.s16a.data(), SAMPLE_COUNT, 0.999f); doNotOptimize(b.s16a[0]); });
+    runCase("gain flt", [&] { PcmDsp::applyGain(b.flta.data(), SAMPLE_COUNT, 0.999f); doNotOptimize(b.flta[0]); });
+    runCase("mix s32", [&] { PcmDsp::mix(b.s32a.data(), b.s32b.data(), SAMPLE_COUNT); doNotOptimize(b.s32a[0]); });
+    runCase("mix s16", [&] { PcmDsp::mix(b.s16a.data(), b.s16b.data(), SAMPLE_COUNT); doNotOptimize(b.s16a[0]); });
+    runCase("mix flt", [&] { PcmDsp::mix(b.flta.data(), b.fltb.data(), SAMPLE_COUNT); doNotOptimize(b.flta[0]); });
+    runCase("s32 -> s16", [&] { PcmDsp::convert(b.s16b.data(), b.s32b.data(), SAMPLE_COUNT); doNotOptimize(b.s16b[0]); });
+    runCase("s16 -> s32", [&] { PcmDsp::convert(b.s32b.data(), b.s16b.data(), SAMPLE_COUNT); doNotOptimize(b.s32b[0]); });
+    runCase("s32 -> flt", [&] { PcmDsp::convert(b.fltb.data(), b.s32b.data(), SAMPLE_COUNT); doNotOptimize(b.fltb[0]); });
+    runCase("flt -> s32", [&] { PcmDsp::convert(b.s32b.data(), b.fltb.data(), SAMPLE_COUNT); doNotOptimize(b.s32b[0]); });
+    runCase("s16 -> flt", [&] { PcmDsp::convert(b.fltb.data(), b.s16b.data(), SAMPLE_COUNT); doNotOptimize(b.fltb[0]); });
+    runCase("flt -> s16", [&] { PcmDsp::convert(b.s16b.data(), b.fltb.data(), SAMPLE_COUNT); doNotOptimize(b.s16b[0]); });
+    runCase("interleave", [&] { PcmDsp::interleave(b.s32b.data(), constPlanes, 2, SAMPLE_COUNT / 2); doNotOptimize(b.s32b[0]); });
+    runCase("deinterleave", [&] { PcmDsp::deinterleave(planes, b.s32b.data(), 2, SAMPLE_COUNT / 2); doNotOptimize(b.left[0]); });
+
+    PcmDsp::setBackend(PcmDsp::Auto);
+}
@@ -0,0 +1,138 @@
+#include "benchmark.h"
+#include "imageconverter.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+//与 VideoDecoder 相同：1080p YUV420P -> RGB24
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int FRAMES = 120;
+//不同内容的源帧循环使用
+const int SOURCE_FRAMES = 8;
+
+std::vector<AVFramePtr> make_frames()
+{
+    std::vector<AVFramePtr> frames;
+    for (int i = 0; i < SOURCE_FRAMES; i++) {
+        AVFramePtr frame = makeFrame();
+        frame->width = WIDTH;
+        frame->height = HEIGHT;
+        frame->format = AV_PIX_FMT_YUV420P;
+        if (av_frame_get_buffer(frame.get(), 32) < 0) return std::vector<AVFramePtr>();
+
+        for (int plane = 0; plane < 3; plane++) {
+            int width = plane == 0 ? WIDTH : WIDTH / 2;
+            int height = plane == 0 ? HEIGHT : HEIGHT / 2;
+            for (int y = 0; y < height; y++) {
+                uint8_t *line = frame->data[plane] + y * frame->linesize[plane];
+                for (int x = 0; x < width; x++) line[x] = uint8_t(x * 3 + y * 5 + i * 17 + plane * 64);
+            }
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    return frames;
+}
+
+//单线程基准：与原来的 VideoDecoder 一样在解码线程中逐帧转换，返回帧/秒
+double run_single(const std::vector<AVFramePtr> &frames)
+{
+    ImageConverter converter;
+    std::vector<uint8_t> image(size_t(WIDTH) * HEIGHT * 3);
+    uint8_t *dst[4] = { image.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { WIDTH * 3, 0, 0, 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) converter.convert(frames[i % SOURCE_FRAMES].get(), WIDTH, HEIGHT, AV_PIX_FMT_RGB24, dst, dstStride);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return FRAMES / seconds;
+}
+
+/**
+ * @brief run_pool
+ * @note 与 VideoDecoder 相同的用法：每帧一个任务，工作线程各用自己的 ImageConverter，
+ *       在途任务数限制为线程数的两倍，结果经 OrderedOutput 按序输出
+ * @return 帧/秒，输出顺序错误时返回负数
+ */
+double run_pool(const std::vector<AVFramePtr> &frames, int threads, ThreadPool::Statistics &statistics)
+{
+    ThreadPool pool(threads);
+    std::vector<std::unique_ptr<ImageConverter>> converters;
+    std::vector<std::vector<uint8_t>> images;
+    for (int i = 0; i < threads; i++) {
+        converters.emplace_back(new ImageConverter);
+        //每个线程写自己的缓冲，与每帧新建 QImage 相比省掉分配
+        images.emplace_back(size_t(WIDTH) * HEIGHT * 3);
+    }
+
+    std::atomic_int pending { 0 };
+    const int maxPending = threads * 2;
+    int expected = 0;
+    bool ordered = true;
+    OrderedOutput<int> output([&](int &index) {
+        if (index != expected++) ordered = false;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < FRAMES; i++) {
+        while (pending.load() >= maxPending) std::this_thread::yield();
+        pending++;
+        pool.submit([&, i] {
+            int worker = pool.currentWorker();
+            uint8_t *dst[4] = { images[worker].data(), nullptr, nullptr, nullptr };
+            int dstStride[4] = { WIDTH * 3, 0, 0, 0 };
+            converters[worker]->convert(frames[i % SOURCE_FRAMES].get(), WIDTH, HEIGHT, AV_PIX_FMT_RGB24, dst, dstStride);
+            output.push(uint64_t(i), i);
+            pending--;
+        });
+    }
+    pool.waitForDone();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    statistics = pool.statistics();
+
+    return ordered && expected == FRAMES ? FRAMES / seconds : -1.0;
+}
+
+} //namespace
+
+void runPoolBenchmark()
+{
+    int cores = int(std::thread::hardware_concurrency());
+    printHeader("ThreadPool RGB conversion (" + std::to_string(WIDTH) + "x" + std::to_string(HEIGHT) + " YUV420P -> RGB24, " +
+                std::to_string(FRAMES) + " frames, " + std::to_string(cores) + " threads)");
+
+    std::vector<AVFramePtr> frames = make_frames();
+    if (frames.empty()) {
+        std::printf("can not allocate frames\n");
+        benchmarkFailures()++;
+        return;
+    }
+
+    double single = run_single(frames);
+    std::printf("%-20s %8.1f fps\n", "single thread", single);
+
+    std::vector<int> counts = { 1, 2, 4 };
+    if (cores > 4) counts.push_back(cores);
+    for (int threads : counts) {
+        ThreadPool::Statistics statistics;
+        double fps = run_pool(frames, threads, statistics);
+        if (fps < 0) {
+            std::printf("FAILED: pool x%d output out of order\n", threads);
+            benchmarkFailures()++;
+            continue;
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "pool x%d", threads);
+        std::printf("%-20s %8.1f fps  x%.2f  stolen %lld / %lld\n", name, fps, fps / single,
+                    static_cast<long long>(statistics.stolen), static_cast<long long>(statistics.executed));
+    }
+}
@@ -0,0 +1,239 @@
+#include "benchmark.h"
+#include "bufferqueue.h"
+#include "metrics.h"
+#include "mpmcqueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int MESSAGES = 200000;
+//Packet 每次入队出队都要分配和拷贝，数量少一些
+const int PACKET_MESSAGES = 50000;
+//Image 元素循环指向这些缓冲，测的是句柄的传递而不是内存分配
+const int IMAGE_POOL = 16;
+const int IMAGE_WIDTH = 1920;
+const int IMAGE_HEIGHT = 1080;
+//一个 MP3 帧解码后的 S16 立体声：1152 * 2 * 2 字节
+const int PACKET_BYTES = 4608;
+
+//与 QImage 相同：元素只是共享缓冲的句柄，入队出队只增减引用计数
+struct Image
+{
+    std::shared_ptr<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+    int seq = -1;
+};
+
+//与 AudioTest 的 Packet 大小相当，但数据不共享，入队出队都会拷贝
+struct Packet
+{
+    std::vector<uint8_t> data;
+    double time = 0.0;
+    int seq = -1;
+};
+
+const std::vector<std::shared_ptr<uint8_t>> &image_pool()
+{
+    //不初始化像素，只保留地址空间，不占常驻内存
+    static std::vector<std::shared_ptr<uint8_t>> pool = [] {
+        std::vector<std::shared_ptr<uint8_t>> buffers;
+        for (int i = 0; i < IMAGE_POOL; i++)
+            buffers.emplace_back(new uint8_t[size_t(IMAGE_WIDTH) * IMAGE_HEIGHT * 3], std::default_delete<uint8_t[]>());
+        return buffers;
+    }();
+
+    return pool;
+}
+
+//各元素类型的构造和序号，序号为 -1 的元素通知消费者结束
+template <class T> struct Element;
+
+template <> struct Element<int>
+{
+    static const char *name() { return "int"; }
+    static int messages() { return MESSAGES; }
+    static int make(int seq) { return seq; }
+    static int sequence(int element) { return element; }
+};
+
+template <> struct Element<Image>
+{
+    static const char *name() { return "image"; }
+    static int messages() { return MESSAGES; }
+    static Image make(int seq) {
+        Image image;
+        if (seq >= 0) image.pixels = image_pool()[seq % IMAGE_POOL];
+        image.width = IMAGE_WIDTH;
+        image.height = IMAGE_HEIGHT;
+        image.seq = seq;
+        return image;
+    }
+    static int sequence(const Image &element) { return element.seq; }
+};
+
+template <> struct Element<Packet>
+{
+    static const char *name() { return "packet"; }
+    static int messages() { return PACKET_MESSAGES; }
+    static Packet make(int seq) {
+        Packet packet;
+        if (seq >= 0) packet.data.assign(PACKET_BYTES, uint8_t(seq));
+        packet.time = seq / 38.28;
+        packet.seq = seq;
+        return packet;
+    }
+    static int sequence(const Packet &element) { return element.seq; }
+};
+
+/**
+ * @brief LockedQueue
+ * @note 互斥锁 + 两个条件变量的有界队列，BufferQueue 不支持多生产者/多消费者，作为这些情况的基准
+ */
+template <class T> class LockedQueue
+{
+public:
+    explicit LockedQueue(int capacity) : m_buffer(capacity) { }
+
+    void enqueue(const T &element) {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_notFull.wait(locker, [this] { return m_size < m_buffer.size(); });
+        m_buffer[(m_head + m_size++) % m_buffer.size()] = element;
+        locker.unlock();
+        m_notEmpty.notify_one();
+    }
+
+    T dequeue() {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_notEmpty.wait(locker, [this] { return m_size > 0; });
+        T element = m_buffer[m_head];
+        m_head = (m_head + 1) % m_buffer.size();
+        m_size--;
+        locker.unlock();
+        m_notFull.notify_one();
+
+        return element;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::vector<T> m_buffer;
+    size_t m_head = 0;
+    size_t m_size = 0;
+};
+
+struct Config
+{
+    int producers;
+    int consumers;
+    int capacity;
+    //生产者从 0 号核开始依次绑定，消费者接在后面
+    bool pin;
+};
+
+/**
+ * @brief run_case
+ * @note 生产者按序号交错发送 messages 个元素，入队前记录时间，消费者出队后算出交接延迟
+ *       延迟先存在各消费者自己的数组里，结束后再汇总到 Histogram，避免记录本身的竞争
+ */
+template <class Queue, class T>
+void run_case(const char *name, const Config &config)
+{
+    const int messages = Element<T>::messages();
+    std::unique_ptr<Queue> queue(new Queue(config.capacity));
+    std::vector<int64_t> stamps(messages);
+    std::vector<std::vector<int64_t>> samples(config.consumers);
+    for (auto &latency : samples) latency.reserve(messages / config.consumers + 1);
+
+    std::atomic_int ready { 0 };
+    std::atomic_bool go { false };
+    auto wait_start = [&](int cpu) {
+        if (config.pin) pinCurrentThread(cpu);
+        ready++;
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+    };
+
+    std::vector<std::thread> producers, consumers;
+    for (int p = 0; p < config.producers; p++) {
+        producers.emplace_back([&, p] {
+            wait_start(p);
+            for (int seq = p; seq < messages; seq += config.producers) {
+                T element = Element<T>::make(seq);
+                stamps[seq] = Metrics::now();
+                queue->enqueue(element);
+            }
+        });
+    }
+    for (int c = 0; c < config.consumers; c++) {
+        consumers.emplace_back([&, c] {
+            std::vector<int64_t> &latency = samples[c];
+            wait_start(config.producers + c);
+            while (true) {
+                T element = queue->dequeue();
+                int seq = Element<T>::sequence(element);
+                if (seq < 0) break;
+                latency.push_back(Metrics::now() - stamps[seq]);
+            }
+        });
+    }
+
+    while (ready.load() < config.producers + config.consumers) std::this_thread::yield();
+    int64_t begin = Metrics::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &thread : producers) thread.join();
+    for (int c = 0; c < config.consumers; c++) queue->enqueue(Element<T>::make(-1));
+    for (std::thread &thread : consumers) thread.join();
+    double seconds = (Metrics::now() - begin) / 1e9;
+
+    Histogram latency;
+    for (const auto &consumer : samples)
+        for (int64_t value : consumer) latency.record(value);
+    Histogram::Snapshot s = latency.snapshot();
+
+    std::printf("%-12s %-6s %dP%dC  cap %-5d %-3s %8.3f M/s  p50 %8.2f  p99 %8.2f  p99.9 %9.2f us\n",
+                name, Element<T>::name(), config.producers, config.consumers, config.capacity, config.pin ? "pin" : "-",
+                messages / seconds / 1e6, s.p50 / 1e3, s.p99 / 1e3, s.p999 / 1e3);
+}
+
+} //namespace
+
+void runQueueBenchmark()
+{
+    printHeader("Queue handoff (" + std::to_string(std::thread::hardware_concurrency()) + " threads, latency from enqueue to dequeue)");
+
+    static const int capacities[] = { 8, 64, 1024 };
+    static const bool pins[] = { false, true };
+
+    //BufferQueue 只能一个生产者一个消费者(解码线程 -> 界面线程)
+    for (bool pin : pins) {
+        for (int capacity : capacities) {
+            Config config = { 1, 1, capacity, pin };
+            run_case<BufferQueue<int>, int>("BufferQueue", config);
+            run_case<BufferQueue<Image>, Image>("BufferQueue", config);
+            run_case<BufferQueue<Packet>, Packet>("BufferQueue", config);
+            run_case<MpmcQueue<int>, int>("MpmcQueue", config);
+            run_case<MpmcQueue<Image>, Image>("MpmcQueue", config);
+            run_case<MpmcQueue<Packet>, Packet>("MpmcQueue", config);
+        }
+    }
+
+    static const int counts[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 4, 1 }, { 1, 4 } };
+    for (bool pin : pins) {
+        for (const auto &count : counts) {
+            Config config = { count[0], count[1], 64, pin };
+            run_case<LockedQueue<int>, int>("LockedQueue", config);
+            run_case<LockedQueue<Image>, Image>("LockedQueue", config);
+            run_case<MpmcQueue<int>, int>("MpmcQueue", config);
+            run_case<MpmcQueue<Image>, Image>("MpmcQueue", config);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "benchmark.h"
+#include "imageconverter.h"
+#include "parallelimageconverter.h"
+#include "threadpool.h"
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+struct SliceCase
+{
+    int width;
+    int height;
+    AVPixelFormat format;
+    int frames;
+};
+
+//奇数高度的小图只检查条带边界(色度行)是否对齐
+const SliceCase CASES[] = {
+    { 1920, 1081, AV_PIX_FMT_YUV420P, 8 },
+    { 3840, 2160, AV_PIX_FMT_YUV420P, 60 },
+    { 3840, 2160, AV_PIX_FMT_NV12, 60 },
+    { 7680, 4320, AV_PIX_FMT_YUV420P, 15 }
+};
+const int SOURCE_FRAMES = 4;
+
+std::vector<AVFramePtr> make_frames(const SliceCase &c)
+{
+    std::vector<AVFramePtr> frames;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(c.format);
+    for (int i = 0; i < SOURCE_FRAMES; i++) {
+        AVFramePtr frame = makeFrame();
+        frame->width = c.width;
+        frame->height = c.height;
+        frame->format = c.format;
+        if (av_frame_get_buffer(frame.get(), 32) < 0) return std::vector<AVFramePtr>();
+
+        for (int plane = 0; plane < 4 && frame->data[plane]; plane++) {
+            int height = plane == 0 ? c.height : AV_CEIL_RSHIFT(c.height, desc->log2_chroma_h);
+            for (int y = 0; y < height; y++) {
+                uint8_t *line = frame->data[plane] + y * frame->linesize[plane];
+                for (int x = 0; x < frame->linesize[plane]; x++) line[x] = uint8_t(x * 7 + y * 3 + i * 29 + plane * 64);
+            }
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    return frames;
+}
+
+template <class Converter>
+double run_converter(Converter &converter, const std::vector<AVFramePtr> &frames, const SliceCase &c, std::vector<uint8_t> &image)
+{
+    uint8_t *dst[4] = { image.data(), nullptr, nullptr, nullptr };
+    int dstStride[4] = { c.width * 3, 0, 0, 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < c.frames; i++)
+        converter.convert(frames[i % SOURCE_FRAMES].get(), c.width, c.height, AV_PIX_FMT_RGB24, dst, dstStride);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return c.frames / seconds;
+}
+
+} //namespace
+
+void runSliceBenchmark()
+{
+    int cores = int(std::thread::hardware_concurrency());
+    printHeader("Band-parallel RGB conversion (-> RGB24, " + std::to_string(ThreadPool::instance().threadCount()) +
+                " pool threads, " + std::to_string(cores) + " cores)");
+
+    for (const SliceCase &c : CASES) {
+        char name[48];
+        std::snprintf(name, sizeof(name), "%dx%d %s", c.width, c.height, av_get_pix_fmt_name(c.format));
+
+        std::vector<AVFramePtr> frames = make_frames(c);
+        if (frames.empty()) {
+            std::printf("%-24s can not allocate frames\n", name);
+            benchmarkFailures()++;
+            continue;
+        }
+
+        ImageConverter single;
+        ParallelImageConverter parallel;
+        std::vector<uint8_t> expected(size_t(c.width) * c.height * 3), image(expected.size());
+        double singleFps = run_converter(single, frames, c, expected);
+        double parallelFps = run_converter(parallel, frames, c, image);
+
+        //最后转换的是同一个源帧，结果必须逐字节相同
+        bool same = std::memcmp(expected.data(), image.data(), expected.size()) == 0;
+        std::printf("%-24s single %7.1f fps  bands x%-2d %7.1f fps  x%.2f  %s\n", name, singleFps, parallel.lastBands(),
+                    parallelFps, parallelFps / singleFps, same ? "identical" : "DIFFERENT");
+        if (!same) {
+            std::printf("FAILED: band conversion of %s differs from whole-frame conversion\n", name);
+            benchmarkFailures()++;
+        }
+    }
+}
@@ -0,0 +1,149 @@
+#include "benchmark.h"
+#include "metrics.h"
+#include "semaphore.h"
+#include "spinlock.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int ITERATIONS = 1000000;
+const int PING_PONGS = 100000;
+//竞争测试中每个线程加锁的次数，每 SAMPLE_EVERY 次记录一次等待时间(每次都取时间会盖过锁本身)
+const int LOCKS_PER_THREAD = 200000;
+const int SAMPLE_EVERY = 8;
+
+void print_latency(const char *name, const char *unit, double rate, Histogram &latency)
+{
+    Histogram::Snapshot s = latency.snapshot();
+    std::printf("%-30s %8.3f %s  p50 %8.2f  p99 %8.2f  p99.9 %9.2f us\n", name, rate, unit,
+                s.p50 / 1e3, s.p99 / 1e3, s.p999 / 1e3);
+}
+
+void uncontended()
+{
+    SpinLock spinLock;
+    std::mutex mutex;
+    Semaphore semaphore;
+
+    double spin = measure([&] { spinLock.lock(); spinLock.unlock(); }, ITERATIONS);
+    double locked = measure([&] { mutex.lock(); mutex.unlock(); }, ITERATIONS);
+    double counted = measure([&] { semaphore.release(); semaphore.acquire(); }, ITERATIONS);
+    std::printf("%-30s %8.1f ns\n", "SpinLock lock/unlock", spin);
+    std::printf("%-30s %8.1f ns\n", "std::mutex lock/unlock", locked);
+    std::printf("%-30s %8.1f ns\n", "Semaphore release/acquire", counted);
+}
+
+/**
+ * @brief ping_pong
+ * @note 两个线程用一对 Semaphore 轮流唤醒对方，往返时间的一半即为一次交接的延迟
+ */
+void ping_pong(bool pin)
+{
+    Semaphore ping, pong;
+    std::vector<int64_t> samples(PING_PONGS);
+
+    std::thread echo([&] {
+        if (pin) pinCurrentThread(1);
+        for (int i = 0; i < PING_PONGS; i++) {
+            ping.acquire();
+            pong.release();
+        }
+    });
+
+    int64_t begin = 0, end = 0;
+    std::thread caller([&] {
+        if (pin) pinCurrentThread(0);
+        begin = Metrics::now();
+        for (int i = 0; i < PING_PONGS; i++) {
+            int64_t start = Metrics::now();
+            ping.release();
+            pong.acquire();
+            samples[i] = (Metrics::now() - start) / 2;
+        }
+        end = Metrics::now();
+    });
+    caller.join();
+    echo.join();
+
+    Histogram latency;
+    for (int64_t value : samples) latency.record(value);
+    print_latency(pin ? "Semaphore ping-pong pin" : "Semaphore ping-pong", "M/s", PING_PONGS * 2 / ((end - begin) / 1e3), latency);
+}
+
+/**
+ * @brief contended
+ * @note threads 个线程反复加锁递增同一个计数，记录从请求到拿到锁的时间
+ */
+template <class Lock>
+void contended(const char *name, int threads, bool pin)
+{
+    Lock lock;
+    int64_t counter = 0;
+    std::vector<std::vector<int64_t>> samples(threads);
+    std::atomic_int ready { 0 };
+    std::atomic_bool go { false };
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        samples[t].reserve(LOCKS_PER_THREAD / SAMPLE_EVERY + 1);
+        workers.emplace_back([&, t] {
+            if (pin) pinCurrentThread(t);
+            ready++;
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            for (int i = 0; i < LOCKS_PER_THREAD; i++) {
+                if (i % SAMPLE_EVERY == 0) {
+                    int64_t start = Metrics::now();
+                    lock.lock();
+                    samples[t].push_back(Metrics::now() - start);
+                } else {
+                    lock.lock();
+                }
+                counter++;
+                lock.unlock();
+            }
+        });
+    }
+
+    while (ready.load() < threads) std::this_thread::yield();
+    int64_t begin = Metrics::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread &worker : workers) worker.join();
+    double seconds = (Metrics::now() - begin) / 1e9;
+
+    Histogram latency;
+    for (const auto &thread : samples)
+        for (int64_t value : thread) latency.record(value);
+
+    char title[64];
+    std::snprintf(title, sizeof(title), "%s x%d%s", name, threads, pin ? " pin" : "");
+    print_latency(title, "M/s", counter / seconds / 1e6, latency);
+}
+
+} //namespace
+
+void runSyncBenchmark()
+{
+    int cores = int(std::thread::hardware_concurrency());
+    printHeader("Semaphore / SpinLock (" + std::to_string(cores) + " threads)");
+
+    uncontended();
+    ping_pong(false);
+    ping_pong(true);
+
+    //SpinLock 只会空转，线程数超过核数时持锁线程可能被换出，不测这种情况
+    static const int counts[] = { 2, 4, 8 };
+    static const bool pins[] = { false, true };
+    for (bool pin : pins) {
+        for (int threads : counts) {
+            if (threads > cores) continue;
+            contended<SpinLock>("SpinLock", threads, pin);
+            contended<std::mutex>("std::mutex", threads, pin);
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# 顶层工程：先构建 MediaCore，再构建各个程序
+#
+#-------------------------------------------------
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+        MediaCore \
+        VideoTest \
+        AudioTest \
+        SubtitleTest \
+        SubtitleTest2 \
+        PlayerTest \
+        SubtitleExtract \
+        Benchmark
+
+VideoTest.depends = MediaCore
+AudioTest.depends = MediaCore
+SubtitleTest.depends = MediaCore
+SubtitleTest2.depends = MediaCore
+PlayerTest.depends = MediaCore
+Benchmark.depends = MediaCore
@@ -0,0 +1,50 @@
+#-------------------------------------------------
+#
+# Shared demux / decode / convert library
+#
+#-------------------------------------------------
+
+TEMPLATE = lib
+
+INCLUDEPATH += $$PWD/../ffmpeg/include \
+        $$PWD/../Utility
+
+CONFIG += staticlib c++11 debug_and_release
+CONFIG -= qt
+
+# qmake CONFIG+=tracing 打开热路径追踪(TRACE_* 宏)，否则宏展开为空
+tracing: DEFINES += ENABLE_TRACING
+
+# 输出到源码目录，各个程序不论在哪里构建都能找到
+DESTDIR = $$PWD/lib
+CONFIG(debug, debug|release) {
+    TARGET = MediaCored
+} else {
+    TARGET = MediaCore
+}
+
+HEADERS += \
+        $$PWD/../Utility/avhandle.h \
+        $$PWD/../Utility/imagedsp.h \
+        $$PWD/../Utility/meteredqueue.h \
+        $$PWD/../Utility/metrics.h \
+        $$PWD/../Utility/threadpool.h \
+        $$PWD/../Utility/tracing.h \
+        audioresampler.h \
+        imageconverter.h \
+        mediapipeline.h \
+        mediasource.h \
+        parallelimageconverter.h \
+        streamdecoder.h
+
+SOURCES += \
+        audioresampler.cpp \
+        imageconverter.cpp \
+        mediapipeline.cpp \
+        mediasource.cpp \
+        parallelimageconverter.cpp \
+        streamdecoder.cpp \
+        $$PWD/../Utility/imagedsp.cpp \
+        $$PWD/../Utility/metrics.cpp \
+        $$PWD/../Utility/threadpool.cpp \
+        $$PWD/../Utility/tracing.cpp
@@ -0,0 +1,45 @@
+#include "audioresampler.h"
+#include "tracing.h"
+
+extern "C"
+{
+#include <libavutil/channel_layout.h>
+}
+
+int AudioResampler::bufferSize(const AVFrame *frame, AVSampleFormat format)
+{
+    return av_samples_get_buffer_size(nullptr, frame->channels, frame->nb_samples, format, 0);
+}
+
+int AudioResampler::convert(const AVFrame *frame, AVSampleFormat format, uint8_t *out, int samples)
+{
+    //部分格式(如 wav)不带声道布局，按声道数取默认布局
+    int64_t layout = int64_t(frame->channel_layout);
+    if (!layout) layout = av_get_default_channel_layout(frame->channels);
+
+    if (!m_context || layout != m_layout || frame->sample_rate != m_sampleRate ||
+            frame->format != m_inFormat || format != m_outFormat) {
+        release();
+        m_context.reset(swr_alloc_set_opts(nullptr, layout, format, frame->sample_rate,
+                                           layout, AVSampleFormat(frame->format), frame->sample_rate, 0, nullptr));
+        if (!m_context || swr_init(m_context.get()) < 0) {
+            release();
+            return -1;
+        }
+        m_layout = layout;
+        m_sampleRate = frame->sample_rate;
+        m_inFormat = frame->format;
+        m_outFormat = format;
+    }
+
+    TRACE_SCOPE("swr_convert");
+    return swr_convert(m_context.get(), &out, samples, const_cast<const uint8_t **>(frame->extended_data), frame->nb_samples);
+}
+
+void AudioResampler::release()
+{
+    m_context.reset();
+    m_layout = 0;
+    m_sampleRate = 0;
+    m_inFormat = m_outFormat = AV_SAMPLE_FMT_NONE;
+}
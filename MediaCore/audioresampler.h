@@ -0,0 +1,38 @@
+#ifndef AUDIORESAMPLER_H
+#define AUDIORESAMPLER_H
+
+#include "avhandle.h"
+
+/**
+ * @brief AudioResampler
+ * @note 把解码出的音频转换为交错的目标采样格式，采样率和声道不变
+ *       持有一个 SwrContext，输入参数变化时才重新初始化，析构时自动释放
+ */
+class AudioResampler
+{
+public:
+    AudioResampler() { }
+
+    AudioResampler(const AudioResampler &) = delete;
+    AudioResampler &operator=(const AudioResampler &) = delete;
+
+    //转换 frame 所需的输出字节数
+    static int bufferSize(const AVFrame *frame, AVSampleFormat format);
+
+    /**
+     * @brief convert
+     * @param samples out 能容纳的每声道采样数
+     * @return 输出的每声道采样数，出错返回负数
+     */
+    int convert(const AVFrame *frame, AVSampleFormat format, uint8_t *out, int samples);
+    void release();
+
+private:
+    SwrContextPtr m_context;
+    int64_t m_layout = 0;
+    int m_sampleRate = 0;
+    int m_inFormat = AV_SAMPLE_FMT_NONE;
+    int m_outFormat = AV_SAMPLE_FMT_NONE;
+};
+
+#endif // AUDIORESAMPLER_H
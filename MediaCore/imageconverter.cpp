@@ -0,0 +1,168 @@
+#include "imageconverter.h"
+#include "tracing.h"
+
+extern "C"
+{
+#include <libavutil/pixdesc.h>
+}
+
+namespace
+{
+
+bool is_rgb(AVPixelFormat format)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    return desc && (desc->flags & AV_PIX_FMT_FLAG_RGB);
+}
+
+//只有 YUV -> RGB 需要矩阵；YUV -> YUV 只是缩放，保持 swscale 自己的设置
+void apply_color_space(SwsContext *context, AVPixelFormat srcFormat, AVPixelFormat dstFormat, const ColorSpace &colorSpace)
+{
+    if (is_rgb(srcFormat) || !is_rgb(dstFormat)) return;
+
+    int *invTable, *table, srcRange, dstRange, brightness, contrast, saturation;
+    if (sws_getColorspaceDetails(context, &invTable, &srcRange, &table, &dstRange, &brightness, &contrast, &saturation) < 0) {
+        dstRange = brightness = 0;
+        contrast = saturation = 1 << 16;
+    }
+
+    const int *coefficients = sws_getCoefficients(colorSpace.swsColorspace());
+    sws_setColorspaceDetails(context, coefficients, colorSpace.fullRange, coefficients, dstRange, brightness, contrast, saturation);
+}
+
+} //namespace
+
+ColorSpace ColorSpace::of(AVPixelFormat format, AVColorSpace colorspace, AVColorRange range)
+{
+    ColorSpace colorSpace;
+    switch (colorspace) {
+    case AVCOL_SPC_BT709:
+        colorSpace.matrix = ImageDsp::BT709;
+        break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        colorSpace.matrix = ImageDsp::BT2020;
+        break;
+    default:
+        colorSpace.matrix = ImageDsp::BT601;
+        break;
+    }
+    colorSpace.fullRange = range == AVCOL_RANGE_JPEG || format == AV_PIX_FMT_YUVJ420P ||
+            format == AV_PIX_FMT_YUVJ422P || format == AV_PIX_FMT_YUVJ444P;
+
+    return colorSpace;
+}
+
+ColorSpace ColorSpace::of(const AVFrame *frame)
+{
+    return of(AVPixelFormat(frame->format), frame->colorspace, frame->color_range);
+}
+
+int ColorSpace::swsColorspace() const
+{
+    switch (matrix) {
+    case ImageDsp::BT709: return SWS_CS_ITU709;
+    case ImageDsp::BT2020: return SWS_CS_BT2020;
+    default: return SWS_CS_ITU601;
+    }
+}
+
+SwsContext *ImageConverter::context(int srcWidth, int srcHeight, AVPixelFormat srcFormat,
+                                    int dstWidth, int dstHeight, AVPixelFormat dstFormat, int flags,
+                                    const ColorSpace &colorSpace)
+{
+    if (m_context && srcWidth == m_srcWidth && srcHeight == m_srcHeight && srcFormat == m_srcFormat &&
+            dstWidth == m_dstWidth && dstHeight == m_dstHeight && dstFormat == m_dstFormat && flags == m_flags) {
+        //矩阵变化时只更新系数表，不重新创建
+        if (colorSpace != m_colorSpace) {
+            apply_color_space(m_context.get(), srcFormat, dstFormat, colorSpace);
+            m_colorSpace = colorSpace;
+        }
+        return m_context.get();
+    }
+
+    release();
+    m_context.reset(sws_getContext(srcWidth, srcHeight, srcFormat, dstWidth, dstHeight, dstFormat,
+                                   flags, nullptr, nullptr, nullptr));
+    if (!m_context) return nullptr;
+    apply_color_space(m_context.get(), srcFormat, dstFormat, colorSpace);
+
+    m_srcWidth = srcWidth;
+    m_srcHeight = srcHeight;
+    m_srcFormat = srcFormat;
+    m_dstWidth = dstWidth;
+    m_dstHeight = dstHeight;
+    m_dstFormat = dstFormat;
+    m_flags = flags;
+    m_colorSpace = colorSpace;
+    m_created++;
+
+    return m_context.get();
+}
+
+bool ImageConverter::convert(const AVFrame *frame, int width, int height, AVPixelFormat format,
+                             uint8_t *const dst[], const int dstStride[], int flags)
+{
+    if (width == frame->width && height == frame->height && canConvertDirect(AVPixelFormat(frame->format), format, flags) &&
+            convertDirect(frame, format, dst, dstStride, 0, frame->height))
+        return true;
+
+    SwsContext *swsContext = context(frame->width, frame->height, AVPixelFormat(frame->format),
+                                     width, height, format, flags, ColorSpace::of(frame));
+    if (!swsContext) return false;
+
+    TRACE_SCOPE("sws_scale");
+    return sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst, dstStride) > 0;
+}
+
+bool ImageConverter::convertDirect(const AVFrame *frame, AVPixelFormat format, uint8_t *const dst[], const int dstStride[],
+                                   int y, int height)
+{
+    if (!canConvertDirect(AVPixelFormat(frame->format), format, 0)) return false;
+
+    ImageDsp::RgbFormat rgbFormat = format == AV_PIX_FMT_RGB24 ? ImageDsp::RGB24 : ImageDsp::RGB32;
+    bool planar = frame->format != AV_PIX_FMT_NV12;
+    int chromaShift = frame->format == AV_PIX_FMT_YUV422P || frame->format == AV_PIX_FMT_YUVJ422P ? 0 : 1;
+
+    ColorSpace colorSpace = ColorSpace::of(frame);
+    ImageDsp::YuvCoefficients coefficients = ImageDsp::yuvCoefficients(colorSpace.matrix, colorSpace.fullRange);
+
+    TRACE_SCOPE("yuv_to_rgb");
+    for (int row = y; row < y + height; row++) {
+        const uint8_t *luma = frame->data[0] + row * frame->linesize[0];
+        int chroma = row >> chromaShift;
+        uint8_t *out = dst[0] + row * dstStride[0];
+        if (planar) {
+            ImageDsp::yuv420pToRgb(luma, frame->data[1] + chroma * frame->linesize[1], frame->data[2] + chroma * frame->linesize[2],
+                                   out, frame->width, coefficients, rgbFormat);
+        } else {
+            ImageDsp::nv12ToRgb(luma, frame->data[1] + chroma * frame->linesize[1], out, frame->width, coefficients, rgbFormat);
+        }
+    }
+
+    return true;
+}
+
+bool ImageConverter::canConvertDirect(AVPixelFormat srcFormat, AVPixelFormat dstFormat, int flags)
+{
+    //要求精确取整时交给 swscale
+    if (flags & (SWS_ACCURATE_RND | SWS_BITEXACT)) return false;
+    if (dstFormat != AV_PIX_FMT_RGB24 && dstFormat != AV_PIX_FMT_BGRA && dstFormat != AV_PIX_FMT_BGR0) return false;
+
+    switch (srcFormat) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_NV12:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void ImageConverter::release()
+{
+    m_context.reset();
+    m_srcFormat = m_dstFormat = AV_PIX_FMT_NONE;
+}
@@ -0,0 +1,81 @@
+#ifndef IMAGECONVERTER_H
+#define IMAGECONVERTER_H
+
+#include "avhandle.h"
+#include "imagedsp.h"
+
+/**
+ * @brief ColorSpace
+ * @note YUV -> RGB 使用的矩阵和范围：ImageDsp 的直接转换、swscale 和字幕混合都从这里取，同一个视频的颜色一致
+ *       未标明矩阵时按 BT.601(与 swscale 的默认值相同)，不按分辨率猜测
+ */
+struct ColorSpace
+{
+    ImageDsp::ColorMatrix matrix = ImageDsp::BT601;
+    bool fullRange = false;
+
+    static ColorSpace of(AVPixelFormat format, AVColorSpace colorspace, AVColorRange range);
+    static ColorSpace of(const AVFrame *frame);
+
+    //sws_getCoefficients() 的参数(SWS_CS_*)
+    int swsColorspace() const;
+
+    bool operator==(const ColorSpace &other) const { return matrix == other.matrix && fullRange == other.fullRange; }
+    bool operator!=(const ColorSpace &other) const { return !(*this == other); }
+};
+
+/**
+ * @brief ImageConverter
+ * @note 持有一个 SwsContext，源和目标的尺寸、格式不变时一直复用(sws_getCachedContext)，
+ *       避免每帧创建和释放，析构时自动释放
+ *       不缩放的 YUV420P / YUV422P / NV12 -> RGB24 / BGRA 不经过 swscale，直接由 ImageDsp 的 SIMD 实现逐行转换
+ */
+class ImageConverter
+{
+public:
+    ImageConverter() { }
+
+    ImageConverter(const ImageConverter &) = delete;
+    ImageConverter &operator=(const ImageConverter &) = delete;
+
+    /**
+     * @brief context
+     * @note YUV -> RGB 时按 colorSpace 设置 swscale 的矩阵和范围，与 convertDirect() 的结果一致
+     * @return 与参数对应的 SwsContext，参数与上次相同时不重新创建，失败返回nullptr
+     */
+    SwsContext *context(int srcWidth, int srcHeight, AVPixelFormat srcFormat,
+                        int dstWidth, int dstHeight, AVPixelFormat dstFormat, int flags = SWS_BILINEAR,
+                        const ColorSpace &colorSpace = ColorSpace());
+    /**
+     * @brief convert
+     * @note 把整帧转换(缩放)到 dst，flags 含 SWS_ACCURATE_RND / SWS_BITEXACT 时总是使用 swscale
+     */
+    bool convert(const AVFrame *frame, int width, int height, AVPixelFormat format,
+                 uint8_t *const dst[], const int dstStride[], int flags = SWS_BILINEAR);
+    void release();
+
+    /**
+     * @brief convertDirect
+     * @note 不缩放地用 ImageDsp 转换 [y, y + height) 行(y 须落在色度行的边界上)，矩阵和范围为 ColorSpace::of(frame)
+     * @return 格式不支持时返回false，不写入 dst
+     */
+    static bool convertDirect(const AVFrame *frame, AVPixelFormat format, uint8_t *const dst[], const int dstStride[],
+                              int y, int height);
+    /**
+     * @brief canConvertDirect
+     * @note convertDirect() 是否支持这组格式和 flags；支持时每一行输出只依赖同一行的亮度和对应的色度行
+     */
+    static bool canConvertDirect(AVPixelFormat srcFormat, AVPixelFormat dstFormat, int flags);
+
+    //创建 SwsContext 的次数，用于确认复用是否生效
+    int created() const { return m_created; }
+
+private:
+    SwsContextPtr m_context;
+    int m_srcWidth = 0, m_srcHeight = 0, m_dstWidth = 0, m_dstHeight = 0, m_flags = 0;
+    AVPixelFormat m_srcFormat = AV_PIX_FMT_NONE, m_dstFormat = AV_PIX_FMT_NONE;
+    ColorSpace m_colorSpace;
+    int m_created = 0;
+};
+
+#endif // IMAGECONVERTER_H
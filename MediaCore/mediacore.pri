@@ -0,0 +1,17 @@
+# 使用 MediaCore 的程序在链接 FFmpeg 之前 include 本文件(静态库必须排在它依赖的库前面)
+
+INCLUDEPATH += $$PWD
+
+CONFIG(debug, debug|release) {
+    MEDIACORE_NAME = MediaCored
+} else {
+    MEDIACORE_NAME = MediaCore
+}
+
+LIBS += -L$$PWD/lib -l$$MEDIACORE_NAME
+
+win32-msvc* {
+    PRE_TARGETDEPS += $$PWD/lib/$${MEDIACORE_NAME}.lib
+} else {
+    PRE_TARGETDEPS += $$PWD/lib/lib$${MEDIACORE_NAME}.a
+}
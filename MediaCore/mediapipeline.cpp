@@ -0,0 +1,114 @@
+#include "mediapipeline.h"
+#include "tracing.h"
+
+#include <chrono>
+
+namespace
+{
+
+inline int64_t elapsed_ns(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} //namespace
+
+void MediaPipeline::addDecoder(StreamDecoder *decoder)
+{
+    if (decoder && decoder->isOpen()) route(decoder->streamIndex()).decoder = decoder;
+}
+
+void MediaPipeline::addStage(int streamIndex, const FrameStage &stage)
+{
+    if (streamIndex >= 0) route(streamIndex).stages.push_back(stage);
+}
+
+void MediaPipeline::addPacketStage(int streamIndex, const PacketStage &stage)
+{
+    if (streamIndex >= 0) route(streamIndex).packetStages.push_back(stage);
+}
+
+void MediaPipeline::clear()
+{
+    m_routes.clear();
+    m_statistics = Statistics { 0, 0, 0, 0 };
+}
+
+int MediaPipeline::run(MediaSource &source, const std::atomic_bool &runnable)
+{
+    m_stopped = false;
+    m_error = 0;
+
+    std::vector<int> streams;
+    for (size_t i = 0; i < m_routes.size(); i++) {
+        if (m_routes[i].decoder || !m_routes[i].packetStages.empty()) streams.push_back(int(i));
+    }
+    source.keepStreams(streams);
+
+    AVPacketPtr packet = makePacket();
+    if (!packet) return AVERROR(ENOMEM);
+
+    int ret = 0;
+    while (runnable && !m_stopped) {
+        auto begin = std::chrono::steady_clock::now();
+        //读取出错和读完一样处理，已读到的部分照常输出
+        {
+            TRACE_SCOPE("read");
+            if (source.read(packet.get()) < 0) break;
+        }
+        m_statistics.readTime += elapsed_ns(begin);
+
+        if (packet->stream_index >= 0 && packet->stream_index < int(m_routes.size())) {
+            m_statistics.packets++;
+            Route &current = m_routes[size_t(packet->stream_index)];
+            for (const PacketStage &stage : current.packetStages) stage(packet.get());
+            if (current.decoder) ret = decode(current, packet.get());
+        }
+
+        //处理函数主动停止时 decode() 返回 AVERROR_EXIT；损坏的包跳过，继续解码后面的包
+        if (ret == AVERROR_EXIT) break;
+        else if (ret < 0) av_log(nullptr, AV_LOG_WARNING, "MediaPipeline: skip packet of stream %d, error %d\n", packet->stream_index, ret);
+        ret = 0;
+        av_packet_unref(packet.get());
+    }
+
+    if (ret != AVERROR_EXIT && runnable && !m_stopped) {
+        for (Route &current : m_routes) {
+            if (!current.decoder) continue;
+
+            //一路冲刷出错不影响其他流
+            ret = decode(current, nullptr);
+            if (ret == AVERROR_EXIT) break;
+            else if (ret < 0) av_log(nullptr, AV_LOG_WARNING, "MediaPipeline: flush decoder of stream %d, error %d\n", current.decoder->streamIndex(), ret);
+        }
+    }
+
+    return m_stopped ? m_error : 0;
+}
+
+void MediaPipeline::stop(int error)
+{
+    m_stopped = true;
+    m_error = error;
+}
+
+MediaPipeline::Route &MediaPipeline::route(int streamIndex)
+{
+    if (streamIndex >= int(m_routes.size())) m_routes.resize(size_t(streamIndex) + 1);
+    return m_routes[size_t(streamIndex)];
+}
+
+int MediaPipeline::decode(Route &route, const AVPacket *packet)
+{
+    auto begin = std::chrono::steady_clock::now();
+    int ret = route.decoder->decode(packet, [this, &route](AVFrame *frame) {
+        m_statistics.frames++;
+        for (const FrameStage &stage : route.stages) {
+            if (!stage(frame)) break;
+        }
+        return !m_stopped;
+    });
+    m_statistics.decodeTime += elapsed_ns(begin);
+
+    return ret;
+}
@@ -0,0 +1,72 @@
+#ifndef MEDIAPIPELINE_H
+#define MEDIAPIPELINE_H
+
+#include "mediasource.h"
+#include "streamdecoder.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief MediaPipeline
+ * @note 读取 -> 按流分发 -> 解码 -> 逐级处理
+ *       每个流可以挂一个解码器和若干帧处理函数(stage)，按加入顺序依次调用，
+ *       某一级返回false时这一帧不再往后传；不由流水线解码的流(如字幕)可以挂包处理函数
+ *       没有挂任何东西的流在解封装层丢弃
+ */
+class MediaPipeline
+{
+public:
+    //返回false时丢弃这一帧(不再交给后面的处理函数)
+    typedef std::function<bool(AVFrame *frame)> FrameStage;
+    typedef std::function<void(AVPacket *packet)> PacketStage;
+
+    struct Statistics
+    {
+        int64_t packets;
+        int64_t frames;
+        //读取(解封装)和解码(含各级处理)的耗时，纳秒
+        int64_t readTime;
+        int64_t decodeTime;
+    };
+
+    void addDecoder(StreamDecoder *decoder);
+    void addStage(int streamIndex, const FrameStage &stage);
+    void addPacketStage(int streamIndex, const PacketStage &stage);
+    void clear();
+
+    /**
+     * @brief run
+     * @note 在调用线程中读完整个输入，正常读完时冲刷所有解码器，取出缓存的最后几帧
+     *       解码出错的包记录日志后跳过；runnable 变为false或调用 stop() 后尽快返回
+     * @return 正常结束返回0，被 stop(error) 停止时返回 error
+     */
+    int run(MediaSource &source, const std::atomic_bool &runnable);
+    /**
+     * @brief stop
+     * @note 在处理函数中调用，error 不为0时 run() 返回它
+     */
+    void stop(int error = 0);
+
+    Statistics statistics() const { return m_statistics; }
+
+private:
+    struct Route
+    {
+        StreamDecoder *decoder = nullptr;
+        std::vector<FrameStage> stages;
+        std::vector<PacketStage> packetStages;
+    };
+
+    Route &route(int streamIndex);
+    int decode(Route &route, const AVPacket *packet);
+
+    std::vector<Route> m_routes;
+    bool m_stopped = false;
+    int m_error = 0;
+    Statistics m_statistics { 0, 0, 0, 0 };
+};
+
+#endif // MEDIAPIPELINE_H
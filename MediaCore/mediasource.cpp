@@ -0,0 +1,71 @@
+#include "mediasource.h"
+
+#include <algorithm>
+#include <cstdio>
+
+bool MediaSource::open(const std::string &url, bool probe)
+{
+    close();
+
+    m_context = openInput(url.c_str());
+    if (!m_context) return false;
+
+    //mkv / mp4 等容器的头中已有全部参数，跳过探测可以省掉开头的解码
+    for (unsigned i = 0; i < m_context->nb_streams && !probe; i++) {
+        const AVCodecParameters *codecpar = m_context->streams[i]->codecpar;
+        if (codecpar->codec_id == AV_CODEC_ID_NONE ||
+                (codecpar->codec_type == AVMEDIA_TYPE_VIDEO && (codecpar->width <= 0 || codecpar->format < 0)) ||
+                (codecpar->codec_type == AVMEDIA_TYPE_AUDIO && (codecpar->sample_rate <= 0 || codecpar->format < 0)))
+            probe = true;
+    }
+    if (probe || m_context->nb_streams == 0) avformat_find_stream_info(m_context.get(), nullptr);
+
+    return true;
+}
+
+void MediaSource::close()
+{
+    m_context.reset();
+}
+
+int MediaSource::streamCount() const
+{
+    return m_context ? int(m_context->nb_streams) : 0;
+}
+
+AVStream *MediaSource::stream(int index) const
+{
+    return index >= 0 && index < streamCount() ? m_context->streams[index] : nullptr;
+}
+
+int MediaSource::findStream(AVMediaType type, int related) const
+{
+    if (!m_context) return AVERROR_STREAM_NOT_FOUND;
+    return av_find_best_stream(m_context.get(), type, -1, related, nullptr, 0);
+}
+
+void MediaSource::keepStreams(const std::vector<int> &indexes)
+{
+    for (int i = 0; i < streamCount(); i++) {
+        bool keep = std::find(indexes.begin(), indexes.end(), i) != indexes.end();
+        m_context->streams[i]->discard = keep ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+}
+
+double MediaSource::duration() const
+{
+    return m_context && m_context->duration > 0 ? m_context->duration / double(AV_TIME_BASE) : 0.0;
+}
+
+void MediaSource::dump() const
+{
+    if (!m_context) return;
+
+    av_dump_format(m_context.get(), 0, "format", 0);
+    std::fflush(stderr);
+}
+
+int MediaSource::read(AVPacket *packet)
+{
+    return m_context ? av_read_frame(m_context.get(), packet) : AVERROR(EINVAL);
+}
@@ -0,0 +1,55 @@
+#ifndef MEDIASOURCE_H
+#define MEDIASOURCE_H
+
+#include "avhandle.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief MediaSource
+ * @note 输入文件的格式上下文，析构时自动关闭
+ */
+class MediaSource
+{
+public:
+    MediaSource() { }
+
+    MediaSource(const MediaSource &) = delete;
+    MediaSource &operator=(const MediaSource &) = delete;
+
+    /**
+     * @brief open
+     * @param probe 为true时总是探测流信息(会读取并解码开头的数据)，
+     *        为false时只在头中没有流或缺少编码参数时才探测
+     */
+    bool open(const std::string &url, bool probe = true);
+    void close();
+    bool isOpen() const { return m_context != nullptr; }
+
+    AVFormatContext *context() const { return m_context.get(); }
+    int streamCount() const;
+    AVStream *stream(int index) const;
+    /**
+     * @brief findStream
+     * @return 某类型的最佳流(av_find_best_stream)，没有时返回负数
+     */
+    int findStream(AVMediaType type, int related = -1) const;
+    /**
+     * @brief keepStreams
+     * @note 只读取 indexes 中的流，其余流的包在解封装层就丢弃
+     */
+    void keepStreams(const std::vector<int> &indexes);
+
+    //秒，未知时为0
+    double duration() const;
+    //打印格式信息到 stderr
+    void dump() const;
+
+    int read(AVPacket *packet);
+
+private:
+    AVFormatInputPtr m_context;
+};
+
+#endif // MEDIASOURCE_H
@@ -0,0 +1,75 @@
+#include "parallelimageconverter.h"
+#include "threadpool.h"
+
+#include <algorithm>
+
+ParallelImageConverter::ParallelImageConverter(int bands, ThreadPool *pool)
+    : m_pool(pool ? pool : &ThreadPool::instance())
+{
+    m_maxBands = bands > 0 ? bands : m_pool->threadCount();
+}
+
+ParallelImageConverter::~ParallelImageConverter()
+{
+
+}
+
+bool ParallelImageConverter::convert(const AVFrame *frame, int width, int height, AVPixelFormat format,
+                                     uint8_t *const dst[], const int dstStride[], int flags)
+{
+    m_lastBands = 1;
+    if (!plan(frame, width, height, format, flags))
+        return m_whole.convert(frame, width, height, format, dst, dstStride, flags);
+
+    m_lastBands = int(m_bands.size());
+    return convert_bands(frame, format, dst, dstStride);
+}
+
+void ParallelImageConverter::release()
+{
+    m_whole.release();
+    m_bands.clear();
+}
+
+bool ParallelImageConverter::plan(const AVFrame *frame, int width, int height, AVPixelFormat format, int flags)
+{
+    //只有逐行独立的直接转换可以切开
+    if (width != frame->width || height != frame->height) return false;
+    if (!ImageConverter::canConvertDirect(AVPixelFormat(frame->format), format, flags)) return false;
+    if (m_pool->currentWorker() >= 0) return false;
+
+    int count = std::min(m_maxBands, height / MinBandHeight);
+    if (count < 2) return false;
+    if (int(m_bands.size()) == count && m_bands.back().y + m_bands.back().height == height) return true;
+
+    //条带起点落在色度行(两行)的边界上
+    int bandHeight = height / count & ~1;
+    m_bands.clear();
+    for (int i = 0; i < count; i++) {
+        int y = i * bandHeight;
+        m_bands.push_back(Band { y, i == count - 1 ? height - y : bandHeight });
+    }
+
+    return true;
+}
+
+bool ParallelImageConverter::convert_bands(const AVFrame *frame, AVPixelFormat format,
+                                           uint8_t *const dst[], const int dstStride[])
+{
+    int count = int(m_bands.size());
+    std::vector<char> results(count, 0);
+    TaskGroup group(*m_pool);
+
+    auto convert_band = [&](int i) {
+        results[i] = ImageConverter::convertDirect(frame, format, dst, dstStride, m_bands[i].y, m_bands[i].height);
+    };
+
+    //第一个条带在调用线程中转换，其余的交给线程池(高优先级，排在其他任务之前)
+    for (int i = 1; i < count; i++) {
+        group.submit([&, i]() { convert_band(i); }, ThreadPool::High);
+    }
+    convert_band(0);
+    group.wait();
+
+    return std::find(results.begin(), results.end(), 0) == results.end();
+}
@@ -0,0 +1,58 @@
+#ifndef PARALLELIMAGECONVERTER_H
+#define PARALLELIMAGECONVERTER_H
+
+#include "imageconverter.h"
+
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * @brief ParallelImageConverter
+ * @note 不缩放、且 ImageConverter::convertDirect() 支持的转换(8 位 YUV420P/422P/NV12 -> RGB24/RGB32)
+ *       按水平条带分给线程池同时进行：这条路径逐行独立，条带的结果与整帧转换逐字节相同
+ *       swscale 的滤波会跨行取样，条带边界处结果不同，所以其他转换、帧太矮，
+ *       或在线程池的工作线程中调用(已经按帧并行，避免嵌套等待)时都按整帧转换
+ */
+class ParallelImageConverter
+{
+public:
+    //每个条带至少的行数，再少线程切换的开销就超过收益了
+    static const int MinBandHeight = 128;
+
+    /**
+     * @param bands 最多的条带数，0 为线程池的线程数
+     * @param pool 为nullptr时使用 ThreadPool::instance()
+     */
+    explicit ParallelImageConverter(int bands = 0, ThreadPool *pool = nullptr);
+    ~ParallelImageConverter();
+
+    ParallelImageConverter(const ParallelImageConverter &) = delete;
+    ParallelImageConverter &operator=(const ParallelImageConverter &) = delete;
+
+    //与 ImageConverter::convert() 相同，输出逐字节一致
+    bool convert(const AVFrame *frame, int width, int height, AVPixelFormat format,
+                 uint8_t *const dst[], const int dstStride[], int flags = SWS_BILINEAR);
+    void release();
+
+    //上一帧使用的条带数，1 表示按整帧转换
+    int lastBands() const { return m_lastBands; }
+
+private:
+    struct Band
+    {
+        int y;
+        int height;
+    };
+
+    bool plan(const AVFrame *frame, int width, int height, AVPixelFormat format, int flags);
+    bool convert_bands(const AVFrame *frame, AVPixelFormat format, uint8_t *const dst[], const int dstStride[]);
+
+    ThreadPool *m_pool;
+    int m_maxBands;
+    ImageConverter m_whole;
+    std::vector<Band> m_bands;
+    int m_lastBands = 1;
+};
+
+#endif // PARALLELIMAGECONVERTER_H
@@ -0,0 +1,90 @@
+#include "streamdecoder.h"
+#include "tracing.h"
+
+bool StreamDecoder::open(const AVStream *stream, int threads)
+{
+    close();
+    if (!stream) return false;
+
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) return false;
+
+    m_context.reset(avcodec_alloc_context3(codec));
+    m_frame = makeFrame();
+    if (!m_context || !m_frame || avcodec_parameters_to_context(m_context.get(), stream->codecpar) < 0) {
+        close();
+        return false;
+    }
+    m_context->pkt_timebase = stream->time_base;
+    m_context->thread_count = threads;
+
+    if (avcodec_open2(m_context.get(), codec, nullptr) < 0) {
+        close();
+        return false;
+    }
+    m_streamIndex = stream->index;
+    m_timeBase = stream->time_base;
+
+    return true;
+}
+
+void StreamDecoder::close()
+{
+    m_context.reset();
+    m_frame.reset();
+    m_streamIndex = -1;
+    m_timeBase = AVRational{ 0, 1 };
+}
+
+int StreamDecoder::decode(const AVPacket *packet, const FrameHandler &handler)
+{
+    if (!m_context) return AVERROR(EINVAL);
+
+    //一个包解出多帧时，后面的帧从上一帧的回调返回时算起
+    bool measure = m_decodeTime && Metrics::isEnabled();
+    int64_t begin = measure ? Metrics::now() : 0;
+
+    //冲刷后解码器返回 EOF，这里不当作错误
+    int ret;
+    {
+        TRACE_SCOPE("send_packet");
+        ret = avcodec_send_packet(m_context.get(), packet);
+    }
+    if (ret < 0 && ret != AVERROR_EOF) return ret;
+
+    int frames = 0;
+    while (true) {
+        {
+            TRACE_SCOPE("receive_frame");
+            ret = avcodec_receive_frame(m_context.get(), m_frame.get());
+        }
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
+        else if (ret < 0) return ret;
+
+        if (measure) {
+            m_decodeTime->record(Metrics::now() - begin);
+            m_decodedFrames->add();
+        }
+
+        if (m_frame->best_effort_timestamp != AV_NOPTS_VALUE) m_frame->pts = m_frame->best_effort_timestamp;
+        frames++;
+        bool next = handler(m_frame.get());
+        av_frame_unref(m_frame.get());
+        if (!next) return AVERROR_EXIT;
+        //回调(过滤、转换、入队)的时间不算在解码内
+        if (measure) begin = Metrics::now();
+    }
+
+    return frames;
+}
+
+void StreamDecoder::reset()
+{
+    if (m_context) avcodec_flush_buffers(m_context.get());
+}
+
+void StreamDecoder::setMetricsName(const std::string &name)
+{
+    m_decodeTime = name.empty() ? nullptr : Metrics::histogram(name + ".decode_time");
+    m_decodedFrames = name.empty() ? nullptr : Metrics::counter(name + ".frames");
+}
@@ -0,0 +1,64 @@
+#ifndef STREAMDECODER_H
+#define STREAMDECODER_H
+
+#include "avhandle.h"
+#include "metrics.h"
+
+#include <functional>
+#include <string>
+
+/**
+ * @brief StreamDecoder
+ * @note 一个流的解码器上下文，析构时自动释放
+ *       解码出的帧复用同一个 AVFrame，交给回调后 unref
+ */
+class StreamDecoder
+{
+public:
+    //返回false时停止取帧，decode() 返回 AVERROR_EXIT
+    typedef std::function<bool(AVFrame *frame)> FrameHandler;
+
+    StreamDecoder() { }
+
+    StreamDecoder(const StreamDecoder &) = delete;
+    StreamDecoder &operator=(const StreamDecoder &) = delete;
+
+    /**
+     * @brief open
+     * @note 查找解码器、复制流参数并打开，包的时间基同时设为流的时间基(字幕按它换算显示时间)
+     * @param threads 解码线程数，0 为自动
+     */
+    bool open(const AVStream *stream, int threads = 0);
+    void close();
+    bool isOpen() const { return m_context != nullptr; }
+
+    AVCodecContext *context() const { return m_context.get(); }
+    int streamIndex() const { return m_streamIndex; }
+    AVRational timeBase() const { return m_timeBase; }
+
+    /**
+     * @brief decode
+     * @note 送入一个包(nullptr 为冲刷)并取出所有已解码的帧，
+     *       帧的 pts 换成 best_effort_timestamp(有时)，时间基为流的时间基
+     * @return 取出的帧数，出错时返回负数
+     */
+    int decode(const AVPacket *packet, const FrameHandler &handler);
+    //冲刷后必须调用才能继续解码(如跳转后)
+    void reset();
+
+    /**
+     * @brief setMetricsName
+     * @note 登记 <name>.decode_time(每帧解码耗时，从送包开始到取出该帧)和 <name>.frames
+     */
+    void setMetricsName(const std::string &name);
+
+private:
+    AVCodecContextPtr m_context;
+    AVFramePtr m_frame;
+    int m_streamIndex = -1;
+    AVRational m_timeBase = { 0, 1 };
+    Histogram *m_decodeTime = nullptr;
+    Counter *m_decodedFrames = nullptr;
+};
+
+#endif // STREAMDECODER_H
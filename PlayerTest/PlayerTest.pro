@@ -0,0 +1,63 @@
+#-------------------------------------------------
+#
+# Project created by QtCreator 2019-09-03T12:14:21
+#
+#-------------------------------------------------
+
+QT       += gui multimedia
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = PlayerTest
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../ffmpeg/include \
+        $$PWD/../Utility
+
+include($$PWD/../MediaCore/mediacore.pri)
+
+LIBS += -L$$PWD/../ffmpeg/lib/ -lavcodec -lavformat -lavutil -lswscale -lswresample
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which has been marked as deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+# You can also make your code fail to compile if you use deprecated APIs.
+# In order to do so, uncomment the following line.
+# You can also select to disable deprecated APIs only up to a certain version of Qt.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+CONFIG += c++11 debug_and_release
+
+# qmake CONFIG+=tracing 打开热路径追踪(TRACE_* 宏)，否则宏展开为空
+tracing: DEFINES += ENABLE_TRACING
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$shell_path(./debug)
+} else {
+    DESTDIR = $$shell_path(./release)
+}
+
+win32 {
+    ffmpeg_dll = $$shell_path($$PWD/../ffmpeg/dll)
+    QMAKE_POST_LINK = \
+        copy $$ffmpeg_dll $$DESTDIR
+}
+
+HEADERS += \
+        src/demuxer.h \
+        src/mainwindow.h \
+        src/player.h
+
+SOURCES += \
+        src/demuxer.cpp \
+        src/main.cpp \
+        src/mainwindow.cpp \
+        src/player.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,180 @@
+#include "demuxer.h"
+#include "tracing.h"
+
+#include <QDebug>
+
+Demuxer::Demuxer(QObject *parent)
+    : QThread (parent)
+{
+    for (Output &output : m_outputs) {
+        output.index = -1;
+        output.queue = nullptr;
+    }
+}
+
+Demuxer::~Demuxer()
+{
+    close();
+}
+
+bool Demuxer::open(const QString &filename)
+{
+    close();
+
+    m_formatContext = openInput(filename.toStdString().c_str());
+    if (!m_formatContext) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return false;
+    }
+    avformat_find_stream_info(m_formatContext.get(), nullptr);
+
+    //打印相关信息
+    av_dump_format(m_formatContext.get(), 0, "format", 0);
+    fflush(stderr);
+
+    for (int type = 0; type < AVMEDIA_TYPE_NB; type++)
+        m_outputs[type].index = av_find_best_stream(m_formatContext.get(), AVMediaType(type), -1, -1, nullptr, 0);
+    m_packetsRead = m_bytesRead = 0;
+    m_runnable = true;
+
+    return true;
+}
+
+void Demuxer::abort()
+{
+    requestStop();
+
+    //队列由解码线程创建和释放，加锁防止同时被 close() 删除
+    QMutexLocker locker(&m_mutex);
+    drain_queues();
+    //解码端可能正阻塞在空队列上；读取线程随后也会送结束标记，解码端收到第一个即退出
+    for (Output &output : m_outputs) {
+        if (output.queue) output.queue->tryEnqueue(nullptr);
+    }
+}
+
+void Demuxer::stop()
+{
+    requestStop();
+    //读取线程可能阻塞在满队列的 enqueue 上，腾出空位即被唤醒，随后看到停止标记退出
+    drain_queues();
+    wait();
+}
+
+void Demuxer::close()
+{
+    stop();
+    clear_queues();
+
+    QMutexLocker locker(&m_mutex);
+    for (Output &output : m_outputs) {
+        delete output.queue;
+        output.index = -1;
+        output.queue = nullptr;
+    }
+
+    m_formatContext.reset();
+}
+
+bool Demuxer::seek(qreal seconds)
+{
+    if (!m_formatContext) return false;
+
+    //不指定流时以 AV_TIME_BASE 为单位，max_ts 为目标时间保证不会跳过目标
+    int64_t timestamp = int64_t(seconds * AV_TIME_BASE);
+    if (avformat_seek_file(m_formatContext.get(), -1, INT64_MIN, timestamp, timestamp, 0) < 0) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return false;
+    }
+
+    return true;
+}
+
+AVStream *Demuxer::stream(AVMediaType type) const
+{
+    int index = m_outputs[type].index;
+    return index >= 0 ? m_formatContext->streams[index] : nullptr;
+}
+
+PacketQueue *Demuxer::enable(AVMediaType type, int capacity)
+{
+    Output &output = m_outputs[type];
+    if (output.index < 0) return nullptr;
+
+    QMutexLocker locker(&m_mutex);
+    if (!output.queue) {
+        output.queue = new PacketQueue(capacity);
+        output.queue->monitor().setMetricsName(std::string("demux.") + av_get_media_type_string(type));
+    }
+    return output.queue;
+}
+
+void Demuxer::run()
+{
+    TRACE_THREAD_NAME("Demuxer");
+    //未启用的流交给 libavformat 直接丢弃，能省掉部分解析
+    for (unsigned i = 0; i < m_formatContext->nb_streams; i++)
+        m_formatContext->streams[i]->discard = AVDISCARD_ALL;
+
+    std::vector<PacketQueue *> queues(m_formatContext->nb_streams, nullptr);
+    for (const Output &output : m_outputs) {
+        if (output.queue) {
+            m_formatContext->streams[output.index]->discard = AVDISCARD_DEFAULT;
+            queues[output.index] = output.queue;
+        }
+    }
+
+    //未送入队列的包(被丢弃或被停止)离开作用域时释放
+    while (m_runnable) {
+        AVPacketPtr packet = makePacket();
+        {
+            TRACE_SCOPE("read");
+            if (!packet || av_read_frame(m_formatContext.get(), packet.get()) < 0) break;
+        }
+
+        PacketQueue *queue = packet->stream_index < int(queues.size()) ? queues[packet->stream_index] : nullptr;
+        if (!queue) continue;
+
+        m_packetsRead++;
+        m_bytesRead += packet->size;
+        if (!push(queue, packet)) break;
+    }
+
+    //发送结束标记：正常读完时等待队列有空位，被停止时队列已满说明解码端并未阻塞，不必再发
+    for (const Output &output : m_outputs) {
+        if (!output.queue) continue;
+
+        AVPacketPtr end;
+        if (!push(output.queue, end)) output.queue->tryEnqueue(nullptr);
+    }
+}
+
+bool Demuxer::push(PacketQueue *queue, AVPacketPtr &packet)
+{
+    if (!m_runnable) return false;
+
+    //队列满时阻塞(背压)，解码端跟不上时自然减慢读取；abort()/stop() 清空队列时被唤醒
+    //成功入队后所有权交给解码端
+    queue->enqueue(packet.release());
+    return true;
+}
+
+void Demuxer::drain_queues()
+{
+    for (Output &output : m_outputs) {
+        if (!output.queue) continue;
+
+        AVPacket *packet;
+        while (output.queue->tryDequeue(packet))
+            AVPacketPtr release(packet);
+    }
+}
+
+void Demuxer::clear_queues()
+{
+    //读取线程已结束，可以重置
+    drain_queues();
+    for (Output &output : m_outputs) {
+        if (output.queue) output.queue->monitor().reset();
+    }
+}
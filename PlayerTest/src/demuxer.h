@@ -0,0 +1,97 @@
+#ifndef DEMUXER_H
+#define DEMUXER_H
+
+#include "avhandle.h"
+#include "meteredqueue.h"
+
+#include <QMutex>
+#include <QThread>
+
+//nullptr 表示流结束，解码端收到后应冲刷解码器；出队的一方负责释放包
+//停止时 abort() 会在其他线程清空队列并送入结束标记，所以不是单生产者单消费者，用 MpmcQueue
+typedef MeteredMpmcQueue<AVPacket *> PacketQueue;
+
+/**
+ * @brief Demuxer
+ * @note 只打开一次输入，由一个读取线程把包分发到各个流的包队列
+ *       队列有容量上限，满了读取线程会阻塞(背压)，未启用的流直接丢弃
+ */
+class Demuxer : public QThread
+{
+    Q_OBJECT
+
+public:
+    Demuxer(QObject *parent = nullptr);
+    ~Demuxer();
+
+    /**
+     * @brief open
+     * @note 在调用线程中打开并探测输入，之后才能 enable()/start()
+     */
+    bool open(const QString &filename);
+    /**
+     * @brief requestStop
+     * @note 只设置标记不等待，可以在任意线程调用
+     *       读取线程退出时会向每个队列发送结束标记以唤醒解码端
+     */
+    void requestStop() { m_runnable = false; }
+    /**
+     * @brief abort
+     * @note 设置停止标记，清空各个队列并送入结束标记，不等待，可以在任意线程调用
+     *       阻塞在满队列上的读取线程和阻塞在空队列上的解码端都会被唤醒
+     */
+    void abort();
+    /**
+     * @brief stop
+     * @note 取走队列中的包以唤醒阻塞在满队列上的读取线程，并等待它结束
+     */
+    void stop();
+    /**
+     * @brief close
+     * @note 释放队列中剩余的包和格式上下文，必须在所有解码端退出后调用
+     */
+    void close();
+
+    /**
+     * @brief seek
+     * @note 跳到 seconds(绝对时间戳，秒)之前最近的关键帧，必须在 start() 之前调用
+     */
+    bool seek(qreal seconds);
+
+    AVFormatContext *formatContext() const { return m_formatContext.get(); }
+    AVStream *stream(AVMediaType type) const;
+
+    /**
+     * @brief enable
+     * @note 启用某类型的最佳流，必须在 start() 之前调用
+     * @return 对应的包队列，没有该类型的流时返回nullptr
+     */
+    PacketQueue *enable(AVMediaType type, int capacity);
+
+    qint64 packetsRead() const { return m_packetsRead.load(); }
+    qint64 bytesRead() const { return m_bytesRead.load(); }
+
+protected:
+    void run();
+
+private:
+    bool push(PacketQueue *queue, AVPacketPtr &packet);
+    void drain_queues();
+    void clear_queues();
+
+    struct Output
+    {
+        int index;
+        PacketQueue *queue;
+    };
+
+    std::atomic_bool m_runnable { true };
+    //保护队列的创建和释放，abort() 可能在其他线程调用
+    QMutex m_mutex;
+    AVFormatInputPtr m_formatContext;
+    Output m_outputs[AVMEDIA_TYPE_NB];
+    std::atomic<qint64> m_packetsRead { 0 };
+    std::atomic<qint64> m_bytesRead { 0 };
+};
+
+#endif // DEMUXER_H
@@ -0,0 +1,29 @@
+#include "mainwindow.h"
+#include "metrics.h"
+#include <QApplication>
+
+//用法: PlayerTest [--start 秒] [文件...]，不带文件时拖入播放
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    //METRICS_INTERVAL=秒 时打开运行指标，定期输出到 stderr
+    MetricsReporter metrics;
+    metrics.startFromEnvironment();
+
+    QStringList arguments = QApplication::arguments();
+    QStringList files;
+    qreal start = 0.0;
+
+    for (int i = 1; i < arguments.size(); i++) {
+        if (arguments.at(i) == "--start" && i + 1 < arguments.size())
+            start = arguments.at(++i).toDouble();
+        else
+            files.append(arguments.at(i));
+    }
+
+    MainWindow window;
+    window.show();
+    window.open(files, start);
+
+    return app.exec();
+}
@@ -0,0 +1,322 @@
+#include "mainwindow.h"
+#include "tracing.h"
+
+#include <QApplication>
+#include <QAudioOutput>
+#include <QDateTime>
+#include <QDropEvent>
+#include <QHBoxLayout>
+#include <QMimeData>
+#include <QPushButton>
+#include <QPainter>
+#include <QScreen>
+#include <QShortcut>
+#include <QTimer>
+#include <QDebug>
+
+#include <utility>
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+{
+    QSize size = (qApp->primaryScreen()->size() - QSize(600, 500)) / 2;
+    setGeometry(size.width(), size.height(), 600, 500);
+    setAcceptDrops(true);
+
+#ifdef ENABLE_TRACING
+    //F12 导出追踪数据(Chrome trace JSON)，拖进 Perfetto 查看
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        QString filename = QDateTime::currentDateTime().toString("'trace_'yyyyMMdd_hhmmss'.json'");
+        qDebug() << "[Trace:" << filename << (Tracing::dump(filename.toStdString()) ? "]" : "failed]");
+    });
+#endif
+    TRACE_THREAD_NAME("GUI");
+
+    QWidget *widget = new QWidget(this);
+    widget->setFixedSize(200, 50);
+    QHBoxLayout *layout = new QHBoxLayout(widget);
+    m_suspendButton = new QPushButton("暂停");
+    m_resumeButton = new QPushButton("继续");
+    m_suspendButton->setFixedHeight(40);
+    m_resumeButton->setFixedHeight(40);
+    connect(m_suspendButton, &QPushButton::clicked, this, [this]() {
+        m_timer->stop();
+        m_clock.pause();
+        if (m_output) m_output->suspend();
+    });
+    connect(m_resumeButton, &QPushButton::clicked, this, [this]() {
+        if (m_output) m_output->resume();
+        m_clock.resume();
+        m_timer->start();
+    });
+    layout->addWidget(m_suspendButton);
+    layout->addWidget(m_resumeButton);
+    widget->setLayout(layout);
+    setCentralWidget(widget);
+
+    //音频写入和视频调度共用一个定时器，间隔需明显小于帧间隔
+    m_timer = new QTimer(this);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, [this](){
+        feed_audio();
+        present_video();
+        check_finished();
+    });
+
+    m_decoder = new AVDecoder(this);
+    m_preloader = new AVDecoder(this);
+    watch_decoder(m_decoder);
+    watch_decoder(m_preloader);
+}
+
+MainWindow::~MainWindow()
+{
+
+}
+
+void MainWindow::watch_decoder(AVDecoder *decoder)
+{
+    //两个解码器会互换角色，只响应当前正在等待打开的那个
+    connect(decoder, &AVDecoder::resolved, this, [this, decoder]() {
+        if (decoder != m_decoder || !m_waitingResolved) return;
+        m_waitingResolved = false;
+
+        m_currentFrame = m_nextFrame = VideoFrame();
+        m_pendingAudio.clear();
+        setup_audio();
+        m_scheduler.reset(m_decoder->hasVideo() ? 1.0 / m_decoder->fps() : 0.0);
+        setup_video();
+        preload_next();
+        m_timer->start(5);
+    });
+    connect(decoder, &AVDecoder::finish, this, [this, decoder]() {
+        //打开失败时不会发出resolved，直接播放下一项
+        if (decoder == m_decoder && m_waitingResolved && m_playlistIndex + 1 < m_playlist.size())
+            open_item(m_playlistIndex + 1);
+    });
+}
+
+void MainWindow::open(const QStringList &files, qreal position)
+{
+    if (files.isEmpty()) return;
+
+    m_playlist = files;
+    open_item(0, position);
+}
+
+void MainWindow::open_item(int index, qreal position)
+{
+    m_timer->stop();
+    m_preloader->stop();
+    m_playlistIndex = index;
+    m_ptsOffset = m_timelineEnd = 0.0;
+    m_waitingResolved = true;
+    m_decoder->open(m_playlist.at(index), position);
+}
+
+void MainWindow::preload_next()
+{
+    //提前打开下一项，解码线程会在帧队列填满后阻塞，相当于预解码了开头的帧
+    if (m_playlistIndex + 1 < m_playlist.size())
+        m_preloader->open(m_playlist.at(m_playlistIndex + 1));
+}
+
+bool MainWindow::switch_to_next()
+{
+    if (m_playlistIndex + 1 >= m_playlist.size()) return false;
+
+    if (!m_preloader->isResolved()) {
+        //仍在探测则下次再试，打开失败则跳过这一项
+        if (m_preloader->isFinished()) {
+            qDebug() << "Skip:" << m_playlist.at(m_playlistIndex + 1);
+            m_playlistIndex++;
+            preload_next();
+        }
+        return true;
+    }
+
+    //音频格式相同时沿用同一个输出，否则要等旧的数据播放完再重建
+    bool sameAudio = m_preloader->hasAudio() == m_decoder->hasAudio() &&
+            (!m_output || m_preloader->audioFormat() == m_output->format());
+    if (!sameAudio && m_output && m_clock.time() < m_pendingPts) return true;
+
+    //沿用输出时以音频末尾为准，保证样本连续
+    qreal base = sameAudio && m_output ? m_pendingPts : m_timelineEnd;
+    m_ptsOffset = base - m_preloader->startTime();
+    std::swap(m_decoder, m_preloader);
+    m_playlistIndex++;
+
+    if (!sameAudio) setup_audio();
+    m_scheduler.setFrameDuration(m_decoder->hasVideo() ? 1.0 / m_decoder->fps() : 0.0);
+    setup_video();
+    preload_next();
+
+    qDebug() << "[Next:" << m_playlist.at(m_playlistIndex) << "] [Gapless:" << sameAudio << "]";
+
+    return true;
+}
+
+void MainWindow::setup_audio()
+{
+    if (m_output) {
+        m_output->stop();
+        m_output->deleteLater();
+        m_output = nullptr;
+        m_device = nullptr;
+    }
+
+    QAudioFormat format;
+    if (m_decoder->hasAudio()) {
+        format = m_decoder->audioFormat();
+        m_output = new QAudioOutput(format, this);
+        m_device = m_output->start();
+        m_bytesPerSecond = format.bytesForDuration(1000000);
+    }
+    m_clock.reset(m_output, format);
+}
+
+void MainWindow::setup_video()
+{
+    if (m_decoder->hasVideo()) {
+        QSize size = (qApp->primaryScreen()->size() - QSize(m_decoder->width(), m_decoder->height())) / 2;
+        setGeometry(pos().x(), size.height(), m_decoder->width(), m_decoder->height());
+    }
+}
+
+AudioFrame MainWindow::next_audio_frame()
+{
+    AudioFrame frame = m_decoder->nextAudioFrame();
+    if (!frame.data.isEmpty()) frame.pts += m_ptsOffset;
+
+    return frame;
+}
+
+VideoFrame MainWindow::next_video_frame()
+{
+    VideoFrame frame = m_decoder->nextVideoFrame();
+    if (!frame.image.isNull()) {
+        frame.pts += m_ptsOffset;
+        m_timelineEnd = qMax(m_timelineEnd, frame.pts + frame.duration);
+    }
+
+    return frame;
+}
+
+void MainWindow::feed_audio()
+{
+    if (!m_output || !m_device) return;
+
+    while (m_pendingAudio.size() < m_output->bytesFree()) {
+        AudioFrame frame = next_audio_frame();
+        if (frame.data.isEmpty()) break;
+        if (m_pendingAudio.isEmpty()) m_pendingPts = frame.pts;
+        m_pendingAudio += frame.data;
+    }
+
+    int readSize = m_output->periodSize();
+    int chunks = m_output->bytesFree() / readSize;
+    while (chunks--) {
+        QByteArray pcm = m_pendingAudio.mid(0, readSize);
+        int len = pcm.size();
+        if (!len) break;
+
+        m_pendingAudio.remove(0, len);
+        m_device->write(pcm);
+        //记录已写入数据末尾对应的pts，供主时钟计算播放位置
+        m_pendingPts += len / m_bytesPerSecond;
+        m_timelineEnd = qMax(m_timelineEnd, m_pendingPts);
+        m_clock.written(m_pendingPts, len);
+
+        if (len != readSize) break;
+    }
+}
+
+void MainWindow::present_video()
+{
+    forever {
+        if (m_nextFrame.image.isNull()) {
+            m_nextFrame = next_video_frame();
+            if (!m_nextFrame.image.isNull()) m_clock.sync(m_nextFrame.pts);
+        }
+
+        VideoScheduler::Decision decision = m_scheduler.decide(m_nextFrame, m_clock.time());
+        if (decision == VideoScheduler::Drop) {
+            m_nextFrame = VideoFrame();
+        } else {
+            if (decision == VideoScheduler::Present) {
+                m_currentFrame = m_nextFrame;
+                m_nextFrame = VideoFrame();
+                update();
+            }
+            break;
+        }
+    }
+}
+
+void MainWindow::check_finished()
+{
+    if (!m_decoder->isFinished() || !m_nextFrame.image.isNull() || !m_pendingAudio.isEmpty()) return;
+
+    //队列中可能还有剩余的帧，取出来放到待处理中，下次再检查
+    m_nextFrame = next_video_frame();
+    AudioFrame frame = next_audio_frame();
+    if (!m_nextFrame.image.isNull() || !frame.data.isEmpty()) {
+        if (!frame.data.isEmpty()) {
+            m_pendingPts = frame.pts;
+            m_pendingAudio = frame.data;
+        }
+        return;
+    }
+
+    //播放列表还有下一项时直接切换，旧的最后一帧一直显示到新的第一帧
+    if (switch_to_next()) return;
+
+    m_timer->stop();
+
+    SyncStatistics stat = m_scheduler.statistics();
+    qDebug() << "[Presented:" << stat.presented << "] [Dropped:" << stat.dropped << "] [Repeated:" << stat.repeated << "]"
+             << "[A-V Offset avg:" << stat.averageOffset * 1000 << "ms, max:" << stat.maxOffset * 1000 << "ms]";
+}
+
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    TRACE_SCOPE("paint");
+    QPainter painter(this);
+    if (!m_currentFrame.image.isNull()) {
+        painter.drawImage(rect(), m_currentFrame.image);
+
+        SyncStatistics stat = m_scheduler.statistics();
+        QString text = QString("A-V: %1 ms (avg %2 ms, max %3 ms)  drop: %4  repeat: %5")
+                .arg(stat.lastOffset * 1000, 0, 'f', 1).arg(stat.averageOffset * 1000, 0, 'f', 1)
+                .arg(stat.maxOffset * 1000, 0, 'f', 1).arg(stat.dropped).arg(stat.repeated);
+        painter.setPen(Qt::yellow);
+        painter.drawText(10, 20, text);
+    } else {
+        QString text("<请拖入视频>");
+        QFont f = font();
+        f.setPointSize(20);
+        painter.setFont(f);
+        painter.setPen(Qt::red);
+        int textWidth = painter.fontMetrics().horizontalAdvance(text);
+        painter.drawText(width() / 2 - textWidth / 2, height() / 2, text);
+    }
+}
+
+void MainWindow::dragEnterEvent(QDragEnterEvent *event)
+{
+    event->acceptProposedAction();
+}
+
+void MainWindow::dropEvent(QDropEvent *event)
+{
+    const QMimeData *mimeData = event->mimeData();
+    if(mimeData->hasUrls()) {
+        //一次拖入多个文件即为播放列表，按顺序无缝播放
+        QStringList files;
+        for (const QUrl &url : mimeData->urls())
+            files.append(url.toLocalFile());
+        open(files);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include "player.h"
+
+#include <QMainWindow>
+#include <QStringList>
+
+class QAudioOutput;
+class QPushButton;
+class MainWindow : public QMainWindow
+{
+    Q_OBJECT
+
+public:
+    explicit MainWindow(QWidget *parent = nullptr);
+    ~MainWindow() override;
+
+    /**
+     * @brief open
+     * @note 按顺序播放 files，position 为第一项开始播放的秒数
+     */
+    void open(const QStringList &files, qreal position = 0.0);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void dragEnterEvent(QDragEnterEvent *event) override;
+    void dropEvent(QDropEvent *event) override;
+
+private:
+    void watch_decoder(AVDecoder *decoder);
+    void open_item(int index, qreal position = 0.0);
+    void preload_next();
+    bool switch_to_next();
+    void setup_audio();
+    void setup_video();
+    AudioFrame next_audio_frame();
+    VideoFrame next_video_frame();
+    void feed_audio();
+    void present_video();
+    void check_finished();
+
+    QTimer *m_timer = nullptr;
+    QStringList m_playlist;
+    int m_playlistIndex = -1;
+    //当前播放的解码器和预先打开下一项的解码器，切换时互换
+    AVDecoder *m_decoder = nullptr;
+    AVDecoder *m_preloader = nullptr;
+    bool m_waitingResolved = false;
+    //当前项的时间戳加上偏移，拼接成连续的时间线，音频输出和主时钟可以不间断
+    qreal m_ptsOffset = 0.0;
+    qreal m_timelineEnd = 0.0;
+    QAudioOutput *m_output = nullptr;
+    QIODevice *m_device = nullptr;
+    qreal m_bytesPerSecond = 0.0;
+    QByteArray m_pendingAudio;
+    qreal m_pendingPts = 0.0;
+    AudioClock m_clock;
+    VideoScheduler m_scheduler;
+    VideoFrame m_currentFrame;
+    VideoFrame m_nextFrame;
+    QPushButton *m_suspendButton = nullptr;
+    QPushButton *m_resumeButton = nullptr;
+};
+
+#endif // MAINWINDOW_H
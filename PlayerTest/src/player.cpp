@@ -0,0 +1,338 @@
+#include "player.h"
+#include "audioresampler.h"
+#include "parallelimageconverter.h"
+#include "streamdecoder.h"
+#include "tracing.h"
+
+#include <QAudioOutput>
+#include <QDebug>
+
+#include <thread>
+
+static qreal frame_time(AVFrame *frame, AVStream *stream)
+{
+    int64_t pts = frame->best_effort_timestamp;
+    if (pts == AV_NOPTS_VALUE) pts = frame->pts;
+    if (pts == AV_NOPTS_VALUE) pts = 0;
+
+    return pts * av_q2d(stream->time_base);
+}
+
+AVDecoder::AVDecoder(QObject *parent)
+    : QThread (parent)
+{
+    m_audioQueue.monitor().setMetricsName("player.audio");
+    m_videoQueue.monitor().setMetricsName("player.video");
+}
+
+AVDecoder::~AVDecoder()
+{
+    stop();
+}
+
+void AVDecoder::stop()
+{
+    m_runnable = false;
+    //读取线程可能阻塞在满的包队列上，解码线程可能阻塞在空的包队列上，都要在等待线程结束前唤醒
+    m_demuxer.abort();
+    //必须重置信号量，解除解码线程在帧队列上的阻塞
+    m_audioQueue.init();
+    m_videoQueue.init();
+    wait();
+    m_audioQueue.init();
+    m_videoQueue.init();
+}
+
+void AVDecoder::open(const QString &filename, qreal position)
+{
+    stop();
+
+    m_mutex.lock();
+    m_filename = filename;
+    m_position = position;
+    m_runnable = true;
+    m_resolved = false;
+    m_mutex.unlock();
+
+    start();
+}
+
+QAudioFormat AVDecoder::audioFormat()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_audioFormat;
+}
+
+VideoFrame AVDecoder::nextVideoFrame()
+{
+    return m_videoQueue.tryDequeue();
+}
+
+AudioFrame AVDecoder::nextAudioFrame()
+{
+    return m_audioQueue.tryDequeue();
+}
+
+void AVDecoder::run()
+{
+    TRACE_THREAD_NAME("AVDecoder");
+    demuxing_decoding();
+}
+
+void AVDecoder::decode_stream(PacketQueue *queue, StreamDecoder &decoder, const std::function<void(AVFrame *)> &callback)
+{
+    auto handler = [&](AVFrame *frame) {
+        callback(frame);
+        return bool(m_runnable);
+    };
+
+    while (m_runnable) {
+        AVPacketPtr packet(queue->dequeue());
+
+        //nullptr为结束标记，正常结束时送入解码器冲刷剩余的帧
+        if (!packet) {
+            if (m_runnable) decoder.decode(nullptr, handler);
+            break;
+        }
+
+        //损坏的包跳过，继续解码后面的包
+        if (decoder.decode(packet.get(), handler) == AVERROR_EXIT) break;
+    }
+}
+
+void AVDecoder::convert_audio(AudioResampler &resampler, AVFrame *frame, AVStream *stream)
+{
+    qreal pts = frame_time(frame, stream);
+    if (frame->sample_rate > 0 && pts + frame->nb_samples / qreal(frame->sample_rate) <= m_skipUntil) return;
+
+    //与AudioDecoder相同：统一重采样为交错的S32
+    int size = AudioResampler::bufferSize(frame, AV_SAMPLE_FMT_S32);
+    if (size <= 0) return;
+
+    QByteArray data(size, Qt::Uninitialized);
+    int samples = resampler.convert(frame, AV_SAMPLE_FMT_S32, reinterpret_cast<uint8_t *>(data.data()), frame->nb_samples);
+    if (samples <= 0) return;
+    data.resize(samples * frame->channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S32));
+
+    m_audioQueue.enqueue({ data, pts });
+}
+
+void AVDecoder::convert_video(ParallelImageConverter &converter, AVFrame *frame, AVStream *stream)
+{
+    //跳转落在关键帧上，目标之前的帧不做转换
+    qreal pts = frame_time(frame, stream);
+    if (pts < m_skipUntil) return;
+
+    //与VideoDecoder相同：转换为RGB24，直接写入QImage的缓冲避免额外拷贝
+    //4K/8K 单核转换跟不上帧率，按水平条带在线程池中并行转换
+    VideoFrame videoFrame;
+    videoFrame.image = QImage(m_width, m_height, QImage::Format_RGB888);
+    uint8_t *dst_data[4] = { videoFrame.image.bits(), nullptr, nullptr, nullptr };
+    int dst_linesize[4] = { videoFrame.image.bytesPerLine(), 0, 0, 0 };
+    if (!converter.convert(frame, m_width, m_height, AV_PIX_FMT_RGB24, dst_data, dst_linesize)) return;
+
+    videoFrame.pts = pts;
+    videoFrame.duration = frame->pkt_duration > 0 ? frame->pkt_duration * av_q2d(stream->time_base) : 1.0 / m_fps;
+
+    m_videoQueue.enqueue(videoFrame);
+}
+
+void AVDecoder::demuxing_decoding()
+{
+    //解码器和转换上下文在函数返回时释放
+    StreamDecoder audioDecoder, videoDecoder;
+    AVStream *audioStream = nullptr, *videoStream = nullptr;
+    AudioResampler resampler;
+    ParallelImageConverter converter;
+    PacketQueue *audioPackets = nullptr, *videoPackets = nullptr;
+    std::thread audioThread;
+    auto audioCallback = [&](AVFrame *f) { convert_audio(resampler, f, audioStream); };
+    auto videoCallback = [&](AVFrame *f) { convert_video(converter, f, videoStream); };
+
+    m_audioIndex = m_videoIndex = -1;
+
+    //只打开一次输入，音频和视频共用同一个格式上下文和读取线程
+    if (!m_demuxer.open(m_filename)) goto Run_End;
+
+    audioStream = m_demuxer.stream(AVMEDIA_TYPE_AUDIO);
+    if (audioStream && audioDecoder.open(audioStream)) m_audioIndex = audioStream->index;
+
+    videoStream = m_demuxer.stream(AVMEDIA_TYPE_VIDEO);
+    if (videoStream && videoDecoder.open(videoStream)) m_videoIndex = videoStream->index;
+
+    if (m_audioIndex < 0 && m_videoIndex < 0) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        goto Run_End;
+    }
+    audioDecoder.setMetricsName("player.audio");
+    videoDecoder.setMetricsName("player.video");
+
+    m_duration = m_demuxer.formatContext()->duration > 0 ? m_demuxer.formatContext()->duration / qreal(AV_TIME_BASE) : 0.0;
+    m_startTime = m_demuxer.formatContext()->start_time != AV_NOPTS_VALUE ? m_demuxer.formatContext()->start_time / qreal(AV_TIME_BASE) : 0.0;
+
+    //跳转失败时从头播放
+    m_skipUntil = 0.0;
+    if (m_position > 0.0 && m_demuxer.seek(m_startTime + m_position)) {
+        m_skipUntil = m_startTime + m_position;
+        m_startTime = m_skipUntil;
+    }
+
+    if (audioDecoder.isOpen()) {
+        //重采样器在第一帧到达时按帧的参数初始化，这里只确定输出格式
+        AVCodecContext *audioCodecContext = audioDecoder.context();
+        QAudioFormat format;
+        format.setCodec("audio/pcm");
+        format.setSampleRate(audioCodecContext->sample_rate);
+        format.setSampleType(QAudioFormat::SignedInt);
+        format.setSampleSize(8 * av_get_bytes_per_sample(AV_SAMPLE_FMT_S32));
+        format.setChannelCount(audioCodecContext->channels);
+        m_mutex.lock();
+        m_audioFormat = format;
+        m_mutex.unlock();
+    }
+
+    if (videoDecoder.isOpen()) {
+        m_fps = videoStream->avg_frame_rate.num > 0 ? av_q2d(videoStream->avg_frame_rate) : 25.0;
+        m_width = videoDecoder.context()->width;
+        m_height = videoDecoder.context()->height;
+    }
+
+    m_resolved = true;
+    emit resolved();
+
+    if (!m_runnable) goto Run_End;
+
+    //包队列只存放压缩数据，容量可以比帧队列大得多
+    if (m_audioIndex >= 0) audioPackets = m_demuxer.enable(AVMEDIA_TYPE_AUDIO, 256);
+    if (m_videoIndex >= 0) videoPackets = m_demuxer.enable(AVMEDIA_TYPE_VIDEO, 128);
+    m_demuxer.start();
+
+    //音频和视频各在一个线程中解码，互不阻塞
+    //任何一路提前退出(出错或被停止)都要让读取线程停下，否则它会阻塞在这一路的满队列上
+    if (audioPackets) {
+        audioThread = std::thread([&] {
+            TRACE_THREAD_NAME("AudioDecoder");
+            decode_stream(audioPackets, audioDecoder, audioCallback);
+            m_demuxer.requestStop();
+        });
+    }
+    if (videoPackets) {
+        decode_stream(videoPackets, videoDecoder, videoCallback);
+        m_demuxer.requestStop();
+    }
+    if (audioThread.joinable()) audioThread.join();
+
+    qDebug() << "[Packets read:" << m_demuxer.packetsRead() << "] [Bytes read:" << m_demuxer.bytesRead() << "]";
+
+Run_End:
+    m_demuxer.stop();
+    m_demuxer.close();
+
+    //被stop()打断时不发出
+    if (m_runnable) emit finish();
+}
+
+void AudioClock::reset(QAudioOutput *output, const QAudioFormat &format)
+{
+    m_output = output;
+    m_bytesPerSecond = output ? qreal(format.bytesForDuration(1000000)) : 0.0;
+    m_writtenPts = 0.0;
+    m_writtenBytes = 0;
+    m_started = false;
+    m_systemBase = 0.0;
+    m_paused = false;
+    m_systemClock.invalidate();
+}
+
+void AudioClock::sync(qreal pts)
+{
+    //系统时钟模式下，以第一帧的pts作为起点
+    if (!m_output && !m_started) {
+        m_started = true;
+        m_systemBase = pts;
+        m_systemClock.start();
+    }
+}
+
+void AudioClock::written(qreal endPts, qint64 bytes)
+{
+    m_started = true;
+    m_writtenPts = endPts;
+    m_writtenBytes += bytes;
+}
+
+void AudioClock::pause()
+{
+    if (!m_output && m_started && !m_paused) {
+        m_systemBase += m_systemClock.elapsed() / 1000.0;
+        m_paused = true;
+    }
+}
+
+void AudioClock::resume()
+{
+    if (!m_output && m_started && m_paused) {
+        m_systemClock.restart();
+        m_paused = false;
+    }
+}
+
+qreal AudioClock::time() const
+{
+    if (m_output) {
+        //设备已处理(即已播放)的字节数
+        qint64 played = qint64(m_output->processedUSecs() * m_bytesPerSecond / 1000000.0);
+        qint64 buffered = qMax<qint64>(0, m_writtenBytes - played);
+        return m_writtenPts - buffered / m_bytesPerSecond;
+    } else if (m_started) {
+        return m_paused ? m_systemBase : m_systemBase + m_systemClock.elapsed() / 1000.0;
+    }
+
+    return 0.0;
+}
+
+void VideoScheduler::reset(qreal frameDuration)
+{
+    setFrameDuration(frameDuration);
+    m_repeatDeadline = -1.0;
+    m_offsetSum = 0.0;
+    m_statistics = SyncStatistics();
+}
+
+void VideoScheduler::setFrameDuration(qreal frameDuration)
+{
+    m_frameDuration = frameDuration > 0.0 ? frameDuration : 0.04;
+}
+
+VideoScheduler::Decision VideoScheduler::decide(const VideoFrame &next, qreal clock)
+{
+    if (!next.image.isNull()) {
+        qreal duration = next.duration > 0.0 ? next.duration : m_frameDuration;
+        qreal offset = next.pts - clock;
+
+        if (clock > next.pts + duration) {
+            //这一帧的显示区间已经完全过去
+            m_statistics.dropped++;
+            if (Metrics::isEnabled()) m_droppedFrames->add();
+            return Drop;
+        } else if (offset <= 0.0) {
+            m_statistics.presented++;
+            m_statistics.lastOffset = offset;
+            m_offsetSum += offset;
+            m_statistics.averageOffset = m_offsetSum / m_statistics.presented;
+            m_statistics.maxOffset = qMax(m_statistics.maxOffset, qAbs(offset));
+            m_repeatDeadline = next.pts + duration;
+            if (Metrics::isEnabled()) m_presentedFrames->add();
+            return Present;
+        }
+    }
+
+    //下一帧未到或尚未解码出来，当前帧超出自身时长继续显示即为重复
+    if (m_repeatDeadline >= 0.0 && clock >= m_repeatDeadline) {
+        m_statistics.repeated++;
+        m_repeatDeadline += m_frameDuration;
+        if (Metrics::isEnabled()) m_repeatedFrames->add();
+    }
+
+    return Wait;
+}
@@ -0,0 +1,180 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include "avhandle.h"
+#include "meteredqueue.h"
+#include "demuxer.h"
+#include "metrics.h"
+
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QThread>
+
+#include <atomic>
+#include <functional>
+
+class AudioResampler;
+class ParallelImageConverter;
+class StreamDecoder;
+struct VideoFrame
+{
+    QImage image;
+    qreal pts = 0.0;
+    qreal duration = 0.0;
+};
+
+struct AudioFrame
+{
+    QByteArray data;
+    qreal pts;
+};
+
+class AVDecoder : public QThread
+{
+    Q_OBJECT
+
+public:
+    AVDecoder(QObject *parent = nullptr);
+    ~AVDecoder();
+
+    void stop();
+    /**
+     * @brief open
+     * @param position 从开头算起的秒数，大于 0 时先跳转，目标之前的帧解码后丢弃
+     */
+    void open(const QString &filename, qreal position = 0.0);
+
+    /**
+     * @brief isResolved
+     * @note 已打开输入和解码器(即已发出resolved)，用于轮询预先打开的下一项
+     */
+    bool isResolved() const { return m_resolved; }
+    bool hasAudio() const { return m_audioIndex >= 0; }
+    bool hasVideo() const { return m_videoIndex >= 0; }
+    QAudioFormat audioFormat();
+    qreal fps() const { return m_fps; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    qreal duration() const { return m_duration; }
+    //第一帧的时间戳，播放列表切换时用于拼接时间线
+    qreal startTime() const { return m_startTime; }
+
+    /**
+     * @brief nextVideoFrame / nextAudioFrame
+     * @note 不阻塞，队列为空时返回默认构造的帧(image为空 / data为空)
+     */
+    VideoFrame nextVideoFrame();
+    AudioFrame nextAudioFrame();
+
+signals:
+    void resolved();
+    void finish();
+
+protected:
+    void run();
+
+private:
+    void decode_stream(PacketQueue *queue, StreamDecoder &decoder, const std::function<void(AVFrame *)> &callback);
+    void convert_audio(AudioResampler &resampler, AVFrame *frame, AVStream *stream);
+    void convert_video(ParallelImageConverter &converter, AVFrame *frame, AVStream *stream);
+    void demuxing_decoding();
+
+    //解码线程、音频解码线程和 GUI 线程都会读写
+    std::atomic_bool m_runnable { true };
+    std::atomic_bool m_resolved { false };
+    QMutex m_mutex;
+    QString m_filename;
+    qreal m_position = 0.0;
+    //跳转后早于该时间戳的帧不输出
+    qreal m_skipUntil = 0.0;
+    QAudioFormat m_audioFormat;
+    Demuxer m_demuxer;
+    //音频作为主时钟，必须比视频缓冲更多，否则交错不均匀的文件会因视频队列已满而饿死音频
+    MeteredBufferQueue<AudioFrame> m_audioQueue { 400 };
+    MeteredBufferQueue<VideoFrame> m_videoQueue { 30 };
+    int m_audioIndex = -1, m_videoIndex = -1;
+    qreal m_fps = 0.0, m_duration = 0.0, m_startTime = 0.0;
+    int m_width = 0, m_height = 0;
+};
+
+class QAudioOutput;
+/**
+ * @brief AudioClock
+ * @note 主时钟：以音频设备实际播放到的位置为准
+ *       播放位置 = 已写入数据末尾的pts - (已写入字节 - 设备已处理字节) / 每秒字节数
+ *       没有音频时退化为系统时钟
+ */
+class AudioClock
+{
+public:
+    void reset(QAudioOutput *output, const QAudioFormat &format);
+    void sync(qreal pts);
+    void written(qreal endPts, qint64 bytes);
+    void pause();
+    void resume();
+
+    qreal time() const;
+
+private:
+    QAudioOutput *m_output = nullptr;
+    qreal m_bytesPerSecond = 0.0;
+    qreal m_writtenPts = 0.0;
+    qint64 m_writtenBytes = 0;
+    bool m_started = false;
+    QElapsedTimer m_systemClock;
+    qreal m_systemBase = 0.0;
+    bool m_paused = false;
+};
+
+struct SyncStatistics
+{
+    int presented = 0;
+    int dropped = 0;
+    int repeated = 0;
+    //视频帧pts - 主时钟，正数表示视频超前
+    qreal lastOffset = 0.0;
+    qreal averageOffset = 0.0;
+    qreal maxOffset = 0.0;
+};
+
+/**
+ * @brief VideoScheduler
+ * @note 根据主时钟决定视频帧的显示、丢弃和重复
+ *       帧的 pts 还没到主时钟就等待，不设阈值(当前帧超出自身时长时记为重复)
+ *       主时钟已越过帧的显示区间(pts + 时长)则丢弃，否则立即显示
+ */
+class VideoScheduler
+{
+public:
+    enum Decision
+    {
+        Present = 0,
+        Wait,
+        Drop
+    };
+
+    void reset(qreal frameDuration);
+    //只修改默认帧时长，保留统计(播放列表切换到下一项时使用)
+    void setFrameDuration(qreal frameDuration);
+    /**
+     * @brief decide
+     * @param next 下一帧，image为空表示暂时没有可用的帧
+     * @param clock 主时钟
+     */
+    Decision decide(const VideoFrame &next, qreal clock);
+    SyncStatistics statistics() const { return m_statistics; }
+
+private:
+    qreal m_frameDuration = 0.04;
+    qreal m_repeatDeadline = -1.0;
+    qreal m_offsetSum = 0.0;
+    SyncStatistics m_statistics;
+    //与 m_statistics 相同，但不随 reset() 清零，供 Metrics 定期输出
+    Counter *m_presentedFrames = Metrics::counter("player.video.presented");
+    Counter *m_droppedFrames = Metrics::counter("player.video.dropped");
+    Counter *m_repeatedFrames = Metrics::counter("player.video.repeated");
+};
+
+#endif // PLAYER_H
@@ -0,0 +1,56 @@
+#-------------------------------------------------
+#
+# Headless subtitle extraction tool
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = SubtitleExtract
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../ffmpeg/include \
+        $$PWD/../Utility \
+        $$PWD/../SubtitleTest2/src
+
+LIBS += -L$$PWD/../ffmpeg/lib/ -lavcodec -lavformat -lavutil
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += console c++11 debug_and_release
+
+# qmake CONFIG+=tracing 打开热路径追踪(TRACE_* 宏)，否则宏展开为空
+tracing: DEFINES += ENABLE_TRACING
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$shell_path(./debug)
+} else {
+    DESTDIR = $$shell_path(./release)
+}
+
+win32 {
+    ffmpeg_dll = $$shell_path($$PWD/../ffmpeg/dll)
+    QMAKE_POST_LINK = \
+        copy $$ffmpeg_dll $$DESTDIR
+}
+
+HEADERS += \
+        src/subtitleextractor.h \
+        src/subtitleindex.h \
+        $$PWD/../SubtitleTest2/src/textsubtitle.h \
+        $$PWD/../Utility/metrics.h \
+        $$PWD/../Utility/tracing.h
+
+SOURCES += \
+        src/main.cpp \
+        src/subtitleextractor.cpp \
+        src/subtitleindex.cpp \
+        $$PWD/../SubtitleTest2/src/textsubtitle.cpp \
+        $$PWD/../Utility/metrics.cpp \
+        $$PWD/../Utility/tracing.cpp
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
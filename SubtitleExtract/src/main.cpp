@@ -0,0 +1,172 @@
+#include "metrics.h"
+#include "subtitleextractor.h"
+#include "subtitleindex.h"
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+#include <cstdio>
+#include <memory>
+
+//目录中按后缀挑选媒体文件
+static const char *MEDIA_FILTERS[] = { "*.mkv", "*.mp4", "*.m4v", "*.mov", "*.avi", "*.ts", "*.m2ts", "*.mpg", "*.vob", "*.webm" };
+
+//查询结果最多显示的条数，以及测量热缓存延迟时重复查询的次数
+static const int SEARCH_LIMIT = 100;
+static const int SEARCH_REPEATS = 100;
+
+static void usage()
+{
+    std::printf("usage: SubtitleExtract [-j threads] [-o output] [--index file.sidx] [--trace trace.json] file|directory...\n"
+                "       SubtitleExtract --search file.sidx query...\n");
+}
+
+static QByteArray time_text(qint64 ms)
+{
+    return QString::asprintf("%02lld:%02lld:%02lld.%03lld", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000).toUtf8();
+}
+
+static int search(const QString &indexFile, const QString &query)
+{
+    SubtitleIndex index;
+    QElapsedTimer timer;
+    timer.start();
+    if (!index.open(indexFile)) {
+        std::printf("can not open %s\n", indexFile.toLocal8Bit().constData());
+        return 1;
+    }
+    double openTime = timer.nsecsElapsed() / 1e6;
+
+    //第一次查询包含缺页，之后的查询代表热缓存下的延迟
+    timer.restart();
+    std::vector<SubtitleHit> hits = index.search(query, SEARCH_LIMIT);
+    double firstTime = timer.nsecsElapsed() / 1e6;
+    timer.restart();
+    for (int i = 0; i < SEARCH_REPEATS; i++) index.search(query, SEARCH_LIMIT);
+    double warmTime = timer.nsecsElapsed() / 1e6 / SEARCH_REPEATS;
+
+    for (const SubtitleHit &hit : hits) {
+        QString text = hit.text;
+        text.replace('\n', " / ");
+        std::printf("%s  %s --> %s\n    %s\n    PlayerTest --start %.3f \"%s\"\n",
+                    hit.file.toLocal8Bit().constData(), time_text(hit.start).constData(), time_text(hit.end).constData(),
+                    text.toLocal8Bit().constData(), hit.start / 1000.0, hit.file.toLocal8Bit().constData());
+    }
+
+    std::printf("hits: %d  files: %d  cues: %d  terms: %d\n", int(hits.size()), index.fileCount(), index.cueCount(), index.termCount());
+    std::printf("open: %.3f ms  first query: %.3f ms  warm query: %.3f ms\n", openTime, firstTime, warmTime);
+
+    return hits.empty() ? 2 : 0;
+}
+
+//用法: SubtitleExtract [-j 线程数] [-o 输出目录] [--index 索引文件] [--trace 追踪文件] 文件或目录...，目录递归查找
+//      SubtitleExtract --search 索引文件 查询串...
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList arguments = QCoreApplication::arguments();
+    QString outputDir = QDir::currentPath();
+    QString indexFile;
+    QString traceFile;
+    int threads = QThread::idealThreadCount();
+    QStringList files;
+
+    QStringList filters;
+    for (const char *filter : MEDIA_FILTERS) filters.append(filter);
+
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &argument = arguments.at(i);
+        if (argument == "-j" && i + 1 < arguments.size()) {
+            threads = qMax(1, arguments.at(++i).toInt());
+        } else if (argument == "-o" && i + 1 < arguments.size()) {
+            outputDir = arguments.at(++i);
+        } else if (argument == "--index" && i + 1 < arguments.size()) {
+            indexFile = arguments.at(++i);
+        } else if (argument == "--trace" && i + 1 < arguments.size()) {
+            traceFile = arguments.at(++i);
+        } else if (argument == "--search" && i + 2 < arguments.size()) {
+            return search(arguments.at(i + 1), arguments.mid(i + 2).join(' '));
+        } else if (QFileInfo(argument).isDir()) {
+            QDirIterator it(argument, filters, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) files.append(QFileInfo(it.next()).absoluteFilePath());
+        } else if (QFileInfo(argument).isFile()) {
+            files.append(QFileInfo(argument).absoluteFilePath());
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    //同一个文件被列出多次(目录和文件参数重叠)时只提取一次，否则多个线程会写同一个输出
+    files.removeDuplicates();
+    if (files.isEmpty()) {
+        usage();
+        return 1;
+    }
+    if (!QDir().mkpath(outputDir)) {
+        std::printf("can not create %s\n", outputDir.toLocal8Bit().constData());
+        return 1;
+    }
+
+    //METRICS_INTERVAL=秒 时定期把各个文件的耗时输出到 stderr
+    MetricsReporter metrics;
+    metrics.startFromEnvironment();
+
+    //每个线程一次处理一个文件，线程数不超过文件数
+    threads = qMin(threads, files.size());
+    std::atomic_int next { 0 };
+    std::vector<std::unique_ptr<ExtractWorker>> workers;
+    std::unique_ptr<SubtitleIndexBuilder> index(indexFile.isEmpty() ? nullptr : new SubtitleIndexBuilder);
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(new ExtractWorker(files, next, outputDir, index.get()));
+        workers.back()->start();
+    }
+
+    int processed = 0, failed = 0, events = 0;
+    for (std::unique_ptr<ExtractWorker> &worker : workers) {
+        worker->wait();
+        processed += worker->processed();
+        failed += worker->failed();
+        events += worker->events();
+    }
+
+    double seconds = timer.nsecsElapsed() / 1e9;
+    std::printf("files: %d  failed: %d  subtitles: %d  threads: %d\n", processed, failed, events, threads);
+    std::printf("time: %.2f s  %.1f files/s\n", seconds, seconds > 0 ? (processed + failed) / seconds : 0.0);
+
+    //Chrome trace JSON，拖进 Perfetto 查看各个线程的读取、解码和写出
+    if (!traceFile.isEmpty()) {
+#ifdef ENABLE_TRACING
+        if (!Tracing::dump(traceFile.toStdString()))
+            std::printf("can not write %s\n", traceFile.toLocal8Bit().constData());
+#else
+        std::printf("tracing is disabled, rebuild with CONFIG+=tracing\n");
+#endif
+    }
+
+    if (index) {
+        timer.restart();
+        if (!index->write(indexFile)) {
+            std::printf("can not write %s\n", indexFile.toLocal8Bit().constData());
+            return 1;
+        }
+        double writeTime = timer.nsecsElapsed() / 1e6;
+
+        //分词和插入的耗费按所有线程累计，不含解复用和解码
+        SubtitleIndexBuilder::Statistics statistics = index->statistics();
+        double addSeconds = statistics.addTime / 1e9;
+        std::printf("index: %d files  %d cues  %d terms  %.1f KB\n", statistics.files, statistics.cues, statistics.terms,
+                    statistics.bytes / 1024.0);
+        std::printf("index build: %.2f ms  %.0f cues/s  write: %.2f ms\n", addSeconds * 1000,
+                    addSeconds > 0 ? statistics.cues / addSeconds : 0.0, writeTime);
+    }
+
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,310 @@
+#include "subtitleextractor.h"
+#include "subtitleindex.h"
+#include "metrics.h"
+#include "textsubtitle.h"
+#include "tracing.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace
+{
+
+QByteArray srt_time(qint64 ms)
+{
+    return QString::asprintf("%02lld:%02lld:%02lld,%03lld", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000).toUtf8();
+}
+
+QImage render_bitmap(const AVSubtitleRect *rect)
+{
+    //调色板为 32 位 ARGB(非预乘)，与 QImage::Format_ARGB32 的内存布局相同
+    uint32_t palette[256] = {};
+    const uint32_t *argb = reinterpret_cast<const uint32_t *>(rect->data[1]);
+    for (int i = 0; i < qMin(rect->nb_colors, 256); i++) palette[i] = argb[i];
+
+    QImage image(rect->w, rect->h, QImage::Format_ARGB32);
+    for (int y = 0; y < rect->h; y++) {
+        const uint8_t *index = rect->data[0] + y * rect->linesize[0];
+        uint32_t *line = reinterpret_cast<uint32_t *>(image.scanLine(y));
+        for (int x = 0; x < rect->w; x++) line[x] = palette[index[x]];
+    }
+
+    return image;
+}
+
+} //namespace
+
+SubtitleExtractor::SubtitleExtractor(const QString &outputDir)
+    : m_outputDir(outputDir)
+{
+
+}
+
+int SubtitleExtractor::extract(const QString &filename)
+{
+    TRACE_SCOPE("extract");
+    //各流的解码器随 streams 释放，提前返回也不会泄漏
+    AVFormatInputPtr formatContext;
+    std::vector<OutputStream> streams;
+    AVPacketPtr packet;
+    bool probe = false;
+    int opened = 0;
+    int events = 0;
+    //递归扫描时不同目录下可能有同名文件，加上完整路径的短哈希，输出不会互相覆盖，并行时也不会写同一个文件
+    QFileInfo info(filename);
+    QByteArray pathHash = QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+    QString baseName = info.completeBaseName() + "." + QString::fromUtf8(pathHash);
+
+    formatContext = openInput(filename.toUtf8().constData());
+    if (!formatContext) {
+        qDebug() << "Has Error: line =" << __LINE__ << filename;
+        return -1;
+    }
+
+    //字幕流的参数通常在文件头中，只有缺少时才探测(探测会读取并解码所有流)
+    for (unsigned i = 0; i < formatContext->nb_streams; i++) {
+        const AVCodecParameters *codecpar = formatContext->streams[i]->codecpar;
+        if (codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE && codecpar->codec_id == AV_CODEC_ID_NONE) probe = true;
+    }
+    if (formatContext->nb_streams == 0 || probe) avformat_find_stream_info(formatContext.get(), nullptr);
+
+    streams.resize(formatContext->nb_streams);
+    for (unsigned i = 0; i < formatContext->nb_streams; i++) {
+        AVStream *stream = formatContext->streams[i];
+        if (stream->codecpar->codec_type != AVMEDIA_TYPE_SUBTITLE) {
+            stream->discard = AVDISCARD_ALL;
+            continue;
+        }
+
+        AVCodec *decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+        const AVCodecDescriptor *descriptor = avcodec_descriptor_get(stream->codecpar->codec_id);
+        AVCodecContextPtr context(decoder ? avcodec_alloc_context3(decoder) : nullptr);
+        if (!context || avcodec_parameters_to_context(context.get(), stream->codecpar) < 0) {
+            qDebug() << "Has Error: line =" << __LINE__ << filename << "stream" << i;
+            stream->discard = AVDISCARD_ALL;
+            continue;
+        }
+        context->pkt_timebase = stream->time_base;
+        if (avcodec_open2(context.get(), decoder, nullptr) < 0) {
+            qDebug() << "Has Error: line =" << __LINE__ << filename << "stream" << i;
+            stream->discard = AVDISCARD_ALL;
+            continue;
+        }
+
+        OutputStream &output = streams[i];
+        output.context = std::move(context);
+        output.bitmap = descriptor && (descriptor->props & AV_CODEC_PROP_BITMAP_SUB);
+        output.prefix = QDir(m_outputDir).filePath(baseName + "." + QString::number(i));
+        AVDictionaryEntry *language = av_dict_get(stream->metadata, "language", nullptr, 0);
+        if (language) output.prefix += "." + QString::fromUtf8(language->value);
+        opened++;
+    }
+
+    if (opened == 0) return 0;
+
+    packet = makePacket();
+    if (!packet) {
+        qDebug() << "Has Error: line =" << __LINE__ << filename;
+        return -1;
+    }
+    while (av_read_frame(formatContext.get(), packet.get()) >= 0) {
+        if (packet->stream_index < int(streams.size()) && streams[size_t(packet->stream_index)].context)
+            decode_packet(streams[size_t(packet->stream_index)], packet.get());
+        av_packet_unref(packet.get());
+    }
+
+    for (OutputStream &output : streams) {
+        if (!output.context || output.cues.empty()) continue;
+        if (output.bitmap ? write_timing(output) : write_srt(output)) events += int(output.cues.size());
+    }
+    if (m_index) add_to_index(filename, streams);
+
+    return events;
+}
+
+int SubtitleExtractor::decode_packet(OutputStream &stream, AVPacket *packet)
+{
+    TRACE_SCOPE("decode_subtitle");
+    AVSubtitle subtitle;
+    int got_frame = 0;
+    if (avcodec_decode_subtitle2(stream.context.get(), &subtitle, &got_frame, packet) < 0) return -1;
+    if (!got_frame) return 0;
+
+    //与 SubtitleTrack 相同：包的 pts 为基准，start/end_display_time 为毫秒偏移
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    if (pts != AV_NOPTS_VALUE) {
+        qint64 base = av_rescale_q(pts, stream.context->pkt_timebase, AVRational{ 1, 1000 });
+        qint64 start = base + subtitle.start_display_time;
+        qint64 end = -1;
+        if (subtitle.end_display_time > subtitle.start_display_time && subtitle.end_display_time != UINT32_MAX)
+            end = base + subtitle.end_display_time;
+        else if (packet->duration > 0)
+            end = base + av_rescale_q(packet->duration, stream.context->pkt_timebase, AVRational{ 1, 1000 });
+        add_cues(stream, &subtitle, start, end);
+    }
+    avsubtitle_free(&subtitle);
+
+    return 1;
+}
+
+void SubtitleExtractor::add_cues(OutputStream &stream, const AVSubtitle *subtitle, qint64 start, qint64 end)
+{
+    //没有结束时间的字幕由下一个字幕(包括空的清屏字幕)结束
+    for (auto it = stream.cues.rbegin(); it != stream.cues.rend() && it->end < 0; ++it) it->end = start;
+
+    QString text;
+    for (unsigned i = 0; i < subtitle->num_rects; i++) {
+        const AVSubtitleRect *rect = subtitle->rects[i];
+        if (rect->type == SUBTITLE_BITMAP && rect->w > 0 && rect->h > 0) {
+            if (!stream.bitmap) continue;
+            //第一次写图片时才创建目录，没有图像的流不留空目录
+            if (stream.images == 0) QDir().mkpath(stream.prefix);
+
+            Cue cue;
+            cue.start = start;
+            cue.end = end;
+            cue.image = QString::asprintf("%06d.png", ++stream.images);
+            cue.rect = QRect(rect->x, rect->y, rect->w, rect->h);
+            if (render_bitmap(rect).save(QDir(stream.prefix).filePath(cue.image), "PNG"))
+                stream.cues.push_back(cue);
+        } else if (rect->type == SUBTITLE_ASS && rect->ass) {
+            if (!text.isEmpty()) text += '\n';
+            text += TextSubtitle::assEventText(rect->ass);
+        } else if (rect->type == SUBTITLE_TEXT && rect->text) {
+            if (!text.isEmpty()) text += '\n';
+            text += QString::fromUtf8(rect->text);
+        }
+    }
+
+    if (!stream.bitmap && !text.trimmed().isEmpty()) {
+        Cue cue;
+        cue.start = start;
+        cue.end = end;
+        cue.text = text.trimmed();
+        stream.cues.push_back(cue);
+    }
+}
+
+bool SubtitleExtractor::write_srt(const OutputStream &stream)
+{
+    QFile file(stream.prefix + ".srt");
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Has Error: line =" << __LINE__ << file.fileName();
+        return false;
+    }
+
+    QByteArray data;
+    int index = 0;
+    for (const Cue &cue : stream.cues) {
+        //最后一条没有结束时间时显示 5 秒
+        qint64 end = cue.end >= 0 ? cue.end : cue.start + 5000;
+        data += QByteArray::number(++index) + "\n" + srt_time(cue.start) + " --> " + srt_time(end) + "\n";
+        data += cue.text.toUtf8() + "\n\n";
+    }
+    file.write(data);
+
+    return true;
+}
+
+bool SubtitleExtractor::write_timing(const OutputStream &stream)
+{
+    QFile file(QDir(stream.prefix).filePath("timing.json"));
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Has Error: line =" << __LINE__ << file.fileName();
+        return false;
+    }
+
+    //end 为 -1 表示直到文件结束
+    QJsonArray cues;
+    for (const Cue &cue : stream.cues) {
+        QJsonObject object;
+        object["image"] = cue.image;
+        object["start"] = cue.start;
+        object["end"] = cue.end;
+        object["x"] = cue.rect.x();
+        object["y"] = cue.rect.y();
+        object["width"] = cue.rect.width();
+        object["height"] = cue.rect.height();
+        cues.append(object);
+    }
+    file.write(QJsonDocument(cues).toJson());
+
+    return true;
+}
+
+void SubtitleExtractor::add_to_index(const QString &filename, const std::vector<OutputStream> &streams)
+{
+    TRACE_SCOPE("add_to_index");
+    //一个文件的所有文本字幕流一次加入；与 srt 相同，最后一条没有结束时间时显示 5 秒
+    QVector<TextCue> cues;
+    for (const OutputStream &stream : streams) {
+        if (!stream.context || stream.bitmap) continue;
+        for (const Cue &cue : stream.cues) {
+            TextCue textCue;
+            textCue.start = cue.start;
+            textCue.end = cue.end >= 0 ? cue.end : cue.start + 5000;
+            textCue.text = cue.text;
+            cues.append(textCue);
+        }
+    }
+
+    //保存绝对路径，查询结果可以直接交给播放器
+    if (!cues.isEmpty()) m_index->add(QFileInfo(filename).absoluteFilePath(), cues);
+}
+
+ExtractWorker::ExtractWorker(const QStringList &files, std::atomic_int &next, const QString &outputDir,
+                             SubtitleIndexBuilder *index, QObject *parent)
+    : QThread (parent)
+    , m_files(files)
+    , m_next(next)
+    , m_outputDir(outputDir)
+    , m_index(index)
+{
+
+}
+
+ExtractWorker::~ExtractWorker()
+{
+    stop();
+}
+
+void ExtractWorker::stop()
+{
+    m_runnable = false;
+    wait();
+}
+
+void ExtractWorker::run()
+{
+    TRACE_THREAD_NAME("ExtractWorker");
+    SubtitleExtractor extractor(m_outputDir);
+    extractor.setIndex(m_index);
+    Histogram *fileTime = Metrics::histogram("extract.file_time");
+    Counter *failedFiles = Metrics::counter("extract.failed");
+
+    while (m_runnable) {
+        int index = m_next++;
+        if (index >= m_files.size()) break;
+
+        bool measure = Metrics::isEnabled();
+        int64_t begin = measure ? Metrics::now() : 0;
+        int events = extractor.extract(m_files.at(index));
+        if (measure) {
+            fileTime->record(Metrics::now() - begin);
+            if (events < 0) failedFiles->add();
+        }
+        if (events < 0) {
+            m_failed++;
+        } else {
+            m_processed++;
+            m_events += events;
+        }
+    }
+}
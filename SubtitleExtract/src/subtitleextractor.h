@@ -0,0 +1,98 @@
+#ifndef SUBTITLEEXTRACTOR_H
+#define SUBTITLEEXTRACTOR_H
+
+#include "avhandle.h"
+
+#include <QRect>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+#include <vector>
+
+class SubtitleIndexBuilder;
+/**
+ * @brief SubtitleExtractor
+ * @note 无界面的字幕提取：只解复用字幕流(其他流全部 AVDISCARD_ALL)，
+ *       文本字幕(srt / ass / mov_text...)写为 <文件名>.<路径哈希>.<流>.<语言>.srt，
+ *       图像字幕(dvdsub / PGS / dvbsub)写为同名目录下的 png 序列和 timing.json
+ *       路径哈希为完整路径 MD5 的前 8 位，不同目录下的同名文件不会互相覆盖
+ */
+class SubtitleExtractor
+{
+public:
+    SubtitleExtractor(const QString &outputDir);
+
+    //设置后文本字幕同时加入索引，可以多个提取器共用一个
+    void setIndex(SubtitleIndexBuilder *index) { m_index = index; }
+
+    /**
+     * @brief extract
+     * @return 提取的字幕条数，文件打开失败返回 -1
+     */
+    int extract(const QString &filename);
+
+private:
+    struct Cue
+    {
+        //毫秒，end 为 -1 时显示到下一个字幕开始
+        qint64 start = 0;
+        qint64 end = -1;
+        QString text;
+        QString image;
+        QRect rect;
+    };
+
+    struct OutputStream
+    {
+        AVCodecContextPtr context;
+        bool bitmap = false;
+        QString prefix;
+        std::vector<Cue> cues;
+        int images = 0;
+    };
+
+    int decode_packet(OutputStream &stream, AVPacket *packet);
+    void add_cues(OutputStream &stream, const AVSubtitle *subtitle, qint64 start, qint64 end);
+    bool write_srt(const OutputStream &stream);
+    bool write_timing(const OutputStream &stream);
+    void add_to_index(const QString &filename, const std::vector<OutputStream> &streams);
+
+    QString m_outputDir;
+    SubtitleIndexBuilder *m_index = nullptr;
+};
+
+/**
+ * @brief ExtractWorker
+ * @note 工作线程：所有线程共用一个文件列表，用原子下标依次领取，每个线程各自打开文件
+ */
+class ExtractWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    ExtractWorker(const QStringList &files, std::atomic_int &next, const QString &outputDir,
+                  SubtitleIndexBuilder *index = nullptr, QObject *parent = nullptr);
+    ~ExtractWorker();
+
+    void stop();
+
+    int processed() const { return m_processed; }
+    int failed() const { return m_failed; }
+    int events() const { return m_events; }
+
+protected:
+    void run();
+
+private:
+    const QStringList &m_files;
+    std::atomic_int &m_next;
+    QString m_outputDir;
+    SubtitleIndexBuilder *m_index;
+    bool m_runnable = true;
+    int m_processed = 0;
+    int m_failed = 0;
+    int m_events = 0;
+};
+
+#endif // SUBTITLEEXTRACTOR_H
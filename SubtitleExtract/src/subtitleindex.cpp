@@ -0,0 +1,358 @@
+#include "subtitleindex.h"
+
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+const uint32_t INDEX_VERSION = 1;
+
+//中日韩文字之间没有空格，每个字单独作为一个词
+bool is_ideograph(uint code)
+{
+    QChar::Script script = QChar::script(code);
+    return script == QChar::Script_Han || script == QChar::Script_Hiragana || script == QChar::Script_Katakana;
+}
+
+void write_varint(QByteArray &data, uint32_t value)
+{
+    while (value >= 0x80) {
+        data.append(char(value | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+bool read_varint(const uchar *&p, const uchar *end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (p >= end) return false;
+        uchar byte = *p++;
+        value |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+
+    return false;
+}
+
+bool less_bytes(const QByteArray &a, const QByteArray &b)
+{
+    int result = std::memcmp(a.constData(), b.constData(), size_t(std::min(a.size(), b.size())));
+    return result < 0 || (result == 0 && a.size() < b.size());
+}
+
+} //namespace
+
+QList<QByteArray> SubtitleIndex::tokenize(const QString &text)
+{
+    QList<QByteArray> tokens;
+    int wordStart = -1;
+    auto flush = [&](int end) {
+        if (wordStart >= 0) tokens.append(text.mid(wordStart, end - wordStart).toLower().toUtf8());
+        wordStart = -1;
+    };
+
+    for (int i = 0; i < text.size(); i++) {
+        uint code = text.at(i).unicode();
+        int length = 1;
+        if (text.at(i).isHighSurrogate() && i + 1 < text.size() && text.at(i + 1).isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            length = 2;
+        }
+
+        if (is_ideograph(code)) {
+            flush(i);
+            tokens.append(text.mid(i, length).toUtf8());
+        } else if (QChar::isLetterOrNumber(code)) {
+            if (wordStart < 0) wordStart = i;
+        } else {
+            flush(i);
+        }
+        i += length - 1;
+    }
+    flush(text.size());
+
+    return tokens;
+}
+
+QString SubtitleIndex::normalize(const QString &text)
+{
+    return text.toLower().simplified();
+}
+
+bool SubtitleIndex::open(const QString &filename)
+{
+    close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QFile::ReadOnly) || m_file.size() < qint64(sizeof(SubtitleIndexHeader))) {
+        m_file.close();
+        return false;
+    }
+
+    m_data = m_file.map(0, m_file.size());
+    const SubtitleIndexHeader *header = reinterpret_cast<const SubtitleIndexHeader *>(m_data);
+    if (!m_data || std::memcmp(header->magic, "SIDX", 4) != 0 || header->version != INDEX_VERSION) {
+        qDebug() << "Invalid subtitle index:" << filename;
+        close();
+        return false;
+    }
+
+    //检查每一段都在文件范围内，之后查询时只需检查段内的偏移
+    uint64_t size = uint64_t(m_file.size());
+    if (header->cueOffset + uint64_t(header->cueCount) * sizeof(SubtitleIndexCue) > size ||
+            header->termOffset + uint64_t(header->termCount) * sizeof(SubtitleIndexTerm) > size ||
+            header->fileOffset + uint64_t(header->fileCount) * sizeof(SubtitleIndexString) > size ||
+            header->postingOffset + header->postingSize > size ||
+            header->stringOffset + header->stringSize > size) {
+        qDebug() << "Invalid subtitle index:" << filename;
+        close();
+        return false;
+    }
+    m_header = header;
+
+    return true;
+}
+
+void SubtitleIndex::close()
+{
+    if (m_data) m_file.unmap(m_data);
+    m_data = nullptr;
+    m_header = nullptr;
+    m_file.close();
+}
+
+QString SubtitleIndex::fileName(int index) const
+{
+    if (index < 0 || index >= fileCount()) return QString();
+
+    const SubtitleIndexString *files = reinterpret_cast<const SubtitleIndexString *>(m_data + m_header->fileOffset);
+    return QString::fromUtf8(string(files[index]));
+}
+
+std::vector<SubtitleHit> SubtitleIndex::search(const QString &query, int limit) const
+{
+    std::vector<SubtitleHit> hits;
+    if (!isOpen()) return hits;
+
+    QList<QByteArray> tokens = tokenize(query);
+    std::sort(tokens.begin(), tokens.end(), less_bytes);
+    tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+    if (tokens.isEmpty()) return hits;
+
+    //任何一个词不存在就没有结果，从最短的倒排表开始求交集
+    std::vector<const SubtitleIndexTerm *> terms;
+    for (const QByteArray &token : tokens) {
+        const SubtitleIndexTerm *term = find_term(token);
+        if (!term) return hits;
+        terms.push_back(term);
+    }
+    std::sort(terms.begin(), terms.end(), [](const SubtitleIndexTerm *a, const SubtitleIndexTerm *b) {
+        return a->postingCount < b->postingCount;
+    });
+
+    std::vector<uint32_t> cues, postings, merged;
+    if (!decode_postings(terms.front(), cues)) return hits;
+    for (size_t i = 1; i < terms.size() && !cues.empty(); i++) {
+        if (!decode_postings(terms[i], postings)) return hits;
+        merged.clear();
+        std::set_intersection(cues.begin(), cues.end(), postings.begin(), postings.end(), std::back_inserter(merged));
+        cues.swap(merged);
+    }
+
+    //词都出现不代表连在一起，用原文确认整个查询串
+    QString needle = normalize(query);
+    const SubtitleIndexCue *table = reinterpret_cast<const SubtitleIndexCue *>(m_data + m_header->cueOffset);
+    for (uint32_t index : cues) {
+        if (limit >= 0 && int(hits.size()) >= limit) break;
+        if (index >= m_header->cueCount) continue;
+
+        const SubtitleIndexCue &cue = table[index];
+        QString text = QString::fromUtf8(string(cue.text));
+        if (!normalize(text).contains(needle)) continue;
+
+        SubtitleHit hit;
+        hit.file = fileName(int(cue.file));
+        hit.start = cue.start;
+        hit.end = cue.end;
+        hit.text = text;
+        hits.push_back(hit);
+    }
+
+    return hits;
+}
+
+QByteArray SubtitleIndex::string(const SubtitleIndexString &string) const
+{
+    //直接引用映射的内存，不拷贝，只在索引打开期间有效
+    if (uint64_t(string.offset) + string.length > m_header->stringSize) return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + m_header->stringOffset + string.offset),
+                                   int(string.length));
+}
+
+const SubtitleIndexTerm *SubtitleIndex::find_term(const QByteArray &term) const
+{
+    const SubtitleIndexTerm *begin = reinterpret_cast<const SubtitleIndexTerm *>(m_data + m_header->termOffset);
+    const SubtitleIndexTerm *end = begin + m_header->termCount;
+    const SubtitleIndexTerm *it = std::lower_bound(begin, end, term, [this](const SubtitleIndexTerm &entry, const QByteArray &value) {
+        return less_bytes(string(entry.term), value);
+    });
+
+    return it != end && string(it->term) == term ? it : nullptr;
+}
+
+bool SubtitleIndex::decode_postings(const SubtitleIndexTerm *term, std::vector<uint32_t> &cues) const
+{
+    cues.clear();
+    if (term->postingOffset > m_header->postingSize) return false;
+
+    const uchar *p = m_data + m_header->postingOffset + term->postingOffset;
+    const uchar *end = m_data + m_header->postingOffset + m_header->postingSize;
+    cues.reserve(term->postingCount);
+
+    uint32_t cue = 0, delta = 0;
+    for (uint32_t i = 0; i < term->postingCount; i++) {
+        if (!read_varint(p, end, delta)) return false;
+        cue += delta;
+        cues.push_back(cue);
+    }
+
+    return true;
+}
+
+void SubtitleIndexBuilder::add(const QString &filename, const QVector<TextCue> &cues)
+{
+    if (cues.isEmpty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    //分词不需要加锁，同一条字幕内重复的词只记一次
+    std::vector<QList<QByteArray>> tokens(size_t(cues.size()));
+    for (int i = 0; i < cues.size(); i++) {
+        QList<QByteArray> &list = tokens[size_t(i)];
+        list = SubtitleIndex::tokenize(cues.at(i).text);
+        std::sort(list.begin(), list.end(), less_bytes);
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    uint32_t file = uint32_t(m_files.size());
+    m_files.push_back(append_string(filename.toUtf8()));
+
+    for (int i = 0; i < cues.size(); i++) {
+        const TextCue &textCue = cues.at(i);
+        uint32_t index = uint32_t(m_cues.size());
+        m_cues.push_back({ textCue.start, textCue.end, file, append_string(textCue.text.toUtf8()) });
+        for (const QByteArray &token : tokens[size_t(i)]) m_postings[token].push_back(index);
+    }
+
+    m_addTime += timer.nsecsElapsed();
+}
+
+bool SubtitleIndexBuilder::write(const QString &filename)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QList<QByteArray> keys = m_postings.keys();
+    std::sort(keys.begin(), keys.end(), less_bytes);
+
+    //词本身追加在字幕文本之后，共用一个字符串区
+    QByteArray strings = m_strings;
+    QByteArray postings;
+    std::vector<SubtitleIndexTerm> terms;
+    terms.reserve(size_t(keys.size()));
+    for (const QByteArray &key : keys) {
+        const std::vector<uint32_t> &cues = m_postings[key];
+        SubtitleIndexTerm term;
+        term.term = { uint32_t(strings.size()), uint32_t(key.size()) };
+        term.postingOffset = uint32_t(postings.size());
+        term.postingCount = uint32_t(cues.size());
+        strings += key;
+
+        uint32_t previous = 0;
+        for (uint32_t cue : cues) {
+            write_varint(postings, cue - previous);
+            previous = cue;
+        }
+        terms.push_back(term);
+    }
+
+    std::vector<SubtitleIndexCue> cues;
+    cues.reserve(m_cues.size());
+    for (const Cue &cue : m_cues) {
+        SubtitleIndexCue entry;
+        entry.start = cue.start;
+        entry.end = cue.end;
+        entry.file = cue.file;
+        entry.text = cue.text;
+        entry.reserved = 0;
+        cues.push_back(entry);
+    }
+
+    SubtitleIndexHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SIDX", 4);
+    header.version = INDEX_VERSION;
+    header.fileCount = uint32_t(m_files.size());
+    header.cueCount = uint32_t(cues.size());
+    header.termCount = uint32_t(terms.size());
+    header.cueOffset = sizeof(SubtitleIndexHeader);
+    header.termOffset = header.cueOffset + cues.size() * sizeof(SubtitleIndexCue);
+    header.fileOffset = header.termOffset + terms.size() * sizeof(SubtitleIndexTerm);
+    header.postingOffset = header.fileOffset + m_files.size() * sizeof(SubtitleIndexString);
+    header.postingSize = uint64_t(postings.size());
+    header.stringOffset = header.postingOffset + header.postingSize;
+    header.stringSize = uint64_t(strings.size());
+
+    QFile file(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Has Error: line =" << __LINE__ << filename;
+        return false;
+    }
+
+    bool ok = file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == qint64(sizeof(header));
+    ok = ok && file.write(reinterpret_cast<const char *>(cues.data()), qint64(cues.size() * sizeof(SubtitleIndexCue))) >= 0;
+    ok = ok && file.write(reinterpret_cast<const char *>(terms.data()), qint64(terms.size() * sizeof(SubtitleIndexTerm))) >= 0;
+    ok = ok && file.write(reinterpret_cast<const char *>(m_files.data()), qint64(m_files.size() * sizeof(SubtitleIndexString))) >= 0;
+    ok = ok && file.write(postings) == postings.size();
+    ok = ok && file.write(strings) == strings.size();
+    if (!ok) {
+        qDebug() << "Has Error: line =" << __LINE__ << filename;
+        file.remove();
+        return false;
+    }
+    m_written = file.size();
+
+    return true;
+}
+
+void SubtitleIndexBuilder::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_files.clear();
+    m_cues.clear();
+    m_postings.clear();
+    m_strings.clear();
+    m_written = 0;
+    m_addTime = 0;
+}
+
+SubtitleIndexBuilder::Statistics SubtitleIndexBuilder::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return Statistics { int(m_files.size()), int(m_cues.size()), m_postings.size(), m_written, m_addTime };
+}
+
+SubtitleIndexString SubtitleIndexBuilder::append_string(const QByteArray &data)
+{
+    SubtitleIndexString string = { uint32_t(m_strings.size()), uint32_t(data.size()) };
+    m_strings += data;
+
+    return string;
+}
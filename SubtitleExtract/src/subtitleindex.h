@@ -0,0 +1,160 @@
+#ifndef SUBTITLEINDEX_H
+#define SUBTITLEINDEX_H
+
+#include "textsubtitle.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * 索引文件格式(小端)，字符串都是 UTF-8 并统一存放在末尾的字符串区：
+ *   SubtitleIndexHeader
+ *   SubtitleIndexCue[cueCount]      按文件、时间顺序，下标即字幕编号
+ *   SubtitleIndexTerm[termCount]    按词的字节序排序，可以二分查找
+ *   SubtitleIndexString[fileCount]  文件路径
+ *   倒排表                          每个词一段，字幕编号差值的 varint 编码
+ *   字符串区
+ * 拉丁文字按单词(小写)切分，中日韩文字每个字单独成词，
+ * 查询时先对所有词的倒排表求交集，再在字幕原文中确认整个查询串
+ */
+struct SubtitleIndexHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t fileCount;
+    uint32_t cueCount;
+    uint32_t termCount;
+    uint32_t reserved;
+    uint64_t cueOffset;
+    uint64_t termOffset;
+    uint64_t fileOffset;
+    uint64_t postingOffset;
+    uint64_t postingSize;
+    uint64_t stringOffset;
+    uint64_t stringSize;
+};
+
+struct SubtitleIndexString
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct SubtitleIndexCue
+{
+    //毫秒
+    int64_t start;
+    int64_t end;
+    uint32_t file;
+    SubtitleIndexString text;
+    uint32_t reserved;
+};
+
+struct SubtitleIndexTerm
+{
+    SubtitleIndexString term;
+    uint32_t postingOffset;
+    uint32_t postingCount;
+};
+
+struct SubtitleHit
+{
+    QString file;
+    qint64 start;
+    qint64 end;
+    QString text;
+};
+
+/**
+ * @brief SubtitleIndex
+ * @note 以内存映射方式打开索引文件，查询只读取用到的词条和倒排表，不需要加载整个索引
+ */
+class SubtitleIndex
+{
+public:
+    SubtitleIndex() { }
+    ~SubtitleIndex() { close(); }
+
+    bool open(const QString &filename);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    int fileCount() const { return int(m_header->fileCount); }
+    int cueCount() const { return int(m_header->cueCount); }
+    int termCount() const { return int(m_header->termCount); }
+    QString fileName(int index) const;
+
+    /**
+     * @brief search
+     * @note 找出包含整个查询串(不区分大小写，空白视为一个空格)的字幕
+     * @return 按加入索引的顺序(同一文件内按流和时间)，最多 limit 条，limit 小于 0 时不限制
+     */
+    std::vector<SubtitleHit> search(const QString &query, int limit = -1) const;
+
+    //切分出索引用的词，已转为小写的 UTF-8
+    static QList<QByteArray> tokenize(const QString &text);
+    //确认查询串时使用的规范化文本
+    static QString normalize(const QString &text);
+
+private:
+    QByteArray string(const SubtitleIndexString &string) const;
+    const SubtitleIndexTerm *find_term(const QByteArray &term) const;
+    bool decode_postings(const SubtitleIndexTerm *term, std::vector<uint32_t> &cues) const;
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    const SubtitleIndexHeader *m_header = nullptr;
+};
+
+/**
+ * @brief SubtitleIndexBuilder
+ * @note 在内存中累积字幕并写出索引文件，add() 可以被多个提取线程同时调用
+ *       分词在锁外完成，锁内只追加字幕和倒排表
+ */
+class SubtitleIndexBuilder
+{
+public:
+    struct Statistics
+    {
+        int files;
+        int cues;
+        int terms;
+        //最近一次写出的文件大小
+        qint64 bytes;
+        //所有线程在 add() 中(分词和插入)耗费的时间之和，纳秒
+        qint64 addTime;
+    };
+
+    void add(const QString &filename, const QVector<TextCue> &cues);
+    bool write(const QString &filename);
+    void clear();
+
+    Statistics statistics() const;
+
+private:
+    struct Cue
+    {
+        qint64 start;
+        qint64 end;
+        uint32_t file;
+        SubtitleIndexString text;
+    };
+
+    SubtitleIndexString append_string(const QByteArray &data);
+
+    mutable QMutex m_mutex;
+    std::vector<SubtitleIndexString> m_files;
+    std::vector<Cue> m_cues;
+    //字幕编号按加入顺序递增，倒排表天然有序
+    QHash<QByteArray, std::vector<uint32_t>> m_postings;
+    QByteArray m_strings;
+    qint64 m_written = 0;
+    qint64 m_addTime = 0;
+};
+
+#endif // SUBTITLEINDEX_H
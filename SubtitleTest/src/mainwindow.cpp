@@ -1,18 +1,16 @@
 #include "mainwindow.h"
+#include "mediapipeline.h"
+#include "parallelimageconverter.h"
+#include "tracing.h"
 
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libavutil/imgutils.h>
-#include <libavutil/opt.h>
-#include <libswscale/swscale.h>
-#include <libavfilter/avfilter.h>
-#include <libavfilter/buffersrc.h>
-#include <libavfilter/buffersink.h>
 }
 
 #include <QApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QDropEvent>
 #include <QFileInfo>
@@ -21,13 +19,14 @@ extern "C"
 #include <QPushButton>
 #include <QPainter>
 #include <QScreen>
+#include <QShortcut>
 #include <QTimer>
 #include <QDebug>
 
 SubtitleDecoder::SubtitleDecoder(QObject *parent)
     : QThread (parent)
 {
-
+    m_frameQueue.monitor().setMetricsName("subtitle.frames");
 }
 
 SubtitleDecoder::~SubtitleDecoder()
@@ -64,132 +63,48 @@ QImage SubtitleDecoder::currentFrame()
 
 void SubtitleDecoder::run()
 {
+    TRACE_THREAD_NAME("SubtitleDecoder");
     demuxing_decoding_video();
 }
 
-bool SubtitleDecoder::init_subtitle_filter(AVFilterContext * &buffersrcContext, AVFilterContext * &buffersinkContext,
-                                           QString args, QString filterDesc)
-{
-    const AVFilter *buffersrc = avfilter_get_by_name("buffer");
-    const AVFilter *buffersink = avfilter_get_by_name("buffersink");
-    AVFilterInOut *output = avfilter_inout_alloc();
-    AVFilterInOut *input = avfilter_inout_alloc();
-    AVFilterGraph *filterGraph = avfilter_graph_alloc();
-
-    auto release = [&output, &input] {
-        avfilter_inout_free(&output);
-        avfilter_inout_free(&input);
-    };
-
-    if (!output || !input || !filterGraph) {
-        release();
-        return false;
-    }
-
-    //创建输入过滤器，需要arg
-    if (avfilter_graph_create_filter(&buffersrcContext, buffersrc, "in",
-                                     args.toStdString().c_str(), nullptr, filterGraph) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    if (avfilter_graph_create_filter(&buffersinkContext, buffersink, "out",
-                                     nullptr, nullptr, filterGraph) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    output->name = av_strdup("in");
-    output->next = nullptr;
-    output->pad_idx = 0;
-    output->filter_ctx = buffersrcContext;
-
-    input->name = av_strdup("out");
-    input->next = nullptr;
-    input->pad_idx = 0;
-    input->filter_ctx = buffersinkContext;
-
-    if (avfilter_graph_parse_ptr(filterGraph, filterDesc.toStdString().c_str(),
-                                 &input, &output, nullptr) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    if (avfilter_graph_config(filterGraph, nullptr) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    release();
-    return true;
-}
-
 void SubtitleDecoder::demuxing_decoding_video()
 {
-    AVFormatContext *formatContext = nullptr;
-    AVCodecContext *codecContext = nullptr;
-    AVCodec *videoDecoder = nullptr;
+    MediaSource source;
+    StreamDecoder decoder;
+    ParallelImageConverter converter;
+    MediaPipeline pipeline;
     AVStream *videoStream = nullptr;
     int videoIndex = -1;
 
     //打开输入文件，并分配格式上下文
-    avformat_open_input(&formatContext, m_filename.toStdString().c_str(), nullptr, nullptr);
-    avformat_find_stream_info(formatContext, nullptr);
-
-    //找到视频流的索引
-    for (size_t i = 0; i < formatContext->nb_streams; ++i) {
-        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoIndex = int(i);
-            videoStream = formatContext->streams[i];
-            break;
-        }
-    }
-
-    if (!videoStream) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    videoDecoder = avcodec_find_decoder(videoStream->codecpar->codec_id);
-
-    if (!videoDecoder) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    codecContext = avcodec_alloc_context3(videoDecoder);
+    decoder.setMetricsName("subtitle.decoder");
 
-    if (!codecContext) {
+    if (!source.open(m_filename.toStdString())) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    avcodec_parameters_to_context(codecContext, videoStream->codecpar);
 
-    if (!codecContext) {
+    //找到视频流的索引，并打开解码器
+    videoIndex = source.findStream(AVMEDIA_TYPE_VIDEO);
+    videoStream = source.stream(videoIndex);
+    if (!decoder.open(videoStream)) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    avcodec_open2(codecContext, videoDecoder, nullptr);
+    AVCodecContext *codecContext = decoder.context();
 
-    m_fps = videoStream->avg_frame_rate.num / videoStream->avg_frame_rate.den;
+    m_fps = videoStream->avg_frame_rate.num > 0 ? qRound(av_q2d(videoStream->avg_frame_rate)) : 25;
     m_width = codecContext->width;
     m_height = codecContext->height;
 
     //打印相关信息，在stderr
-    av_dump_format(formatContext, 0, "format", 0);
-    fflush(stderr);
+    source.dump();
 
-    //初始化filter相关
-    AVRational time_base = videoStream->time_base;
-    QString args = QString::asprintf("video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-                                    m_width, m_height, codecContext->pix_fmt, time_base.num, time_base.den,
-                                    codecContext->sample_aspect_ratio.num, codecContext->sample_aspect_ratio.den);
-    qDebug() << "Video Args: " << args;
-
-    AVFilterContext *buffersrcContext = nullptr;
-    AVFilterContext *buffersinkContext = nullptr;
+    //初始化filter相关，过滤图由 m_filterGraphs 缓存和释放，重新打开同一文件时直接复用
+    FilterGraph::Format filterFormat { m_width, m_height, codecContext->pix_fmt, videoStream->time_base,
+                                       codecContext->sample_aspect_ratio };
+    FilterGraph *filterGraph = nullptr;
+    std::string filterDesc;
 
     //字幕相关，使用subtitles，目前测试的是ass，但srt, ssa, ass, lrc都行，改后缀名即可
     bool subtitleOpened = false;
@@ -202,9 +117,10 @@ void SubtitleDecoder::demuxing_decoding_video()
         //toNativeSeparator()无用，因为只是 / -> \ 的转换
         subtitleFilename.replace('/', "\\\\");
         subtitleFilename.insert(subtitleFilename.indexOf(":\\"), char('\\'));
-        QString filterDesc = QString("subtitles=filename='%1':original_size=%2x%3").arg(subtitleFilename).arg(m_width).arg(m_height);
-        qDebug() << "Filter Description: " << filterDesc.toStdString().c_str();
-        subtitleOpened = init_subtitle_filter(buffersrcContext, buffersinkContext, args, filterDesc);
+        filterDesc = QString("subtitles=filename='%1':original_size=%2x%3").arg(subtitleFilename).arg(m_width).arg(m_height).toStdString();
+        qDebug() << "Filter Description: " << filterDesc.c_str();
+        filterGraph = m_filterGraphs.acquire(filterFormat, filterDesc);
+        subtitleOpened = filterGraph != nullptr;
         if (!subtitleOpened) {
             qDebug() << "字幕打开失败!";
         }
@@ -212,80 +128,59 @@ void SubtitleDecoder::demuxing_decoding_video()
 
     emit resolved();
 
-    //分配并初始化一个临时的帧和包
-    AVPacket *packet = av_packet_alloc();;
-    AVFrame *frame = av_frame_alloc();
-    AVFrame *filter_frame = av_frame_alloc();
-    packet->data = nullptr;
-    packet->size = 0;
-
-    //读取下一帧
-    while (m_runnable && av_read_frame(formatContext, packet) >= 0) {
-        if (packet->stream_index == videoIndex) {
-            //发送给解码器
-            int ret = avcodec_send_packet(codecContext, packet);
-
-            while (ret >= 0) {
-                //从解码器接收解码后的帧
-                ret = avcodec_receive_frame(codecContext, frame);
-
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                else if (ret < 0) goto Run_End;
-
-                //如果字幕成功打开，则输出使用subtitle filter过滤后的图像
-                if (subtitleOpened) {
-                    if (av_buffersrc_add_frame_flags(buffersrcContext, frame, AV_BUFFERSRC_FLAG_KEEP_REF) < 0)
-                        break;
-
-                    while (true) {
-                        ret = av_buffersink_get_frame(buffersinkContext, filter_frame);
-
-                        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                        else if (ret < 0) goto Run_End;
-
-                        int dst_linesize[4];
-                        uint8_t *dst_data[4];
-                        av_image_alloc(dst_data, dst_linesize, m_width, m_height, AV_PIX_FMT_RGB24, 1);
-                        SwsContext *swsContext = sws_getContext(filter_frame->width, filter_frame->height,
-                                                                AVPixelFormat(filter_frame->format), m_width,
-                                                                m_height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-                        sws_scale(swsContext, filter_frame->data, filter_frame->linesize, 0, filter_frame->height, dst_data, dst_linesize);
-                        sws_freeContext(swsContext);
-                        QImage image = QImage(dst_data[0], m_width, m_height, QImage::Format_RGB888).copy();
-                        av_freep(&dst_data[0]);
-
-                        m_frameQueue.enqueue(image);
-                        av_frame_unref(filter_frame);
-                    }
-                } else {
-                    //未找到字幕，直接输出图像
-                    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                    else if (ret < 0) goto Run_End;
-
-                    int dst_linesize[4];
-                    uint8_t *dst_data[4];
-                    av_image_alloc(dst_data, dst_linesize, m_width, m_height, AV_PIX_FMT_RGB24, 1);
-                    SwsContext *swsContext = sws_getContext(m_width, m_height, codecContext->pix_fmt, m_width, m_height, AV_PIX_FMT_RGB24,
-                                                            SWS_BILINEAR, nullptr, nullptr, nullptr);
-                    sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
-                    sws_freeContext(swsContext);
-                    QImage image = QImage(dst_data[0], m_width, m_height, QImage::Format_RGB888).copy();
-                    av_freep(&dst_data[0]);
-
-                    m_frameQueue.enqueue(image);
-
-                }
-                av_frame_unref(frame);
+    AVFramePtr filter_frame = makeFrame();
+
+    //转换为RGB24，直接写入QImage的缓冲，SwsContext 在各帧之间复用
+    auto enqueue_image = [&](const AVFrame *frame) {
+        QImage image(m_width, m_height, QImage::Format_RGB888);
+        uint8_t *dst_data[4] = { image.bits(), nullptr, nullptr, nullptr };
+        int dst_linesize[4] = { image.bytesPerLine(), 0, 0, 0 };
+        if (!converter.convert(frame, m_width, m_height, AV_PIX_FMT_RGB24, dst_data, dst_linesize)) return false;
+
+        m_frameQueue.enqueue(image);
+        return true;
+    };
+
+    pipeline.addDecoder(&decoder);
+    pipeline.addStage(videoIndex, [&](AVFrame *frame) {
+        //未找到字幕，直接输出图像
+        if (!subtitleOpened) {
+            if (!enqueue_image(frame)) pipeline.stop(AVERROR(EINVAL));
+            return true;
+        }
+
+        //如果字幕成功打开，则输出使用subtitle filter过滤后的图像
+        //分辨率或格式中途变化时换成对应的过滤图
+        filterGraph = m_filterGraphs.acquire(filterGraph, frame, videoStream->time_base, filterDesc);
+        if (!filterGraph) {
+            pipeline.stop(AVERROR(EINVAL));
+            return false;
+        }
+        //之后不再使用 frame，直接把引用交给过滤图
+        if (filterGraph->push(frame) < 0) return false;
+
+        while (true) {
+            int ret = filterGraph->pull(filter_frame.get());
+
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
+            else if (ret < 0 || !enqueue_image(filter_frame.get())) {
+                pipeline.stop(ret < 0 ? ret : AVERROR(EINVAL));
+                break;
             }
+
+            av_frame_unref(filter_frame.get());
         }
+        return true;
+    });
 
-        av_packet_unref(packet);
-    }
+    if (pipeline.run(source, m_runnable) < 0)
+        qDebug() << "Has Error: line =" << __LINE__;
 
-Run_End:
-    if (packet) av_packet_free(&packet);
-    if (formatContext) avformat_close_input(&formatContext);
-    if (codecContext) avcodec_free_context(&codecContext);
+    if (filterGraph) {
+        FilterGraph::Statistics statistics = filterGraph->statistics();
+        qDebug() << "Filter Graph:" << filterGraph->filters().c_str() << "frames =" << statistics.pulled
+                 << "push =" << statistics.pushTime / 1000000 << "ms, filter =" << statistics.pullTime / 1000000 << "ms";
+    }
 }
 
 MainWindow::MainWindow(QWidget *parent)
@@ -295,6 +190,16 @@ MainWindow::MainWindow(QWidget *parent)
     setGeometry(size.width(), size.height(), 600, 500);
     setAcceptDrops(true);
 
+#ifdef ENABLE_TRACING
+    //F12 导出追踪数据(Chrome trace JSON)，拖进 Perfetto 查看
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        QString filename = QDateTime::currentDateTime().toString("'trace_'yyyyMMdd_hhmmss'.json'");
+        qDebug() << "[Trace:" << filename << (Tracing::dump(filename.toStdString()) ? "]" : "failed]");
+    });
+#endif
+    TRACE_THREAD_NAME("GUI");
+
     QWidget *widget = new QWidget(this);
     widget->setFixedSize(200, 50);
     QHBoxLayout *layout = new QHBoxLayout(widget);
@@ -344,6 +249,7 @@ MainWindow::~MainWindow()
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
+    TRACE_SCOPE("paint");
     QPainter painter(this);
     if (!m_currentFrame.isNull())
         painter.drawImage(rect(), m_currentFrame);
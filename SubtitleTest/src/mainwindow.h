@@ -1,7 +1,8 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include "bufferqueue.h"
+#include "meteredqueue.h"
+#include "filtergraph.h"
 
 #include <QAudioFormat>
 #include <QMainWindow>
@@ -9,8 +10,8 @@
 #include <QQueue>
 #include <QThread>
 
-class AVRational;
-class AVFilterContext;
+#include <atomic>
+
 class SubtitleDecoder : public QThread
 {
     Q_OBJECT
@@ -35,14 +36,13 @@ protected:
     void run();
 
 private:
-    bool init_subtitle_filter(AVFilterContext *&buffersrc, AVFilterContext *&buffersink,
-                              QString args, QString filterDesc);
     void demuxing_decoding_video();
 
-    bool m_runnable = true;
+    std::atomic_bool m_runnable { true };
     QMutex m_mutex;
     QString m_filename;
-    BufferQueue<QImage> m_frameQueue;
+    MeteredBufferQueue<QImage> m_frameQueue;
+    FilterGraphManager m_filterGraphs;
     int m_fps, m_width, m_height;
 };
 
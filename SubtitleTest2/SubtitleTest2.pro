@@ -14,6 +14,8 @@ TEMPLATE = app
 INCLUDEPATH += $$PWD/../ffmpeg/include \
         $$PWD/../Utility
 
+include($$PWD/../MediaCore/mediacore.pri)
+
 LIBS += -L$$PWD/../ffmpeg/lib/ -lavcodec -lavformat -lavutil -lswscale -lavfilter
 
 # The following define makes your compiler emit warnings if you use
@@ -29,6 +31,9 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 CONFIG += c++11 debug_and_release
 
+# qmake CONFIG+=tracing 打开热路径追踪(TRACE_* 宏)，否则宏展开为空
+tracing: DEFINES += ENABLE_TRACING
+
 CONFIG(debug, debug|release) {
     DESTDIR = $$shell_path(./debug)
 } else {
@@ -42,11 +47,25 @@ win32 {
 }
 
 HEADERS += \
-        src/mainwindow.h
+        src/mainwindow.h \
+        src/subtitleblender.h \
+        src/subtitlecompositor.h \
+        src/subtitleprefetcher.h \
+        src/subtitletrack.h \
+        src/textrenderer.h \
+        src/textsubtitle.h \
+        $$PWD/../Utility/filtergraph.h
 
 SOURCES += \
         src/main.cpp \
-        src/mainwindow.cpp
+        src/mainwindow.cpp \
+        src/subtitleblender.cpp \
+        src/subtitlecompositor.cpp \
+        src/subtitleprefetcher.cpp \
+        src/subtitletrack.cpp \
+        src/textrenderer.cpp \
+        src/textsubtitle.cpp \
+        $$PWD/../Utility/filtergraph.cpp
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -1,9 +1,13 @@
 #include "mainwindow.h"
+#include "metrics.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    //METRICS_INTERVAL=秒 时打开运行指标，定期输出到 stderr
+    MetricsReporter metrics;
+    metrics.startFromEnvironment();
 
     MainWindow window;
     window.show();
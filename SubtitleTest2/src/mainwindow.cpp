@@ -1,25 +1,26 @@
 #include "mainwindow.h"
+#include "mediapipeline.h"
+#include "textsubtitle.h"
+#include "tracing.h"
 
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libavutil/imgutils.h>
-#include <libswscale/swscale.h>
-#include <libavfilter/avfilter.h>
-#include <libavfilter/buffersrc.h>
-#include <libavfilter/buffersink.h>
 }
 
 #include <QApplication>
+#include <QDateTime>
 #include <QDir>
 #include <QDropEvent>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QHBoxLayout>
 #include <QMimeData>
 #include <QPushButton>
 #include <QPainter>
 #include <QScreen>
+#include <QShortcut>
 #include <QTimer>
 #include <QTime>
 #include <QDebug>
@@ -35,18 +36,10 @@ extern "C"
 #define AVERROR_EOF (-int(MKTAG('E', 'O', 'F', ' ')))
 #endif
 
-typedef const char * const_int8_ptr;
-
-struct SubtitleFrame {
-    QImage image;
-    int64_t pts;
-    int64_t duration;
-};
-
 SubtitleDecoder::SubtitleDecoder(QObject *parent)
     : QThread (parent)
 {
-
+    m_frameQueue.monitor().setMetricsName("subtitle.frames");
 }
 
 SubtitleDecoder::~SubtitleDecoder()
@@ -59,6 +52,7 @@ void SubtitleDecoder::stop()
     //必须先重置信号量
     m_frameQueue.init();
     m_runnable = false;
+    m_prefetcher.stop();
     wait();
 }
 
@@ -77,328 +71,245 @@ void SubtitleDecoder::open(const QString &filename)
 QImage SubtitleDecoder::currentFrame()
 {
     QImage image = m_frameQueue.tryDequeue();
-    //Packet packet = m_frameQueue.tryDequeue();
     return image;
 }
 
 void SubtitleDecoder::run()
 {
+    TRACE_THREAD_NAME("SubtitleDecoder");
     demuxing_decoding_video();
 }
 
-bool SubtitleDecoder::init_subtitle_filter(AVFilterContext * &buffersrcContext, AVFilterContext * &buffersinkContext,
-                                           QString args, QString filterDesc)
+QImage SubtitleDecoder::convert_image(AVFrame *frame, const std::vector<const YuvOverlay *> &overlays)
 {
-    const AVFilter *buffersrc = avfilter_get_by_name("buffer");
-    const AVFilter *buffersink = avfilter_get_by_name("buffersink");
-    AVFilterInOut *output = avfilter_inout_alloc();
-    AVFilterInOut *input = avfilter_inout_alloc();
-    AVFilterGraph *filterGraph = avfilter_graph_alloc();
-
-    auto release = [&output, &input] {
-        avfilter_inout_free(&output);
-        avfilter_inout_free(&input);
-    };
-
-    if (!output || !input || !filterGraph) {
-        release();
-        return false;
-    }
+    TRACE_SCOPE("convert_image");
+    //直接写入QImage的缓冲，SwsContext 在各帧之间复用
+    //同一时刻只有一个线程转换：开启过滤线程时由它转换，否则由解码线程转换
+    SwsContext *swsContext = m_converter.context(frame->width, frame->height, AVPixelFormat(frame->format),
+                                                 m_width, m_height, AV_PIX_FMT_RGB24, SWS_BILINEAR, ColorSpace::of(frame));
+    if (!swsContext) return QImage();
+
+    QImage image(m_width, m_height, QImage::Format_RGB888);
+    uint8_t *dst_data[4] = { image.bits(), nullptr, nullptr, nullptr };
+    int dst_linesize[4] = { image.bytesPerLine(), 0, 0, 0 };
+    m_blender.scale(swsContext, frame, overlays, dst_data, dst_linesize);
 
-    //创建输入过滤器，需要arg
-    if (avfilter_graph_create_filter(&buffersrcContext, buffersrc, "in",
-                                     args.toStdString().c_str(), nullptr, filterGraph) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    if (avfilter_graph_create_filter(&buffersinkContext, buffersink, "out",
-                                     nullptr, nullptr, filterGraph) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    output->name = av_strdup("in");
-    output->next = nullptr;
-    output->pad_idx = 0;
-    output->filter_ctx = buffersrcContext;
-
-    input->name = av_strdup("out");
-    input->next = nullptr;
-    input->pad_idx = 0;
-    input->filter_ctx = buffersinkContext;
-
-    if (avfilter_graph_parse_ptr(filterGraph, filterDesc.toStdString().c_str(),
-                                 &input, &output, nullptr) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    if (avfilter_graph_config(filterGraph, nullptr) < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        release();
-        return false;
-    }
-
-    release();
-    return true;
-}
-
-bool SubtitleDecoder::open_codec_context(AVCodecContext *&context, AVStream *stream)
-{
-    AVCodec *dcoder = nullptr;
-
-    if (!stream) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return false;
-    }
-    dcoder = avcodec_find_decoder(stream->codecpar->codec_id);
-
-    if (!dcoder) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return false;
-    }
-    context = avcodec_alloc_context3(dcoder);
-
-    if (!context) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return false;
-    }
-    avcodec_parameters_to_context(context, stream->codecpar);
-
-    if (!context) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return false;
-    }
-    avcodec_open2(context, dcoder, nullptr);
-
-    return true;
+    return image;
 }
 
-QImage SubtitleDecoder::convert_image(AVFrame *frame)
+void SubtitleDecoder::overlay_subtitle(QImage &video, const QImage &subtitle, const QPoint &position)
 {
-    int dst_linesize[4];
-    uint8_t *dst_data[4];
-    av_image_alloc(dst_data, dst_linesize, m_width, m_height, AV_PIX_FMT_RGB24, 1);
-    SwsContext *swsContext = sws_getContext(frame->width, frame->height, AVPixelFormat(frame->format),
-                                            m_width, m_height, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-    sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
-    sws_freeContext(swsContext);
-    QImage image = QImage(dst_data[0], m_width, m_height, QImage::Format_RGB888).copy();
-    av_freep(&dst_data[0]);
-
-    return image;
+    //图块已经是预乘的RGBA，直接画在刚转换出来的帧上，不再复制整帧
+    TRACE_SCOPE("overlay_subtitle");
+    QPainter painter(&video);
+    painter.drawImage(position, subtitle);
 }
 
-QImage SubtitleDecoder::overlay_subtitle(const QImage &video, const QImage &subtitle)
+bool SubtitleDecoder::load_text_subtitles(const QString &baseName)
 {
-    QImage result = video;
-    QPainter painter(&result);
-    QPoint startPos((video.width() - subtitle.width()) / 2, video.height() - subtitle.height() - 20);
-    painter.drawImage(startPos, subtitle);
+    static const char *suffixes[] = { ".ass", ".ssa", ".srt" };
+
+    for (const char *suffix : suffixes) {
+        QVector<TextCue> cues;
+        if (!QFile::exists(baseName + suffix) || !TextSubtitle::load(baseName + suffix, cues)) continue;
+
+        //字幕时间为毫秒，轨道中统一为微秒
+        QElapsedTimer timer;
+        timer.start();
+        for (const TextCue &cue : cues) {
+            m_track.addText(cue.text, av_rescale_q(cue.start, AVRational{ 1, 1000 }, AV_TIME_BASE_Q),
+                            av_rescale_q(cue.end, AVRational{ 1, 1000 }, AV_TIME_BASE_Q));
+        }
+        qDebug() << "[Text subtitles:" << cues.size() << "cues] [Time:" << timer.elapsed() << "ms]";
+        return true;
+    }
 
-    return result;
+    return false;
 }
 
 void SubtitleDecoder::demuxing_decoding_video()
 {
-    AVFormatContext *formatContext = nullptr;
-    AVCodecContext *videoCodecContext = nullptr, *subCodecContext = nullptr;
-    AVStream *videoStream = nullptr, *subStream = nullptr;
+    MediaSource source;
+    StreamDecoder videoDecoder, subDecoder;
+    MediaPipeline pipeline;
+    AVStream *videoStream = nullptr;
     int videoIndex = -1, subIndex = -1;
 
     //打开输入文件，并分配格式上下文
-    avformat_open_input(&formatContext, m_filename.toStdString().c_str(), nullptr, nullptr);
-    avformat_find_stream_info(formatContext, nullptr);
-
-    //找到视频流，字幕流的索引
-    for (size_t i = 0; i < formatContext->nb_streams; ++i) {
-        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            videoIndex = int(i);
-            videoStream = formatContext->streams[i];
-        } else if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
-            subIndex = int(i);
-            subStream = formatContext->streams[i];
-        }
+    videoDecoder.setMetricsName("video.decoder");
+    subDecoder.setMetricsName("subtitle.decoder");
+
+    if (!source.open(m_filename.toStdString())) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
     }
 
+    //找到视频流，以及与它相关的字幕流
+    videoIndex = source.findStream(AVMEDIA_TYPE_VIDEO);
+    videoStream = source.stream(videoIndex);
+    subIndex = source.findStream(AVMEDIA_TYPE_SUBTITLE, videoIndex);
+
     //打印相关信息，在 stderr
-    av_dump_format(formatContext, 0, "format", 0);
-    fflush(stderr);
+    source.dump();
 
-    if (!open_codec_context(videoCodecContext, videoStream)) {
+    if (!videoDecoder.open(videoStream)) {
         qDebug() << "Open Video Context Failed!";
         return;
     }
 
-    if (!open_codec_context(subCodecContext, subStream)) {
+    if (!subDecoder.open(source.stream(subIndex))) {
         //字幕流打开失败，也可能是没有，但无影响，接着处理
         qDebug() << "Open Subtitle Context Failed!";
     }
+    AVCodecContext *videoCodecContext = videoDecoder.context();
+    AVCodecContext *subCodecContext = subDecoder.context();
 
-    m_fps = videoStream->avg_frame_rate.num / videoStream->avg_frame_rate.den;
+    m_fps = videoStream->avg_frame_rate.num > 0 ? qRound(av_q2d(videoStream->avg_frame_rate)) : 25;
     m_width = videoCodecContext->width;
     m_height = videoCodecContext->height;
-
-    //初始化filter相关
-    AVRational time_base = videoStream->time_base;
-    QString args = QString::asprintf("video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
-                                     m_width, m_height, videoCodecContext->pix_fmt, time_base.num, time_base.den,
-                                     videoCodecContext->sample_aspect_ratio.num, videoCodecContext->sample_aspect_ratio.den);
-    qDebug() << "Video Args: " << args;
-
-    AVFilterContext *buffersrcContext = nullptr;
-    AVFilterContext *buffersinkContext = nullptr;
+    m_track.clear();
+    m_track.setVideoFormat(m_width, m_height, videoCodecContext->pix_fmt, videoCodecContext->colorspace, videoCodecContext->color_range);
+
+    //初始化filter相关，过滤图由 m_filterGraphs 缓存和释放，重新打开同一文件时直接复用
+    FilterGraph::Format filterFormat { m_width, m_height, videoCodecContext->pix_fmt, videoStream->time_base,
+                                       videoCodecContext->sample_aspect_ratio };
+    FilterGraph *filterGraph = nullptr;
+    std::string filterDesc;
+    m_filterGraphs.setThreadCount(m_filterThreads);
     bool subtitleOpened = false;
 
-    //如果有字幕流
-    if (subCodecContext) {
+    //如果有字幕流，不使用libass时文本字幕由m_track自行渲染
+    if (subCodecContext && !m_nativeTextSubtitles) {
         //字幕流直接用视频名即可
         QString subtitleFilename = m_filename;
         subtitleFilename.replace('/', "\\\\");
         subtitleFilename.insert(subtitleFilename.indexOf(":\\"), char('\\'));
-        QString filterDesc = QString("subtitles=filename='%1':original_size=%2x%3")
-                .arg(subtitleFilename).arg(m_width).arg(m_height);
-        qDebug() << "Filter Description:" << filterDesc.toStdString().c_str();
-        subtitleOpened = init_subtitle_filter(buffersrcContext, buffersinkContext, args, filterDesc);
+        filterDesc = QString("subtitles=filename='%1':original_size=%2x%3")
+                .arg(subtitleFilename).arg(m_width).arg(m_height).toStdString();
+        qDebug() << "Filter Description:" << filterDesc.c_str();
+        filterGraph = m_filterGraphs.acquire(filterFormat, filterDesc);
+        subtitleOpened = filterGraph != nullptr;
         if (!subtitleOpened) {
             qDebug() << "字幕打开失败!";
         }
-    } else {
+    } else if (!subCodecContext) {
         //没有字幕流时，在同目录下寻找字幕文件
         //字幕相关，使用subtitles，目前测试的是ass，但srt, ssa, ass, lrc都行，改后缀名即可
         int suffixLength = QFileInfo(m_filename).suffix().length();
-        QString subtitleFilename = m_filename.mid(0, m_filename.length() - suffixLength - 1) + ".ass";
-        if (QFile::exists(subtitleFilename)) {
+        QString baseName = m_filename.mid(0, m_filename.length() - suffixLength - 1);
+        QString subtitleFilename = baseName + ".ass";
+        if (!m_nativeTextSubtitles && QFile::exists(subtitleFilename)) {
             //初始化subtitle filter
             //绝对路径必须转成D\:\\xxx\\test.ass这种形式, 记住，是[D\:\\]这种形式
             //toNativeSeparator()无用，因为只是 / -> \ 的转换
             subtitleFilename.replace('/', "\\\\");
             subtitleFilename.insert(subtitleFilename.indexOf(":\\"), char('\\'));
-            QString filterDesc = QString("subtitles=filename='%1':original_size=%2x%3")
-                    .arg(subtitleFilename).arg(m_width).arg(m_height);
-            qDebug() << "Filter Description:" << filterDesc.toStdString().c_str();
-            subtitleOpened = init_subtitle_filter(buffersrcContext, buffersinkContext, args, filterDesc);
+            filterDesc = QString("subtitles=filename='%1':original_size=%2x%3")
+                    .arg(subtitleFilename).arg(m_width).arg(m_height).toStdString();
+            qDebug() << "Filter Description:" << filterDesc.c_str();
+            filterGraph = m_filterGraphs.acquire(filterFormat, filterDesc);
+            subtitleOpened = filterGraph != nullptr;
             if (!subtitleOpened) {
                 qDebug() << "字幕打开失败!";
             }
         }
-    }
 
-    emit resolved();
+        //未使用libass(或打开失败)时自行解析srt / ass
+        if (!subtitleOpened) load_text_subtitles(baseName);
+    }
 
-    //分配并初始化一个临时的帧和包
-    AVPacket *packet = av_packet_alloc();;
-    AVFrame *frame = av_frame_alloc();
-    AVFrame *filter_frame = av_frame_alloc();
-    packet->data = nullptr;
-    packet->size = 0;
+    //字幕由独立的格式上下文整条预读
+    bool prefetched = subCodecContext && !subtitleOpened && m_prefetchSubtitles;
+    if (prefetched) m_prefetcher.prefetch(m_filename, subIndex, !subtitleOpened, &m_track);
 
-    SubtitleFrame subFrame;
+    //过滤和转换都在过滤线程中进行，解码线程只送入帧
+    if (subtitleOpened && m_threadedFilter) {
+        m_filterThread.start(&m_filterGraphs, videoStream->time_base, filterDesc, [this](AVFrame *filtered) {
+            if (m_runnable) m_frameQueue.enqueue(convert_image(filtered, std::vector<const YuvOverlay *>()));
+        });
+    }
 
-    //读取下一帧
-    while (m_runnable && av_read_frame(formatContext, packet) >= 0) {
-        if (packet->stream_index == videoIndex) {
-            //发送给解码器
-            int ret = avcodec_send_packet(videoCodecContext, packet);
+    emit resolved();
 
-            while (ret >= 0) {
-                //从解码器接收解码后的帧
-                ret = avcodec_receive_frame(videoCodecContext, frame);
+    AVFramePtr filter_frame = makeFrame();
+    std::vector<const YuvOverlay *> overlays;
+    m_compositor.reset();
+
+    pipeline.addDecoder(&videoDecoder);
+    pipeline.addStage(videoIndex, [&](AVFrame *frame) {
+        //如果字幕成功打开，则输出使用subtitle filter过滤后的图像
+        if (subtitleOpened && m_threadedFilter) {
+            m_filterThread.push(frame);
+        } else if (subtitleOpened) {
+            //分辨率或格式中途变化时换成对应的过滤图
+            filterGraph = m_filterGraphs.acquire(filterGraph, frame, videoStream->time_base, filterDesc);
+            if (!filterGraph) {
+                pipeline.stop(AVERROR(EINVAL));
+                return false;
+            }
+            //之后不再使用 frame，直接把引用交给过滤图
+            if (filterGraph->push(frame) < 0) return false;
 
-                frame->pts = frame->best_effort_timestamp;
+            while (true) {
+                int ret = filterGraph->pull(filter_frame.get());
 
                 if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                else if (ret < 0) goto Run_End;
-
-                //如果字幕成功打开，则输出使用subtitle filter过滤后的图像
-                if (subtitleOpened) {
-                    if (av_buffersrc_add_frame_flags(buffersrcContext, frame, AV_BUFFERSRC_FLAG_KEEP_REF) < 0)
-                        break;
-
-                    while (true) {
-                        ret = av_buffersink_get_frame(buffersinkContext, filter_frame);
-
-                        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                        else if (ret < 0) goto Run_End;
-
-                        QImage videoImage = convert_image(filter_frame);
-                        m_frameQueue.enqueue(videoImage);
-
-                        av_frame_unref(filter_frame);
-                    }
-                } else {
-                    //未打开字幕过滤器或无字幕
-                    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                    else if (ret < 0) goto Run_End;
-
-                    QImage videoImage = convert_image(frame);
-                    //如果需要显示字幕，就将字幕覆盖上去
-                    if (frame->pts >= subFrame.pts && frame->pts <= (subFrame.pts + subFrame.duration)) {
-                        videoImage = overlay_subtitle(videoImage, subFrame.image);
-                    }
-                    m_frameQueue.enqueue(videoImage);
-                }
-                av_frame_unref(frame);
-            }
-        } else if (packet->stream_index == subIndex) {
-            AVSubtitle subtitle;
-            int got_frame;
-            int ret = avcodec_decode_subtitle2(subCodecContext, &subtitle, &got_frame, packet);
-
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-            else if (ret < 0) goto Run_End;
-
-            if (got_frame > 0) {
-                //如果是图像字幕，即sub + idx
-                //实际上，只需要处理这种即可
-                if (subtitle.format == 0) {
-                    for (size_t i = 0; i < subtitle.num_rects; i++) {
-                        AVSubtitleRect *sub_rect = subtitle.rects[i];
-
-                        int dst_linesize[4];
-                        uint8_t *dst_data[4];
-                        //注意，这里是RGBA格式，需要Alpha
-                        av_image_alloc(dst_data, dst_linesize, sub_rect->w, sub_rect->h, AV_PIX_FMT_RGBA, 1);
-                        SwsContext *swsContext = sws_getContext(sub_rect->w, sub_rect->h, AV_PIX_FMT_PAL8,
-                                                                sub_rect->w, sub_rect->h, AV_PIX_FMT_RGBA,
-                                                                SWS_BILINEAR, nullptr, nullptr, nullptr);
-                        sws_scale(swsContext, sub_rect->data, sub_rect->linesize, 0, sub_rect->h, dst_data, dst_linesize);
-                        sws_freeContext(swsContext);
-                        //这里也使用RGBA
-                        QImage image = QImage(dst_data[0], sub_rect->w, sub_rect->h, QImage::Format_RGBA8888).copy();
-                        av_freep(&dst_data[0]);
-
-                        //subFrame存储当前的字幕
-                        //只有图像字幕才有start_display_time和start_display_time
-                        subFrame.pts = packet->pts;
-                        subFrame.duration = subtitle.end_display_time - subtitle.start_display_time;
-                        subFrame.image = image;
-                    }
-                } else {
-                    //如果是文本格式字幕:srt, ssa, ass, lrc
-                    //可以直接输出文本，实际上已经添加到过滤器中
-                    qreal pts = packet->pts * av_q2d(subStream->time_base);
-                    qreal duration = packet->duration * av_q2d(subStream->time_base);
-                    const char *text = const_int8_ptr(packet->data);
-                    qDebug() << "[PTS: " << pts << "]" << endl
-                             << "[Duration: " << duration << "]" << endl
-                             << "[Text: " << text << "]" << endl;
+                else if (ret < 0) {
+                    pipeline.stop(ret);
+                    break;
                 }
+
+                QImage videoImage = convert_image(filter_frame.get(), std::vector<const YuvOverlay *>());
+                m_frameQueue.enqueue(videoImage);
+
+                av_frame_unref(filter_frame.get());
             }
+        } else {
+            //未打开字幕过滤器或无字幕
+            //如果需要显示字幕，就将字幕覆盖上去，字幕集合不变时复用上次合成的图块
+            //平面YUV在转换前混合，其他格式转换后用QPainter叠加
+            //视频和字幕的时间戳都换算到微秒再比较
+            int64_t time = frame->pts == AV_NOPTS_VALUE ? 0 : av_rescale_q(frame->pts, videoStream->time_base, AV_TIME_BASE_Q);
+            m_compositor.update(m_track, time);
+            overlays.clear();
+            if (m_compositor.overlay()) overlays.push_back(m_compositor.overlay());
+            QImage videoImage = convert_image(frame, overlays);
+            if (!m_compositor.image().isNull())
+                overlay_subtitle(videoImage, m_compositor.image(), m_compositor.imagePosition());
+            m_frameQueue.enqueue(videoImage);
         }
+        return true;
+    });
 
-        av_packet_unref(packet);
+    //字幕由独立的格式上下文整条预读时，这里不再读取字幕包(流水线会在解封装层丢弃)
+    //未预读时随视频一起解码，字幕过滤器打开时文本字幕已经由libass渲染
+    if (subCodecContext && !prefetched) {
+        pipeline.addPacketStage(subIndex, [&](AVPacket *packet) {
+            if (m_track.decode(subCodecContext, packet, !subtitleOpened) < 0)
+                qDebug() << "Decode Subtitle Failed!";
+        });
     }
 
-Run_End:
-    if (packet) av_packet_free(&packet);
-    if (formatContext) avformat_close_input(&formatContext);
-    if (videoCodecContext) avcodec_free_context(&videoCodecContext);
-    if (subCodecContext) avcodec_free_context(&subCodecContext);
+    if (pipeline.run(source, m_runnable) < 0)
+        qDebug() << "Has Error: line =" << __LINE__;
+
+    m_prefetcher.stop();
+    if (m_filterThread.isRunning()) {
+        //正常结束时等待剩余的帧过滤完，被停止时直接丢弃
+        if (m_runnable) m_filterThread.finish();
+        else m_filterThread.stop();
+        filterGraph = m_filterThread.graph();
+    }
+    if (m_compositor.statistics().frames > 0) {
+        SubtitleCompositor::Statistics statistics = m_compositor.statistics();
+        qDebug() << "[Subtitle composite:" << statistics.composed << "] [Skipped:" << statistics.skipped
+                 << "/" << statistics.frames << "frames]";
+    }
+    if (filterGraph) {
+        FilterGraph::Statistics statistics = filterGraph->statistics();
+        qDebug() << "Filter Graph:" << filterGraph->filters().c_str() << "frames =" << statistics.pulled
+                 << "push =" << statistics.pushTime / 1000000 << "ms, filter =" << statistics.pullTime / 1000000 << "ms";
+    }
 }
 
 MainWindow::MainWindow(QWidget *parent)
@@ -408,6 +319,16 @@ MainWindow::MainWindow(QWidget *parent)
     setGeometry(size.width(), size.height(), 600, 500);
     setAcceptDrops(true);
 
+#ifdef ENABLE_TRACING
+    //F12 导出追踪数据(Chrome trace JSON)，拖进 Perfetto 查看
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        QString filename = QDateTime::currentDateTime().toString("'trace_'yyyyMMdd_hhmmss'.json'");
+        qDebug() << "[Trace:" << filename << (Tracing::dump(filename.toStdString()) ? "]" : "failed]");
+    });
+#endif
+    TRACE_THREAD_NAME("GUI");
+
     QWidget *widget = new QWidget(this);
     widget->setFixedSize(200, 50);
     QHBoxLayout *layout = new QHBoxLayout(widget);
@@ -457,6 +378,7 @@ MainWindow::~MainWindow()
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
+    TRACE_SCOPE("paint");
 
     static bool running = false;
 
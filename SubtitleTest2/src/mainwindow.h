@@ -1,15 +1,20 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include "bufferqueue.h"
+#include "meteredqueue.h"
+#include "filtergraph.h"
+#include "imageconverter.h"
+#include "subtitlecompositor.h"
+#include "subtitleprefetcher.h"
+#include "subtitletrack.h"
 
 #include <QMainWindow>
 #include <QMutex>
 #include <QQueue>
 #include <QThread>
 
-class AVRational;
-class AVFilterContext;
+#include <atomic>
+
 class AVCodecContext;
 class AVStream;
 class AVFrame;
@@ -26,6 +31,27 @@ public:
     int width() const { return m_width; }
     int height() const { return m_height; }
     void open(const QString &filename);
+    /**
+     * @brief setPrefetchSubtitles
+     * @note 打开时用独立的线程预读整条内封字幕轨道(默认)，否则随视频交错读取
+     */
+    void setPrefetchSubtitles(bool prefetch) { m_prefetchSubtitles = prefetch; }
+    /**
+     * @brief setFilterThreads
+     * @note 字幕过滤图的 slice 线程数，0 为自动(默认)，1 为单线程
+     */
+    void setFilterThreads(int threads) { m_filterThreads = threads; }
+    /**
+     * @brief setThreadedFilter
+     * @note 字幕过滤图在独立的线程中运行(默认)，libass 渲染与视频解码并行，否则在解码线程中过滤
+     */
+    void setThreadedFilter(bool threaded) { m_threadedFilter = threaded; }
+    /**
+     * @brief setNativeTextSubtitles
+     * @note 文本字幕(外挂srt/ass、内封ass)不经过libass，由内置的解析和字形图集渲染，
+     *       只支持纯文本和基本的换行，默认关闭
+     */
+    void setNativeTextSubtitles(bool native) { m_nativeTextSubtitles = native; }
 
     QImage currentFrame();
 
@@ -37,18 +63,27 @@ protected:
     void run();
 
 private:
-    QImage convert_image(AVFrame *frame);
-    QImage overlay_subtitle(const QImage &video, const QImage &subtitle);
+    QImage convert_image(AVFrame *frame, const std::vector<const YuvOverlay *> &overlays);
+    void overlay_subtitle(QImage &video, const QImage &subtitle, const QPoint &position);
 
-    bool init_subtitle_filter(AVFilterContext *&buffersrc, AVFilterContext *&buffersink,
-                              QString args, QString filterDesc);
-    bool open_codec_context(AVCodecContext * &context, AVStream *stream);
+    bool load_text_subtitles(const QString &baseName);
     void demuxing_decoding_video();
 
-    bool m_runnable = true;
+    std::atomic_bool m_runnable { true };
     QMutex m_mutex;
     QString m_filename;
-    BufferQueue<QImage> m_frameQueue;
+    MeteredBufferQueue<QImage> m_frameQueue;
+    SubtitleBlender m_blender;
+    ImageConverter m_converter;
+    SubtitleTrack m_track;
+    SubtitleCompositor m_compositor;
+    SubtitlePrefetcher m_prefetcher;
+    FilterGraphManager m_filterGraphs;
+    FilterThread m_filterThread;
+    bool m_prefetchSubtitles = true;
+    bool m_threadedFilter = true;
+    bool m_nativeTextSubtitles = false;
+    int m_filterThreads = 0;
     int m_fps, m_width, m_height;
 };
 
@@ -0,0 +1,207 @@
+#include "subtitleblender.h"
+#include "imageconverter.h"
+#include "imagedsp.h"
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libswscale/swscale.h>
+}
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+//与 YUV -> RGB 转换(ImageConverter)相同的矩阵和范围，字幕颜色才与转换回来的结果一致
+struct ColorMatrix
+{
+    double kr, kb;
+    bool fullRange;
+};
+
+ColorMatrix color_matrix(AVPixelFormat format, AVColorSpace colorspace, AVColorRange range)
+{
+    ColorSpace colorSpace = ColorSpace::of(format, colorspace, range);
+    ColorMatrix matrix;
+    ImageDsp::lumaWeights(colorSpace.matrix, matrix.kr, matrix.kb);
+    matrix.fullRange = colorSpace.fullRange;
+
+    return matrix;
+}
+
+inline uint8_t clamp_u8(double value)
+{
+    return uint8_t(std::min(255.0, std::max(0.0, value + 0.5)));
+}
+
+void rgb_to_yuv(const ColorMatrix &m, uint32_t argb, uint8_t *y, uint8_t *u, uint8_t *v)
+{
+    double r = (argb >> 16) & 0xFF, g = (argb >> 8) & 0xFF, b = argb & 0xFF;
+    double luma = m.kr * r + (1.0 - m.kr - m.kb) * g + m.kb * b;
+    double cb = (b - luma) / (2.0 * (1.0 - m.kb));
+    double cr = (r - luma) / (2.0 * (1.0 - m.kr));
+
+    if (m.fullRange) {
+        *y = clamp_u8(luma);
+        *u = clamp_u8(128.0 + cb);
+        *v = clamp_u8(128.0 + cr);
+    } else {
+        *y = clamp_u8(16.0 + luma * 219.0 / 255.0);
+        *u = clamp_u8(128.0 + cb * 224.0 / 255.0);
+        *v = clamp_u8(128.0 + cr * 224.0 / 255.0);
+    }
+}
+
+} //namespace
+
+bool SubtitleBlender::isSupported(AVPixelFormat format)
+{
+    switch (format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV422P:
+    case AV_PIX_FMT_YUVJ422P:
+    case AV_PIX_FMT_YUV444P:
+    case AV_PIX_FMT_YUVJ444P:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SubtitleBlender::prepare(YuvOverlay &overlay, const uint8_t *rgba, int stride, int width, int height, int x, int y,
+                              int frameWidth, int frameHeight, AVPixelFormat format, AVColorSpace colorspace, AVColorRange range)
+{
+    overlay = YuvOverlay();
+    if (!isSupported(format) || width <= 0 || height <= 0) return false;
+
+    overlay.format = format;
+    overlay.chromaShiftW = format == AV_PIX_FMT_YUV444P || format == AV_PIX_FMT_YUVJ444P ? 0 : 1;
+    overlay.chromaShiftH = format == AV_PIX_FMT_YUV420P || format == AV_PIX_FMT_YUVJ420P ? 1 : 0;
+    int maskW = (1 << overlay.chromaShiftW) - 1, maskH = (1 << overlay.chromaShiftH) - 1;
+
+    //对齐到色度网格，并裁掉超出画面的部分
+    overlay.x = std::max(0, x) & ~maskW;
+    overlay.y = std::max(0, y) & ~maskH;
+    int offsetX = overlay.x - x, offsetY = overlay.y - y;
+    overlay.width = std::min(width - offsetX, frameWidth - overlay.x) & ~maskW;
+    overlay.height = std::min(height - offsetY, frameHeight - overlay.y) & ~maskH;
+    if (overlay.isNull()) return false;
+
+    ColorMatrix matrix = color_matrix(format, colorspace, range);
+    int w = overlay.width, h = overlay.height;
+    overlay.planes[0].resize(size_t(w) * h);
+    overlay.alpha[0].resize(size_t(w) * h);
+    std::vector<uint8_t> u(size_t(w) * h), v(size_t(w) * h);
+
+    //先转换为全分辨率的 YUVA，混合使用非预乘 alpha，需要先还原颜色
+    for (int j = 0; j < h; j++) {
+        int sy = j + offsetY;
+        for (int i = 0; i < w; i++) {
+            int sx = i + offsetX;
+            size_t k = size_t(j) * w + i;
+            //对齐时向左上扩展出的像素在图块之外，视为透明
+            if (sx < 0 || sy < 0 || sx >= width || sy >= height) {
+                overlay.planes[0][k] = u[k] = v[k] = overlay.alpha[0][k] = 0;
+                continue;
+            }
+            const uint8_t *p = rgba + sy * stride + sx * 4;
+            int a = p[3];
+            uint32_t argb = 0;
+            if (a) {
+                argb = uint32_t(std::min(255, (p[0] * 255 + a / 2) / a)) << 16 |
+                       uint32_t(std::min(255, (p[1] * 255 + a / 2) / a)) << 8 |
+                       uint32_t(std::min(255, (p[2] * 255 + a / 2) / a));
+            }
+            rgb_to_yuv(matrix, argb, &overlay.planes[0][k], &u[k], &v[k]);
+            overlay.alpha[0][k] = uint8_t(a);
+        }
+    }
+
+    //色度按块降采样：alpha 取平均，颜色按 alpha 加权，避免透明像素的颜色渗进边缘
+    int cw = overlay.chromaWidth(), ch = overlay.chromaHeight();
+    int blockW = 1 << overlay.chromaShiftW, blockH = 1 << overlay.chromaShiftH;
+    overlay.planes[1].resize(size_t(cw) * ch);
+    overlay.planes[2].resize(size_t(cw) * ch);
+    overlay.alpha[1].resize(size_t(cw) * ch);
+    for (int j = 0; j < ch; j++) {
+        for (int i = 0; i < cw; i++) {
+            int sumA = 0, sumU = 0, sumV = 0;
+            for (int by = 0; by < blockH; by++) {
+                for (int bx = 0; bx < blockW; bx++) {
+                    size_t k = size_t(j * blockH + by) * w + i * blockW + bx;
+                    int a = overlay.alpha[0][k];
+                    sumA += a;
+                    sumU += u[k] * a;
+                    sumV += v[k] * a;
+                }
+            }
+            size_t c = size_t(j) * cw + i;
+            int count = blockW * blockH;
+            overlay.alpha[1][c] = uint8_t((sumA + count / 2) / count);
+            overlay.planes[1][c] = sumA ? uint8_t((sumU + sumA / 2) / sumA) : 128;
+            overlay.planes[2][c] = sumA ? uint8_t((sumV + sumA / 2) / sumA) : 128;
+        }
+    }
+
+    return true;
+}
+
+void SubtitleBlender::scale(SwsContext *swsContext, const AVFrame *frame, const std::vector<const YuvOverlay *> &overlays,
+                            uint8_t *const dst[], const int dstStride[])
+{
+    //帧格式与准备时不同(如中途切换了分辨率或格式)的不混合
+    std::vector<const YuvOverlay *> valid;
+    int top = frame->height, bottom = 0;
+    for (const YuvOverlay *overlay : overlays) {
+        if (overlay->isNull() || overlay->format != frame->format ||
+                overlay->y + overlay->height > frame->height || overlay->x + overlay->width > frame->width) continue;
+        valid.push_back(overlay);
+        top = std::min(top, overlay->y);
+        bottom = std::max(bottom, overlay->y + overlay->height);
+    }
+
+    if (valid.empty()) {
+        sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst, dstStride);
+        return;
+    }
+
+    const uint8_t *src[4] = { nullptr, nullptr, nullptr, nullptr };
+    int srcStride[4] = { frame->linesize[0], frame->linesize[1], frame->linesize[2], 0 };
+    int shiftH = valid.front()->chromaShiftH;
+
+    //上方不受影响的行直接转换
+    if (top > 0) sws_scale(swsContext, frame->data, frame->linesize, 0, top, dst, dstStride);
+
+    //字幕覆盖的行：复制整行(sws_scale 需要整行)，只在各字幕范围内混合
+    for (int p = 0; p < 3; p++) {
+        int sh = p ? shiftH : 0;
+        int rows = (bottom >> sh) - (top >> sh);
+        m_rows[p].resize(size_t(frame->linesize[p]) * rows);
+        std::memcpy(m_rows[p].data(), frame->data[p] + (top >> sh) * frame->linesize[p], m_rows[p].size());
+
+        for (const YuvOverlay *overlay : valid) {
+            int sw = p ? overlay->chromaShiftW : 0;
+            int width = p ? overlay->chromaWidth() : overlay->width;
+            int height = p ? overlay->chromaHeight() : overlay->height;
+            const uint8_t *alpha = overlay->alpha[p ? 1 : 0].data();
+            const uint8_t *plane = overlay->planes[p].data();
+            uint8_t *rows = m_rows[p].data() + ((overlay->y - top) >> sh) * frame->linesize[p] + (overlay->x >> sw);
+            for (int r = 0; r < height; r++)
+                ImageDsp::blend(rows + r * frame->linesize[p], plane + r * width, alpha + r * width, width);
+        }
+        src[p] = m_rows[p].data();
+    }
+    sws_scale(swsContext, src, srcStride, top, bottom - top, dst, dstStride);
+
+    //下方不受影响的行
+    if (bottom < frame->height) {
+        for (int p = 0; p < 3; p++) {
+            int sh = p ? shiftH : 0;
+            src[p] = frame->data[p] + (bottom >> sh) * frame->linesize[p];
+        }
+        sws_scale(swsContext, src, srcStride, bottom, frame->height - bottom, dst, dstStride);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SUBTITLEBLENDER_H
+#define SUBTITLEBLENDER_H
+
+extern "C"
+{
+#include <libavutil/pixfmt.h>
+}
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief YuvOverlay
+ * @note 由调色板位图预先转换好的 YUVA 平面，只在字幕解码时转换一次
+ *       色度平面和色度 alpha 按视频的色度采样缩小，位置已对齐到色度网格
+ */
+struct YuvOverlay
+{
+    AVPixelFormat format = AV_PIX_FMT_NONE;
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+    int chromaShiftW = 0, chromaShiftH = 0;
+    //Y U V
+    std::vector<uint8_t> planes[3];
+    //亮度 alpha 和色度 alpha
+    std::vector<uint8_t> alpha[2];
+
+    bool isNull() const { return width <= 0 || height <= 0; }
+    int chromaWidth() const { return width >> chromaShiftW; }
+    int chromaHeight() const { return height >> chromaShiftH; }
+};
+
+class AVFrame;
+class SwsContext;
+/**
+ * @brief SubtitleBlender
+ * @note 在 RGB 转换之前把字幕直接混合进 8 位平面 YUV
+ *       解码器输出的帧仍被解码器引用(参考帧)，不能原地修改：
+ *       只复制字幕覆盖的那几行到内部缓冲区混合，再按 上/中/下 三个切片送入 sws_scale
+ */
+class SubtitleBlender
+{
+public:
+    static bool isSupported(AVPixelFormat format);
+
+    /**
+     * @brief prepare
+     * @note 按视频的格式、色彩空间和范围把预乘的 RGBA 图块转换为 YUVA
+     *       (x, y) 为图块在视频中的位置，会向下对齐到色度网格，超出画面的部分被裁掉
+     * @return 格式不支持或裁剪后为空时返回false
+     */
+    static bool prepare(YuvOverlay &overlay, const uint8_t *rgba, int stride, int width, int height, int x, int y,
+                        int frameWidth, int frameHeight, AVPixelFormat format, AVColorSpace colorspace, AVColorRange range);
+
+    /**
+     * @brief scale
+     * @note 相当于 sws_scale(frame)，overlays 为空时不做任何额外工作
+     */
+    void scale(SwsContext *swsContext, const AVFrame *frame, const std::vector<const YuvOverlay *> &overlays,
+               uint8_t *const dst[], const int dstStride[]);
+
+private:
+    std::vector<uint8_t> m_rows[3];
+};
+
+#endif // SUBTITLEBLENDER_H
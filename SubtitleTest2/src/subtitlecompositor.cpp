@@ -0,0 +1,168 @@
+#include "subtitlecompositor.h"
+#include "tracing.h"
+
+#include <QPainter>
+
+#include <algorithm>
+
+namespace
+{
+
+/**
+ * @brief compose_row
+ * @note 把一行 src 按 alpha 叠在 dst 之上(非预乘的 over)，同一 alpha 的几个平面(U 和 V)一起处理，
+ *       必须用叠加前的 dst alpha 计算所有平面后再更新 alpha
+ */
+void compose_row(uint8_t *const dst[], uint8_t *dstAlpha, const uint8_t *const src[], const uint8_t *srcAlpha,
+                 int planes, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int as = srcAlpha[i];
+        if (!as) continue;
+        int ad = dstAlpha[i];
+
+        //结果 alpha(放大 255 倍)：as + ad * (1 - as)
+        int below = ad * (255 - as);
+        int total = as * 255 + below;
+        for (int p = 0; p < planes; p++)
+            dst[p][i] = uint8_t((src[p][i] * as * 255 + dst[p][i] * below + total / 2) / total);
+        dstAlpha[i] = uint8_t((total + 127) / 255);
+    }
+}
+
+} //namespace
+
+bool SubtitleCompositor::update(const SubtitleTrack &track, int64_t time)
+{
+    TRACE_SCOPE("subtitle_composite");
+    m_statistics.frames++;
+
+    //仍在上次的有效区间内，且轨道没有加入新字幕
+    int revision = track.revision();
+    if (revision == m_revision && time >= m_from && time < m_until) {
+        m_statistics.skipped++;
+        return false;
+    }
+
+    std::vector<SubtitleEventPtr> events;
+    track.active(time, events);
+
+    //下一次变化：下一个字幕开始，或当前某个字幕结束
+    m_from = time;
+    m_until = track.nextStart(time);
+    for (const SubtitleEventPtr &event : events) m_until = std::min(m_until, event->end);
+    m_revision = revision;
+
+    if (events == m_events) {
+        m_statistics.skipped++;
+        return false;
+    }
+
+    m_events.swap(events);
+    compose();
+    m_statistics.composed++;
+
+    return true;
+}
+
+void SubtitleCompositor::reset()
+{
+    m_events.clear();
+    m_from = 0;
+    m_until = -1;
+    m_revision = -1;
+    m_overlay = nullptr;
+    m_merged = YuvOverlay();
+    m_image = QImage();
+    m_statistics = Statistics { 0, 0, 0 };
+}
+
+void SubtitleCompositor::compose()
+{
+    std::vector<const YuvOverlay *> overlays;
+    std::vector<const SubtitleEvent *> painted;
+    for (const SubtitleEventPtr &event : m_events) {
+        if (!event->overlay.isNull()) overlays.push_back(&event->overlay);
+        else if (!event->image.isNull()) painted.push_back(event.get());
+    }
+
+    compose_overlays(overlays);
+
+    //QImage 隐式共享，只有一个字幕时不拷贝
+    m_image = QImage();
+    if (painted.size() == 1) {
+        m_image = painted.front()->image;
+        m_imagePosition = painted.front()->position;
+    } else if (painted.size() > 1) {
+        QRect bounds;
+        for (const SubtitleEvent *event : painted) bounds |= QRect(event->position, event->image.size());
+
+        m_image = QImage(bounds.size(), QImage::Format_RGBA8888_Premultiplied);
+        m_image.fill(Qt::transparent);
+        m_imagePosition = bounds.topLeft();
+        QPainter painter(&m_image);
+        for (const SubtitleEvent *event : painted)
+            painter.drawImage(event->position - bounds.topLeft(), event->image);
+    }
+}
+
+void SubtitleCompositor::compose_overlays(const std::vector<const YuvOverlay *> &overlays)
+{
+    m_overlay = nullptr;
+    m_merged = YuvOverlay();
+    if (overlays.empty()) return;
+    if (overlays.size() == 1) {
+        m_overlay = overlays.front();
+        return;
+    }
+
+    //同一轨道的图块格式相同，且都已对齐到色度网格，合并后的范围也是对齐的
+    const YuvOverlay *first = overlays.front();
+    int left = first->x, top = first->y;
+    int right = first->x + first->width, bottom = first->y + first->height;
+    for (const YuvOverlay *overlay : overlays) {
+        left = std::min(left, overlay->x);
+        top = std::min(top, overlay->y);
+        right = std::max(right, overlay->x + overlay->width);
+        bottom = std::max(bottom, overlay->y + overlay->height);
+    }
+
+    m_merged.format = first->format;
+    m_merged.chromaShiftW = first->chromaShiftW;
+    m_merged.chromaShiftH = first->chromaShiftH;
+    m_merged.x = left;
+    m_merged.y = top;
+    m_merged.width = right - left;
+    m_merged.height = bottom - top;
+
+    int w = m_merged.width, h = m_merged.height;
+    int cw = m_merged.chromaWidth(), ch = m_merged.chromaHeight();
+    m_merged.planes[0].assign(size_t(w) * h, 0);
+    m_merged.planes[1].assign(size_t(cw) * ch, 128);
+    m_merged.planes[2].assign(size_t(cw) * ch, 128);
+    m_merged.alpha[0].assign(size_t(w) * h, 0);
+    m_merged.alpha[1].assign(size_t(cw) * ch, 0);
+
+    //按开始时间的顺序，后开始的在上
+    for (const YuvOverlay *overlay : overlays) {
+        if (overlay->format != m_merged.format) continue;
+
+        int dx = overlay->x - left, dy = overlay->y - top;
+        for (int r = 0; r < overlay->height; r++) {
+            size_t d = size_t(dy + r) * w + dx, s = size_t(r) * overlay->width;
+            uint8_t *dst[1] = { m_merged.planes[0].data() + d };
+            const uint8_t *src[1] = { overlay->planes[0].data() + s };
+            compose_row(dst, m_merged.alpha[0].data() + d, src, overlay->alpha[0].data() + s, 1, overlay->width);
+        }
+
+        int cx = dx >> m_merged.chromaShiftW, cy = dy >> m_merged.chromaShiftH;
+        for (int r = 0; r < overlay->chromaHeight(); r++) {
+            size_t d = size_t(cy + r) * cw + cx, s = size_t(r) * overlay->chromaWidth();
+            uint8_t *dst[2] = { m_merged.planes[1].data() + d, m_merged.planes[2].data() + d };
+            const uint8_t *src[2] = { overlay->planes[1].data() + s, overlay->planes[2].data() + s };
+            compose_row(dst, m_merged.alpha[1].data() + d, src, overlay->alpha[1].data() + s, 2, overlay->chromaWidth());
+        }
+    }
+
+    m_overlay = &m_merged;
+}
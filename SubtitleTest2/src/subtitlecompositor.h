@@ -0,0 +1,59 @@
+#ifndef SUBTITLECOMPOSITOR_H
+#define SUBTITLECOMPOSITOR_H
+
+#include "subtitletrack.h"
+
+/**
+ * @brief SubtitleCompositor
+ * @note 字幕每秒最多变化几次，而视频每帧都要叠加：
+ *       记录当前字幕集合保持不变的时间区间 [from, until)，区间内的帧不再查询轨道，
+ *       直接复用上次合成好的 YUVA 图块(多个字幕预先合成为一个)和 RGBA 图块
+ *       轨道有新字幕加入(预读线程)时也会重新合成
+ */
+class SubtitleCompositor
+{
+public:
+    struct Statistics
+    {
+        int64_t frames;
+        //字幕集合变化，重新合成的次数
+        int64_t composed;
+        //复用上次合成结果的帧数
+        int64_t skipped;
+    };
+
+    /**
+     * @brief update
+     * @note 每帧调用一次
+     * @return 需要叠加的内容与上一帧不同时返回true
+     */
+    bool update(const SubtitleTrack &track, int64_t time);
+    void reset();
+
+    //平面 YUV 视频在转换前混合，没有时为nullptr
+    const YuvOverlay *overlay() const { return m_overlay; }
+    //无法按 YUV 混合的字幕合成的预乘 RGBA 图块，转换后用 QPainter 叠加
+    const QImage &image() const { return m_image; }
+    QPoint imagePosition() const { return m_imagePosition; }
+
+    Statistics statistics() const { return m_statistics; }
+
+private:
+    void compose();
+    void compose_overlays(const std::vector<const YuvOverlay *> &overlays);
+
+    std::vector<SubtitleEventPtr> m_events;
+    int64_t m_from = 0;
+    int64_t m_until = -1;
+    int m_revision = -1;
+
+    //只有一个字幕时直接指向它的图块，多个时指向 m_merged
+    const YuvOverlay *m_overlay = nullptr;
+    YuvOverlay m_merged;
+    QImage m_image;
+    QPoint m_imagePosition;
+
+    Statistics m_statistics { 0, 0, 0 };
+};
+
+#endif // SUBTITLECOMPOSITOR_H
@@ -0,0 +1,101 @@
+#include "subtitleprefetcher.h"
+#include "avhandle.h"
+#include "subtitletrack.h"
+#include "tracing.h"
+
+#include <QElapsedTimer>
+#include <QDebug>
+
+SubtitlePrefetcher::SubtitlePrefetcher(QObject *parent)
+    : QThread (parent)
+{
+
+}
+
+SubtitlePrefetcher::~SubtitlePrefetcher()
+{
+    stop();
+}
+
+void SubtitlePrefetcher::prefetch(const QString &filename, int streamIndex, bool renderText, SubtitleTrack *track)
+{
+    stop();
+
+    m_filename = filename;
+    m_streamIndex = streamIndex;
+    m_renderText = renderText;
+    m_track = track;
+    m_runnable = true;
+
+    start();
+}
+
+void SubtitlePrefetcher::stop()
+{
+    m_runnable = false;
+    wait();
+}
+
+void SubtitlePrefetcher::run()
+{
+    TRACE_THREAD_NAME("SubtitlePrefetcher");
+    AVFormatInputPtr formatContext;
+    AVCodecContextPtr codecContext;
+    AVCodec *decoder = nullptr;
+    AVStream *stream = nullptr;
+    AVPacketPtr packet;
+    int events = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    formatContext = openInput(m_filename.toStdString().c_str());
+    if (!formatContext) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+
+    //流信息通常在文件头中，只有在头里找不到这个流(如 MPEG-PS)时才探测
+    if (m_streamIndex >= int(formatContext->nb_streams)) avformat_find_stream_info(formatContext.get(), nullptr);
+    if (m_streamIndex < 0 || m_streamIndex >= int(formatContext->nb_streams)) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+
+    //只读取字幕流，其他流的包在解封装层就跳过
+    for (unsigned i = 0; i < formatContext->nb_streams; i++)
+        formatContext->streams[i]->discard = int(i) == m_streamIndex ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    stream = formatContext->streams[m_streamIndex];
+
+    decoder = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!decoder) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+    codecContext.reset(avcodec_alloc_context3(decoder));
+    if (!codecContext || avcodec_parameters_to_context(codecContext.get(), stream->codecpar) < 0) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+    //字幕的显示时间按包的时间基换算
+    codecContext->pkt_timebase = stream->time_base;
+    if (avcodec_open2(codecContext.get(), decoder, nullptr) < 0) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+
+    packet = makePacket();
+    if (!packet) {
+        qDebug() << "Has Error: line =" << __LINE__;
+        return;
+    }
+    while (m_runnable && av_read_frame(formatContext.get(), packet.get()) >= 0) {
+        if (packet->stream_index == m_streamIndex) {
+            int added = m_track->decode(codecContext.get(), packet.get(), m_renderText);
+            if (added > 0) events += added;
+        }
+        av_packet_unref(packet.get());
+    }
+
+    qDebug() << "[Subtitle prefetch:" << events << "events] [Time:" << timer.elapsed() << "ms]";
+    if (m_runnable) emit prefetched(events);
+}
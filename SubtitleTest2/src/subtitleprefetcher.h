@@ -0,0 +1,42 @@
+#ifndef SUBTITLEPREFETCHER_H
+#define SUBTITLEPREFETCHER_H
+
+#include <QThread>
+
+class SubtitleTrack;
+/**
+ * @brief SubtitlePrefetcher
+ * @note 用第二个只包含字幕流的格式上下文(其他流全部 AVDISCARD_ALL)，
+ *       与视频解码并行地预先解码整条字幕轨道，字幕封装得再靠后也不会晚于对应的视频帧
+ */
+class SubtitlePrefetcher : public QThread
+{
+    Q_OBJECT
+
+public:
+    SubtitlePrefetcher(QObject *parent = nullptr);
+    ~SubtitlePrefetcher();
+
+    /**
+     * @brief prefetch
+     * @param renderText 为false时忽略文本字幕(已由libass渲染)
+     * @param track 必须在预读结束(或stop())之前一直有效
+     */
+    void prefetch(const QString &filename, int streamIndex, bool renderText, SubtitleTrack *track);
+    void stop();
+
+signals:
+    void prefetched(int events);
+
+protected:
+    void run();
+
+private:
+    bool m_runnable = true;
+    QString m_filename;
+    int m_streamIndex = -1;
+    bool m_renderText = false;
+    SubtitleTrack *m_track = nullptr;
+};
+
+#endif // SUBTITLEPREFETCHER_H
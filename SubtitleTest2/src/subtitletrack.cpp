@@ -0,0 +1,291 @@
+#include "subtitletrack.h"
+#include "textsubtitle.h"
+#include "tracing.h"
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <QPainter>
+
+#include <algorithm>
+
+//与原来的叠加位置一致：底部居中，距底边 20 像素
+static const int BOTTOM_MARGIN = 20;
+static const int TEXT_OUTLINE = 2;
+
+void SubtitleTrack::setVideoFormat(int width, int height, AVPixelFormat format, AVColorSpace colorspace, AVColorRange range)
+{
+    m_width = width;
+    m_height = height;
+    m_format = format;
+    m_colorspace = colorspace;
+    m_range = range;
+
+    m_font = QFont();
+    m_font.setPixelSize(qMax(12, m_height / 18));
+    m_textRenderer.setFont(m_font, TEXT_OUTLINE);
+}
+
+void SubtitleTrack::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+    m_open.clear();
+    m_maxEnd.clear();
+    m_dirty = false;
+    m_revision++;
+}
+
+int SubtitleTrack::decode(AVCodecContext *context, AVPacket *packet, bool renderText)
+{
+    TRACE_SCOPE("decode_subtitle");
+    AVSubtitle subtitle;
+    int got_frame = 0;
+    if (avcodec_decode_subtitle2(context, &subtitle, &got_frame, packet) < 0) return -1;
+    if (!got_frame) return 0;
+
+    //包的 pts 为显示的基准，start/end_display_time 是相对它的毫秒偏移
+    AVRational timeBase = context->pkt_timebase.num ? context->pkt_timebase : AVRational{ 1, 1000 };
+    int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    int added = 0;
+
+    if (pts != AV_NOPTS_VALUE) {
+        int64_t base = av_rescale_q(pts, timeBase, AV_TIME_BASE_Q);
+        int64_t start = base + int64_t(subtitle.start_display_time) * 1000;
+        int64_t end = UntilNext;
+        if (subtitle.end_display_time > subtitle.start_display_time && subtitle.end_display_time != UINT32_MAX)
+            end = base + int64_t(subtitle.end_display_time) * 1000;
+        else if (packet->duration > 0)
+            end = base + av_rescale_q(packet->duration, timeBase, AV_TIME_BASE_Q);
+
+        if (subtitle.format == 0 || renderText) {
+            //图像字幕，即sub + idx / PGS，没有 rect 的为清屏
+            //文本字幕:srt, ssa, ass, lrc
+            added = add(&subtitle, start, end);
+        }
+    }
+    avsubtitle_free(&subtitle);
+
+    return added;
+}
+
+int SubtitleTrack::add(const AVSubtitle *subtitle, int64_t start, int64_t end)
+{
+    close_open(start);
+
+    int added = 0;
+    QRect bounds;
+    QString text;
+
+    //多个位图 rect 保持相互之间的位置，整体放在底部居中
+    for (unsigned i = 0; i < subtitle->num_rects; i++) {
+        const AVSubtitleRect *rect = subtitle->rects[i];
+        if (rect->type == SUBTITLE_BITMAP && rect->w > 0 && rect->h > 0) {
+            bounds |= QRect(rect->x, rect->y, rect->w, rect->h);
+        } else if (rect->type == SUBTITLE_ASS && rect->ass) {
+            if (!text.isEmpty()) text += '\n';
+            text += TextSubtitle::assEventText(rect->ass);
+        } else if (rect->type == SUBTITLE_TEXT && rect->text) {
+            if (!text.isEmpty()) text += '\n';
+            text += QString::fromUtf8(rect->text);
+        }
+    }
+
+    QPoint origin((m_width - bounds.width()) / 2 - bounds.x(), m_height - bounds.height() - BOTTOM_MARGIN - bounds.y());
+    for (unsigned i = 0; i < subtitle->num_rects; i++) {
+        const AVSubtitleRect *rect = subtitle->rects[i];
+        if (rect->type != SUBTITLE_BITMAP || rect->w <= 0 || rect->h <= 0) continue;
+        add(make_event(render_bitmap(rect), origin + QPoint(rect->x, rect->y), start, end));
+        added++;
+    }
+
+    added += addText(text, start, end);
+
+    return added;
+}
+
+int SubtitleTrack::addText(const QString &text, int64_t start, int64_t end)
+{
+    QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) return 0;
+
+    QImage image = render_text(trimmed);
+    QPoint position((m_width - image.width()) / 2, m_height - image.height() - BOTTOM_MARGIN);
+    add(make_event(image, position, start, end));
+
+    return 1;
+}
+
+void SubtitleTrack::add(const SubtitleEventPtr &event)
+{
+    QMutexLocker locker(&m_mutex);
+    //通常按时间顺序到达，直接追加
+    auto it = m_events.end();
+    if (!m_events.empty() && m_events.back()->start > event->start) {
+        it = std::upper_bound(m_events.begin(), m_events.end(), event->start,
+                              [](int64_t start, const SubtitleEventPtr &e) { return start < e->start; });
+    }
+    m_events.insert(it, event);
+    if (event->end == UntilNext) m_open.push_back(event);
+    m_dirty = true;
+    m_revision++;
+}
+
+void SubtitleTrack::active(int64_t time, std::vector<SubtitleEventPtr> &events) const
+{
+    QMutexLocker locker(&m_mutex);
+    events.clear();
+    if (m_events.empty()) return;
+    if (m_dirty) {
+        m_maxEnd.resize(m_events.size());
+        build_index(0, int(m_events.size()));
+        m_dirty = false;
+    }
+
+    query(0, int(m_events.size()), time, events);
+}
+
+int64_t SubtitleTrack::nextStart(int64_t time) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = std::upper_bound(m_events.begin(), m_events.end(), time,
+                               [](int64_t t, const SubtitleEventPtr &e) { return t < e->start; });
+
+    return it == m_events.end() ? INT64_MAX : (*it)->start;
+}
+
+int SubtitleTrack::size() const
+{
+    QMutexLocker locker(&m_mutex);
+    return int(m_events.size());
+}
+
+SubtitleEventPtr SubtitleTrack::make_event(const QImage &image, const QPoint &position, int64_t start, int64_t end) const
+{
+    std::shared_ptr<SubtitleEvent> event = std::make_shared<SubtitleEvent>();
+    event->start = start;
+    event->end = end;
+    event->position = position;
+    event->image = image;
+    SubtitleBlender::prepare(event->overlay, image.constBits(), image.bytesPerLine(), image.width(), image.height(),
+                             position.x(), position.y(), m_width, m_height, m_format, m_colorspace, m_range);
+
+    return event;
+}
+
+QImage SubtitleTrack::render_bitmap(const AVSubtitleRect *rect) const
+{
+    //调色板最多 256 色，先预乘整张调色板，再逐像素查表，不需要 sws
+    uint8_t palette[256][4] = {};
+    const uint32_t *argb = reinterpret_cast<const uint32_t *>(rect->data[1]);
+    for (int i = 0; i < qMin(rect->nb_colors, 256); i++) {
+        uint32_t a = argb[i] >> 24;
+        palette[i][0] = uint8_t((((argb[i] >> 16) & 0xFF) * a + 127) / 255);
+        palette[i][1] = uint8_t((((argb[i] >> 8) & 0xFF) * a + 127) / 255);
+        palette[i][2] = uint8_t(((argb[i] & 0xFF) * a + 127) / 255);
+        palette[i][3] = uint8_t(a);
+    }
+
+    QImage image(rect->w, rect->h, QImage::Format_RGBA8888_Premultiplied);
+    for (int y = 0; y < rect->h; y++) {
+        const uint8_t *index = rect->data[0] + y * rect->linesize[0];
+        uint8_t *line = image.scanLine(y);
+        for (int x = 0; x < rect->w; x++)
+            std::copy(palette[index[x]], palette[index[x]] + 4, line + x * 4);
+    }
+
+    return image;
+}
+
+QImage SubtitleTrack::render_text(const QString &text) const
+{
+    //优先从字形图集拼出，字体缺字时用 QPainter 排版(带字体回退)
+    QImage image = m_textRenderer.render(text);
+    if (image.isNull()) image = paint_text(text);
+
+    return image;
+}
+
+QImage SubtitleTrack::paint_text(const QString &text) const
+{
+    QFontMetrics metrics(m_font);
+    QRect bounds = metrics.boundingRect(QRect(0, 0, m_width, m_height), Qt::AlignHCenter | Qt::AlignBottom, text);
+    const int outline = TEXT_OUTLINE;
+
+    QImage image(bounds.width() + 2 * outline, bounds.height() + 2 * outline, QImage::Format_RGBA8888_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setFont(m_font);
+    QRect area(outline, outline, bounds.width(), bounds.height());
+
+    //简单描边：先在周围画一圈黑色，再画白色
+    painter.setPen(Qt::black);
+    for (int dx = -outline; dx <= outline; dx += outline) {
+        for (int dy = -outline; dy <= outline; dy += outline) {
+            if (dx || dy) painter.drawText(area.translated(dx, dy), Qt::AlignHCenter | Qt::AlignBottom, text);
+        }
+    }
+    painter.setPen(Qt::white);
+    painter.drawText(area, Qt::AlignHCenter | Qt::AlignBottom, text);
+
+    return image;
+}
+
+void SubtitleTrack::close_open(int64_t time)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_open.empty()) return;
+
+    for (auto it = m_open.begin(); it != m_open.end();) {
+        if ((*it)->start >= time) {
+            ++it;
+            continue;
+        }
+
+        //字幕生成后不再修改，换成结束时间确定的副本(只在字幕切换时发生一次)
+        std::shared_ptr<SubtitleEvent> closed = std::make_shared<SubtitleEvent>(**it);
+        closed->end = time;
+        //等待结束的字幕总是最近加入的，从后往前找
+        for (auto event = m_events.rbegin(); event != m_events.rend(); ++event) {
+            if (*event == *it) {
+                *event = closed;
+                break;
+            }
+        }
+        it = m_open.erase(it);
+        m_dirty = true;
+        m_revision++;
+    }
+}
+
+int64_t SubtitleTrack::build_index(int lo, int hi) const
+{
+    if (lo >= hi) return INT64_MIN;
+
+    //先算左右子树，再算根
+    int mid = (lo + hi) / 2;
+    int64_t maxEnd = std::max(m_events[size_t(mid)]->end, std::max(build_index(lo, mid), build_index(mid + 1, hi)));
+    m_maxEnd[size_t(mid)] = maxEnd;
+
+    return maxEnd;
+}
+
+void SubtitleTrack::query(int lo, int hi, int64_t time, std::vector<SubtitleEventPtr> &events) const
+{
+    if (lo >= hi) return;
+
+    int mid = (lo + hi) / 2;
+    //子树中所有字幕都已结束
+    if (m_maxEnd[size_t(mid)] <= time) return;
+
+    query(lo, mid, time, events);
+
+    //右子树的 start 都不小于根的 start，根还没开始则右子树也不用看
+    const SubtitleEventPtr &event = m_events[size_t(mid)];
+    if (event->start > time) return;
+    if (time < event->end) events.push_back(event);
+
+    query(mid + 1, hi, time, events);
+}
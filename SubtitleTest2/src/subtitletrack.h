@@ -0,0 +1,120 @@
+#ifndef SUBTITLETRACK_H
+#define SUBTITLETRACK_H
+
+#include "subtitleblender.h"
+#include "textrenderer.h"
+
+#include <QImage>
+#include <QMutex>
+#include <QPoint>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief SubtitleEvent
+ * @note 一个已经渲染好的字幕图块，生成后不再修改，可以在多个帧之间共享
+ */
+struct SubtitleEvent
+{
+    //显示区间 [start, end)，单位为微秒(AV_TIME_BASE)，end 为 SubtitleTrack::UntilNext 时显示到下一个字幕开始
+    int64_t start = 0;
+    int64_t end = 0;
+    //图块在视频中的位置
+    QPoint position;
+    //预乘的 RGBA 图块，QPainter 可以直接叠加
+    QImage image;
+    //同一图块转换好的 YUVA，视频为平面 YUV 时在转换前混合
+    YuvOverlay overlay;
+};
+
+typedef std::shared_ptr<const SubtitleEvent> SubtitleEventPtr;
+
+class AVCodecContext;
+class AVPacket;
+class AVSubtitle;
+class AVSubtitleRect;
+/**
+ * @brief SubtitleTrack
+ * @note 整条字幕轨道：每个位图/文本字幕只渲染一次，按显示区间存入区间树
+ *       区间树是按 start 排序的数组上的隐式平衡二叉树，每个节点记录子树中最大的 end，
+ *       查询某一时刻的全部字幕为 O(log n + k)
+ *       可以由预读线程加入、解码线程查询
+ */
+class SubtitleTrack
+{
+public:
+    //没有结束时间的字幕(如 PGS、部分 dvdsub)，由下一个字幕(包括空的清屏字幕)的开始时间结束
+    static const int64_t UntilNext = INT64_MAX;
+
+    /**
+     * @brief setVideoFormat
+     * @note 图块的位置和 YUVA 转换都依赖视频的格式，必须在 add() 之前设置
+     */
+    void setVideoFormat(int width, int height, AVPixelFormat format, AVColorSpace colorspace, AVColorRange range);
+    void clear();
+
+    /**
+     * @brief decode
+     * @note 解码一个字幕包并加入轨道，renderText 为false时忽略文本字幕(已由libass渲染)
+     *       包的时间基取自 context->pkt_timebase(打开解码器时设为流的时间基)，统一换算为微秒
+     * @return 加入的图块数，解码出错时返回负数
+     */
+    int decode(AVCodecContext *context, AVPacket *packet, bool renderText);
+
+    /**
+     * @brief add
+     * @note 渲染一个解码后的字幕(可能包含多个 rect)并加入轨道，先结束 start 之前还在等待下一个字幕的字幕
+     * @return 加入的图块数
+     */
+    int add(const AVSubtitle *subtitle, int64_t start, int64_t end);
+    /**
+     * @brief addText
+     * @note 渲染一条纯文本字幕(可多行)，放在底部居中
+     * @return 加入的图块数
+     */
+    int addText(const QString &text, int64_t start, int64_t end);
+    void add(const SubtitleEventPtr &event);
+
+    /**
+     * @brief active
+     * @note 取出 time(微秒) 时刻需要显示的全部字幕，按 start 排序
+     */
+    void active(int64_t time, std::vector<SubtitleEventPtr> &events) const;
+    //time 之后第一个开始的字幕的 start，没有时返回 INT64_MAX
+    int64_t nextStart(int64_t time) const;
+    int size() const;
+    //每次加入或清空时递增，用于判断缓存的查询结果是否过期
+    int revision() const { return m_revision; }
+
+private:
+    SubtitleEventPtr make_event(const QImage &image, const QPoint &position, int64_t start, int64_t end) const;
+    QImage render_bitmap(const AVSubtitleRect *rect) const;
+    QImage render_text(const QString &text) const;
+    QImage paint_text(const QString &text) const;
+    void close_open(int64_t time);
+    int64_t build_index(int lo, int hi) const;
+    void query(int lo, int hi, int64_t time, std::vector<SubtitleEventPtr> &events) const;
+
+    int m_width = 0, m_height = 0;
+    AVPixelFormat m_format = AV_PIX_FMT_NONE;
+    AVColorSpace m_colorspace = AVCOL_SPC_UNSPECIFIED;
+    AVColorRange m_range = AVCOL_RANGE_UNSPECIFIED;
+    QFont m_font;
+    //字形图集在整条轨道的所有文本字幕之间共用
+    mutable TextRenderer m_textRenderer;
+
+    mutable QMutex m_mutex;
+    //按 start 排序
+    std::vector<SubtitleEventPtr> m_events;
+    //end 为 UntilNext 的字幕
+    std::vector<SubtitleEventPtr> m_open;
+    //区间 [lo, hi) 的根为 (lo + hi) / 2，m_maxEnd[根] 为该子树中最大的 end
+    //字幕基本按时间顺序加入，插入时只标记，查询前再重建
+    mutable std::vector<int64_t> m_maxEnd;
+    mutable bool m_dirty = false;
+    std::atomic_int m_revision { 0 };
+};
+
+#endif // SUBTITLETRACK_H
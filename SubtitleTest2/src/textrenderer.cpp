@@ -0,0 +1,152 @@
+#include "textrenderer.h"
+
+#include <QPainter>
+#include <QPainterPath>
+#include <QStringList>
+
+#include <cmath>
+
+//图集中相邻字形之间留 1 像素的间隔
+static const int ATLAS_PADDING = 1;
+
+TextRenderer::TextRenderer(int atlasSize)
+    : m_atlas(atlasSize, atlasSize, QImage::Format_RGBA8888_Premultiplied)
+{
+    m_atlas.fill(Qt::transparent);
+}
+
+void TextRenderer::setFont(const QFont &font, int outline)
+{
+    QMutexLocker locker(&m_mutex);
+    //整个 QFont 比较：字体族、字重以及按磅设置的大小(pixelSize() 为 -1)变化时都要重建
+    if (m_font.isValid() && font == m_sourceFont && outline == m_outline) return;
+
+    m_font = QRawFont::fromFont(font);
+    m_sourceFont = font;
+    m_outline = outline;
+    reset();
+}
+
+QImage TextRenderer::render(const QString &text)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_font.isValid()) return QImage();
+
+    QStringList lines = text.split('\n');
+    QVector<QVector<quint32>> glyphs;
+    QVector<QVector<QPointF>> advances;
+    QVector<qreal> widths;
+    qreal maxWidth = 0;
+
+    for (const QString &line : lines) {
+        QVector<quint32> indexes = m_font.glyphIndexesForString(line);
+        //0 为 .notdef，字体里没有这个字
+        if (indexes.contains(0)) return QImage();
+
+        QVector<QPointF> lineAdvances = m_font.advancesForGlyphIndexes(indexes);
+        qreal width = 0;
+        for (const QPointF &advance : lineAdvances) width += advance.x();
+        glyphs.append(indexes);
+        advances.append(lineAdvances);
+        widths.append(width);
+        maxWidth = qMax(maxWidth, width);
+    }
+
+    int margin = m_outline + ATLAS_PADDING;
+    int lineHeight = int(std::ceil(m_font.ascent() + m_font.descent() + m_font.leading()));
+    QImage image(int(std::ceil(maxWidth)) + 2 * margin, lineHeight * lines.size() + 2 * margin,
+                 QImage::Format_RGBA8888_Premultiplied);
+    image.fill(Qt::transparent);
+
+    //先画所有描边再画所有填充，相邻字的描边不会压住前一个字
+    QPainter painter(&image);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < glyphs.size(); i++) {
+            qreal x = margin + (maxWidth - widths[i]) / 2;
+            int baseline = margin + i * lineHeight + int(std::ceil(m_font.ascent()));
+            for (int j = 0; j < glyphs[i].size(); j++) {
+                Glyph cached = glyph(glyphs[i][j]);
+                const QRect &source = pass == 0 ? cached.outline : cached.fill;
+                if (!source.isEmpty())
+                    painter.drawImage(QPoint(int(std::lround(x)), baseline) + cached.offset, m_atlas, source);
+                x += advances[i][j].x();
+            }
+        }
+    }
+
+    return image;
+}
+
+TextRenderer::Glyph TextRenderer::glyph(quint32 index)
+{
+    auto it = m_glyphs.constFind(index);
+    if (it != m_glyphs.constEnd()) {
+        m_hits++;
+        return it.value();
+    }
+    m_misses++;
+
+    Glyph glyph;
+    QPainterPath path = m_font.pathForGlyph(index);
+    if (path.isEmpty()) {
+        m_glyphs.insert(index, glyph);
+        return glyph;
+    }
+
+    QRect bounds = path.boundingRect().toAlignedRect().adjusted(-m_outline - 1, -m_outline - 1, m_outline + 1, m_outline + 1);
+    QPoint outlinePosition, fillPosition;
+    //图集满时整张清空重来，已经生成的字幕图块不受影响
+    if (!allocate(bounds.size(), outlinePosition) || !allocate(bounds.size(), fillPosition)) {
+        reset();
+        if (!allocate(bounds.size(), outlinePosition) || !allocate(bounds.size(), fillPosition)) return glyph;
+    }
+
+    QPainter painter(&m_atlas);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    painter.translate(outlinePosition - bounds.topLeft());
+    painter.setPen(QPen(Qt::black, 2 * m_outline, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    painter.setBrush(Qt::black);
+    painter.drawPath(path);
+
+    painter.resetTransform();
+    painter.translate(fillPosition - bounds.topLeft());
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(Qt::white);
+    painter.drawPath(path);
+
+    glyph.outline = QRect(outlinePosition, bounds.size());
+    glyph.fill = QRect(fillPosition, bounds.size());
+    glyph.offset = bounds.topLeft();
+    m_glyphs.insert(index, glyph);
+
+    return glyph;
+}
+
+bool TextRenderer::allocate(const QSize &size, QPoint &position)
+{
+    int width = size.width() + ATLAS_PADDING, height = size.height() + ATLAS_PADDING;
+    if (width > m_atlas.width() || height > m_atlas.height()) return false;
+
+    //当前行放不下就换到下一行
+    if (m_shelfX + width > m_atlas.width()) {
+        m_shelfY += m_shelfHeight;
+        m_shelfX = 0;
+        m_shelfHeight = 0;
+    }
+    if (m_shelfY + height > m_atlas.height()) return false;
+
+    position = QPoint(m_shelfX, m_shelfY);
+    m_shelfX += width;
+    m_shelfHeight = qMax(m_shelfHeight, height);
+
+    return true;
+}
+
+void TextRenderer::reset()
+{
+    m_glyphs.clear();
+    m_atlas.fill(Qt::transparent);
+    m_shelfX = m_shelfY = m_shelfHeight = 0;
+}
@@ -0,0 +1,66 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRawFont>
+
+/**
+ * @brief TextRenderer
+ * @note 轻量的文本字幕渲染：用 QRawFont 把字形(描边和填充各一份)光栅化进一张图集，
+ *       之后的字幕直接从图集中拼出，同一个字在整条轨道中只光栅化一次
+ *       不做复杂排版(连字、双向文本、字体回退)，有字形缺失时由调用者改用 QPainter
+ */
+class TextRenderer
+{
+public:
+    TextRenderer(int atlasSize = 1024);
+
+    /**
+     * @brief setFont
+     * @note 字体或描边宽度变化时清空图集
+     */
+    void setFont(const QFont &font, int outline);
+
+    /**
+     * @brief render
+     * @note 多行文本逐行居中，白字黑边
+     * @return 预乘的 RGBA 图块；字体中缺少某个字形时返回空的 QImage
+     */
+    QImage render(const QString &text);
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    struct Glyph
+    {
+        //图集中的位置，空白字符为空
+        QRect outline;
+        QRect fill;
+        //图块左上角相对于基线上笔位置的偏移
+        QPoint offset;
+    };
+
+    Glyph glyph(quint32 index);
+    bool allocate(const QSize &size, QPoint &position);
+    void reset();
+
+    QMutex m_mutex;
+    QRawFont m_font;
+    //m_font 由它生成
+    QFont m_sourceFont;
+    int m_outline = 0;
+
+    QImage m_atlas;
+    QHash<quint32, Glyph> m_glyphs;
+    //按行(shelf)分配：当前行的起点和高度
+    int m_shelfX = 0, m_shelfY = 0, m_shelfHeight = 0;
+
+    int m_hits = 0;
+    int m_misses = 0;
+};
+
+#endif // TEXTRENDERER_H
@@ -0,0 +1,125 @@
+#include "textsubtitle.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QStringList>
+
+namespace
+{
+
+//H:MM:SS.cc(ASS) 或 HH:MM:SS,mmm(SRT)，小数部分补齐或截断到 3 位即为毫秒(超过 3 位的精度舍去)
+qint64 parse_time(const QString &hours, const QString &minutes, const QString &seconds, const QString &fraction)
+{
+    qint64 ms = (fraction + "00").left(3).toInt();
+
+    return ((hours.toInt() * 60LL + minutes.toInt()) * 60LL + seconds.toInt()) * 1000LL + ms;
+}
+
+} //namespace
+
+bool TextSubtitle::load(const QString &filename, QVector<TextCue> &cues)
+{
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) return false;
+
+    QByteArray data = file.readAll();
+    //去掉 UTF-8 BOM
+    if (data.startsWith("\xEF\xBB\xBF")) data.remove(0, 3);
+    QString content = QString::fromUtf8(data.constData(), data.size());
+
+    QString suffix = QFileInfo(filename).suffix().toLower();
+    if (suffix == "srt") return parseSrt(content, cues);
+    else if (suffix == "ass" || suffix == "ssa") return parseAss(content, cues);
+
+    return false;
+}
+
+bool TextSubtitle::parseSrt(const QString &content, QVector<TextCue> &cues)
+{
+    static const QRegularExpression timing("(\\d+):(\\d+):(\\d+)[,.](\\d+)\\s*-->\\s*(\\d+):(\\d+):(\\d+)[,.](\\d+)");
+    static const QRegularExpression tags("<[^>]*>");
+    int count = cues.size();
+    TextCue cue;
+    bool inCue = false;
+
+    //序号行可有可无，以时间行开始，空行结束
+    for (const QString &raw : content.split(QRegularExpression("\r?\n"))) {
+        QString line = raw.trimmed();
+        QRegularExpressionMatch match = timing.match(line);
+        if (match.hasMatch()) {
+            if (inCue && !cue.text.isEmpty()) cues.append(cue);
+            cue = TextCue();
+            cue.start = parse_time(match.captured(1), match.captured(2), match.captured(3), match.captured(4));
+            cue.end = parse_time(match.captured(5), match.captured(6), match.captured(7), match.captured(8));
+            inCue = true;
+        } else if (line.isEmpty()) {
+            if (inCue && !cue.text.isEmpty()) cues.append(cue);
+            inCue = false;
+        } else if (inCue) {
+            line.remove(tags);
+            if (!cue.text.isEmpty()) cue.text += '\n';
+            cue.text += line;
+        }
+    }
+    if (inCue && !cue.text.isEmpty()) cues.append(cue);
+
+    return cues.size() > count;
+}
+
+bool TextSubtitle::parseAss(const QString &content, QVector<TextCue> &cues)
+{
+    static const QRegularExpression timing("(\\d+):(\\d+):(\\d+)\\.(\\d+)");
+    int count = cues.size();
+    bool inEvents = false;
+    //[Events] 中 Format 行给出的列序，Text 总是最后一列
+    int startColumn = 1, endColumn = 2, textColumn = 9;
+
+    for (const QString &raw : content.split(QRegularExpression("\r?\n"))) {
+        QString line = raw.trimmed();
+        if (line.startsWith("[")) {
+            inEvents = line.toLower() == "[events]";
+            continue;
+        }
+        if (!inEvents) continue;
+
+        if (line.startsWith("Format:")) {
+            QStringList columns = line.mid(7).split(',');
+            for (int i = 0; i < columns.size(); i++) {
+                QString column = columns.at(i).trimmed().toLower();
+                if (column == "start") startColumn = i;
+                else if (column == "end") endColumn = i;
+                else if (column == "text") textColumn = i;
+            }
+        } else if (line.startsWith("Dialogue:")) {
+            QString fields = line.mid(9);
+            QRegularExpressionMatch start = timing.match(fields.section(',', startColumn, startColumn).trimmed());
+            QRegularExpressionMatch end = timing.match(fields.section(',', endColumn, endColumn).trimmed());
+            if (!start.hasMatch() || !end.hasMatch()) continue;
+
+            TextCue cue;
+            cue.start = parse_time(start.captured(1), start.captured(2), start.captured(3), start.captured(4));
+            cue.end = parse_time(end.captured(1), end.captured(2), end.captured(3), end.captured(4));
+            //文本中可能有逗号，取 Text 列之后的全部内容
+            cue.text = assToPlainText(fields.section(',', textColumn)).trimmed();
+            if (!cue.text.isEmpty() && cue.end > cue.start) cues.append(cue);
+        }
+    }
+
+    return cues.size() > count;
+}
+
+QString TextSubtitle::assToPlainText(const QString &text)
+{
+    static const QRegularExpression tags("\\{[^}]*\\}");
+    QString plain = text;
+    plain.remove(tags);
+    plain.replace("\\N", "\n").replace("\\n", "\n").replace("\\h", " ");
+
+    return plain;
+}
+
+QString TextSubtitle::assEventText(const char *event)
+{
+    return assToPlainText(QString::fromUtf8(event).section(',', 8));
+}
@@ -0,0 +1,40 @@
+#ifndef TEXTSUBTITLE_H
+#define TEXTSUBTITLE_H
+
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief TextCue
+ * @note 一条文本字幕，时间单位为毫秒
+ */
+struct TextCue
+{
+    qint64 start = 0;
+    qint64 end = 0;
+    QString text;
+};
+
+/**
+ * @brief TextSubtitle
+ * @note 不依赖 libass 的 SRT / ASS 解析，只取出显示时间和纯文本(样式标签全部去掉)
+ */
+class TextSubtitle
+{
+public:
+    /**
+     * @brief load
+     * @note 按后缀(.srt / .ass / .ssa)解析 UTF-8 字幕文件
+     * @return 文件无法打开或没有任何字幕时返回false
+     */
+    static bool load(const QString &filename, QVector<TextCue> &cues);
+    static bool parseSrt(const QString &content, QVector<TextCue> &cues);
+    static bool parseAss(const QString &content, QVector<TextCue> &cues);
+
+    //ASS 对话的 Text 转为纯文本：去掉 {...} 标签，\N \n 换行，\h 空格
+    static QString assToPlainText(const QString &text);
+    //解码器输出的 ASS 事件：ReadOrder,Layer,Style,Name,MarginL,MarginR,MarginV,Effect,Text
+    static QString assEventText(const char *event);
+};
+
+#endif // TEXTSUBTITLE_H
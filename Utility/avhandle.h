@@ -0,0 +1,87 @@
+#ifndef AVHANDLE_H
+#define AVHANDLE_H
+
+#include <cstdint>
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavfilter/avfilter.h>
+#include <libavformat/avformat.h>
+#include <libswresample/swresample.h>
+#include <libswscale/swscale.h>
+}
+
+#include <memory>
+
+/**
+ * FFmpeg 资源的 unique_ptr 包装，析构(包括提前 return 和异常)时调用对应的释放函数
+ * 删除器没有状态，unique_ptr 与裸指针一样大，释放时也只是一次直接调用，没有额外开销
+ * 需要 T** 输出参数的函数(如 avformat_open_input)先用裸指针接收，成功后再 reset()
+ */
+struct AVFormatInputDeleter
+{
+    //只用于 avformat_open_input 打开的输入
+    void operator()(AVFormatContext *context) const { avformat_close_input(&context); }
+};
+
+struct AVCodecContextDeleter
+{
+    void operator()(AVCodecContext *context) const { avcodec_free_context(&context); }
+};
+
+struct AVFrameDeleter
+{
+    void operator()(AVFrame *frame) const { av_frame_free(&frame); }
+};
+
+struct AVPacketDeleter
+{
+    void operator()(AVPacket *packet) const { av_packet_free(&packet); }
+};
+
+struct SwsContextDeleter
+{
+    void operator()(SwsContext *context) const { sws_freeContext(context); }
+};
+
+struct SwrContextDeleter
+{
+    void operator()(SwrContext *context) const { swr_free(&context); }
+};
+
+struct AVFilterGraphDeleter
+{
+    void operator()(AVFilterGraph *graph) const { avfilter_graph_free(&graph); }
+};
+
+struct AVFilterInOutDeleter
+{
+    void operator()(AVFilterInOut *inout) const { avfilter_inout_free(&inout); }
+};
+
+typedef std::unique_ptr<AVFormatContext, AVFormatInputDeleter> AVFormatInputPtr;
+typedef std::unique_ptr<AVCodecContext, AVCodecContextDeleter> AVCodecContextPtr;
+typedef std::unique_ptr<AVFrame, AVFrameDeleter> AVFramePtr;
+typedef std::unique_ptr<AVPacket, AVPacketDeleter> AVPacketPtr;
+typedef std::unique_ptr<SwsContext, SwsContextDeleter> SwsContextPtr;
+typedef std::unique_ptr<SwrContext, SwrContextDeleter> SwrContextPtr;
+typedef std::unique_ptr<AVFilterGraph, AVFilterGraphDeleter> AVFilterGraphPtr;
+typedef std::unique_ptr<AVFilterInOut, AVFilterInOutDeleter> AVFilterInOutPtr;
+
+inline AVFramePtr makeFrame() { return AVFramePtr(av_frame_alloc()); }
+inline AVPacketPtr makePacket() { return AVPacketPtr(av_packet_alloc()); }
+
+/**
+ * @brief openInput
+ * @note avformat_open_input 的包装，失败时返回空
+ */
+inline AVFormatInputPtr openInput(const char *url, AVDictionary **options = nullptr)
+{
+    AVFormatContext *context = nullptr;
+    if (avformat_open_input(&context, url, nullptr, options) < 0) return AVFormatInputPtr();
+
+    return AVFormatInputPtr(context);
+}
+
+#endif // AVHANDLE_H
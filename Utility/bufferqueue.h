@@ -1,14 +1,17 @@
 #ifndef BUFFERQUEUE_H
 #define BUFFERQUEUE_H
 
-#ifdef DEBUG_OUTPUT
-#include <iostream>
-#endif
-
+#include "queuemonitor.h"
 #include "semaphore.h"
+#include <atomic>
+#include <cstdint>
 #include <vector>
 
-template <class T> class BufferQueue
+/**
+ * @brief BufferQueue
+ * @note 单生产者单消费者的有界队列；Monitor 为监视策略(见 NullQueueMonitor)，默认不记录任何指标
+ */
+template <class T, class Monitor = NullQueueMonitor> class BufferQueue
 {
 public:
     BufferQueue(int bufferSize = 100) {
@@ -23,28 +26,35 @@ public:
     void setBufferSize(int bufferSize) {
         m_bufferSize = bufferSize;
         m_bufferQueue = std::vector<T>(bufferSize);
-        m_useableSpace.acquire(m_useableSpace.available());
+        m_enqueueTimes = std::vector<int64_t>(bufferSize, 0);
+        while (m_useableSpace.tryAcquire());
         m_freeSpace.release(m_bufferSize - m_freeSpace.available());
         m_front = m_rear = 0;
     }
 
+    Monitor &monitor() {
+        return m_monitor;
+    }
+
     void enqueue(const T &element) {
-#ifdef DEBUG_OUTPUT
-        std::cout << "[freespace " << m_freeSpace.available()
-                  << "] --- [useablespace " << m_useableSpace.available() << "]" << std::endl;
-#endif
-        m_freeSpace.acquire();
-        m_bufferQueue[m_front++ % m_bufferSize] = element;
+        //只把真正阻塞的等待(队列满)交给 Monitor
+        if (m_freeSpace.available() <= 0) m_monitor.waitFull([this] { m_freeSpace.acquire(); });
+        else m_freeSpace.acquire();
+
+        int index = int(m_front++ % uint64_t(m_bufferSize));
+        m_bufferQueue[index] = element;
+        m_enqueueTimes[index] = m_monitor.timestamp();
         m_useableSpace.release();
+        if (m_monitor.isActive()) m_monitor.enqueued(size());
     }
 
     T dequeue() {
-#ifdef DEBUG_OUTPUT
-        std::cout << "[freespace " << m_freeSpace.available()
-                  << "] --- [useablespace " << m_useableSpace.available() << "]" << std::endl;
-#endif
-        m_useableSpace.acquire();
-        T element = m_bufferQueue[m_rear++ % m_bufferSize];
+        if (m_useableSpace.available() <= 0) m_monitor.waitEmpty([this] { m_useableSpace.acquire(); });
+        else m_useableSpace.acquire();
+
+        int index = int(m_rear++ % uint64_t(m_bufferSize));
+        T element = m_bufferQueue[index];
+        if (m_monitor.isActive()) m_monitor.dequeued(m_enqueueTimes[index], size());
         m_freeSpace.release();
 
         return element;
@@ -56,21 +66,33 @@ public:
      * @return 成功返回对应T元素，失败返回默认构造的T元素
      */
     T tryDequeue() {
-        T element;
+        T element = T();
         bool success = m_useableSpace.tryAcquire();
         if (success) {
-            element = m_bufferQueue[m_rear++ % m_bufferSize];
+            int index = int(m_rear++ % uint64_t(m_bufferSize));
+            element = m_bufferQueue[index];
+            if (m_monitor.isActive()) m_monitor.dequeued(m_enqueueTimes[index], size());
             m_freeSpace.release();
         }
 
         return element;
     }
 
+    int size() const {
+        return m_useableSpace.available();
+    }
+
+    int capacity() const {
+        return m_bufferSize;
+    }
+
     void init() {
-        m_useableSpace.acquire(m_useableSpace.available());
+        //取走全部可用计数，不阻塞(其他线程可能同时在出队)
+        while (m_useableSpace.tryAcquire());
         m_freeSpace.release(m_bufferSize - m_freeSpace.available());
         m_front.store(0);
         m_rear.store(0);
+        m_monitor.reset();
     }
 
 private:
@@ -78,10 +100,14 @@ private:
     //   [free space] -> [useable space]
     Semaphore m_freeSpace;
     Semaphore m_useableSpace;
-    std::atomic_int m_rear;
-    std::atomic_int m_front;
+    //64 位，长时间运行也不会溢出成负下标
+    std::atomic<uint64_t> m_rear;
+    std::atomic<uint64_t> m_front;
     std::vector<T> m_bufferQueue;
+    //与 m_bufferQueue 同一下标，入队时间(ns)
+    std::vector<int64_t> m_enqueueTimes;
     int m_bufferSize;
+    Monitor m_monitor;
 };
 
 #endif
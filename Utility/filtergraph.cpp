@@ -0,0 +1,296 @@
+#include "filtergraph.h"
+#include "tracing.h"
+
+extern "C"
+{
+#include <libavfilter/buffersink.h>
+#include <libavfilter/buffersrc.h>
+#include <libavutil/mem.h>
+}
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+
+inline int64_t elapsed_ns(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} //namespace
+
+FilterGraph::FilterGraph()
+{
+    m_format = Format { 0, 0, AV_PIX_FMT_NONE, { 0, 1 }, { 0, 1 } };
+    m_statistics = Statistics { 0, 0, 0, 0 };
+}
+
+FilterGraph::~FilterGraph()
+{
+    release();
+}
+
+bool FilterGraph::init(const Format &format, const std::string &description, int threads)
+{
+    release();
+
+    char args[256];
+    std::snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:pixel_aspect=%d/%d",
+                  format.width, format.height, int(format.pixelFormat), format.timeBase.num, format.timeBase.den,
+                  format.sampleAspect.num, format.sampleAspect.den);
+
+    AVFilterInOut *output = avfilter_inout_alloc();
+    AVFilterInOut *input = avfilter_inout_alloc();
+    m_graph.reset(avfilter_graph_alloc());
+    bool success = false;
+
+    if (!output || !input || !m_graph) goto Init_End;
+
+    //必须在加入第一个过滤器之前设置，slice 线程池在那时创建
+    m_graph->nb_threads = threads;
+    m_graph->thread_type = AVFILTER_THREAD_SLICE;
+
+    //创建输入过滤器，需要arg
+    if (avfilter_graph_create_filter(&m_buffersrc, avfilter_get_by_name("buffer"), "in",
+                                     args, nullptr, m_graph.get()) < 0) {
+        goto Init_End;
+    }
+
+    if (avfilter_graph_create_filter(&m_buffersink, avfilter_get_by_name("buffersink"), "out",
+                                     nullptr, nullptr, m_graph.get()) < 0) {
+        goto Init_End;
+    }
+
+    output->name = av_strdup("in");
+    output->next = nullptr;
+    output->pad_idx = 0;
+    output->filter_ctx = m_buffersrc;
+
+    input->name = av_strdup("out");
+    input->next = nullptr;
+    input->pad_idx = 0;
+    input->filter_ctx = m_buffersink;
+
+    if (avfilter_graph_parse_ptr(m_graph.get(), description.c_str(), &input, &output, nullptr) < 0) goto Init_End;
+    if (avfilter_graph_config(m_graph.get(), nullptr) < 0) goto Init_End;
+
+    m_format = format;
+    m_description = description;
+    success = true;
+
+Init_End:
+    avfilter_inout_free(&output);
+    avfilter_inout_free(&input);
+    if (!success) release();
+
+    return success;
+}
+
+void FilterGraph::release()
+{
+    //过滤器上下文属于过滤图，随过滤图一起释放
+    m_graph.reset();
+    m_buffersrc = nullptr;
+    m_buffersink = nullptr;
+    m_statistics = Statistics { 0, 0, 0, 0 };
+}
+
+bool FilterGraph::accepts(const AVFrame *frame) const
+{
+    return m_graph && frame->width == m_format.width && frame->height == m_format.height &&
+            frame->format == m_format.pixelFormat;
+}
+
+int FilterGraph::push(AVFrame *frame, bool keepRef)
+{
+    if (!m_graph) return AVERROR(EINVAL);
+
+    TRACE_SCOPE("filter_push");
+    auto begin = std::chrono::steady_clock::now();
+    //不带 KEEP_REF 时 buffersrc 直接移走 frame 的引用，不会产生新的引用或拷贝
+    int ret = av_buffersrc_add_frame_flags(m_buffersrc, frame, keepRef ? AV_BUFFERSRC_FLAG_KEEP_REF : 0);
+    m_statistics.pushTime += elapsed_ns(begin);
+    if (ret >= 0 && frame) m_statistics.pushed++;
+
+    return ret;
+}
+
+int FilterGraph::pull(AVFrame *frame)
+{
+    if (!m_graph) return AVERROR(EINVAL);
+
+    TRACE_SCOPE("filter_pull");
+    auto begin = std::chrono::steady_clock::now();
+    int ret = av_buffersink_get_frame(m_buffersink, frame);
+    m_statistics.pullTime += elapsed_ns(begin);
+    if (ret >= 0) m_statistics.pulled++;
+
+    return ret;
+}
+
+void FilterGraph::drain()
+{
+    if (!m_graph) return;
+
+    AVFramePtr frame = makeFrame();
+    if (!frame) return;
+    while (av_buffersink_get_frame(m_buffersink, frame.get()) >= 0)
+        av_frame_unref(frame.get());
+}
+
+std::string FilterGraph::filters() const
+{
+    std::string names;
+    if (!m_graph) return names;
+
+    for (unsigned i = 0; i < m_graph->nb_filters; i++) {
+        const AVFilterContext *filter = m_graph->filters[i];
+        if (!names.empty()) names += " -> ";
+        names += std::string(filter->name) + "(" + filter->filter->name + ")";
+    }
+
+    return names;
+}
+
+FilterGraphManager::FilterGraphManager(int capacity)
+    : m_capacity(capacity > 0 ? capacity : 1)
+{
+
+}
+
+FilterGraph *FilterGraphManager::acquire(const FilterGraph::Format &format, const std::string &description)
+{
+    std::string key = make_key(format, description);
+    for (auto it = m_graphs.begin(); it != m_graphs.end(); ++it) {
+        if (it->key != key) continue;
+        //移到最前，残留的帧属于上一次使用
+        m_graphs.splice(m_graphs.begin(), m_graphs, it);
+        FilterGraph *graph = m_graphs.front().graph.get();
+        graph->drain();
+        m_reused++;
+        return graph;
+    }
+
+    std::unique_ptr<FilterGraph> graph(new FilterGraph);
+    if (!graph->init(format, description, m_threads)) return nullptr;
+    m_created++;
+
+    m_graphs.push_front(Entry { key, std::move(graph) });
+    while (int(m_graphs.size()) > m_capacity)
+        m_graphs.pop_back();
+
+    return m_graphs.front().graph.get();
+}
+
+FilterGraph *FilterGraphManager::acquire(FilterGraph *current, const AVFrame *frame, AVRational timeBase,
+                                         const std::string &description)
+{
+    if (current && current->accepts(frame) && current->description() == description) return current;
+
+    //分辨率或像素格式变化，换成(或新建)与新格式匹配的过滤图
+    FilterGraph::Format format { frame->width, frame->height, AVPixelFormat(frame->format), timeBase, frame->sample_aspect_ratio };
+    return acquire(format, description);
+}
+
+void FilterGraphManager::clear()
+{
+    m_graphs.clear();
+}
+
+void FilterGraphManager::setThreadCount(int threads)
+{
+    if (threads == m_threads) return;
+    m_threads = threads;
+    clear();
+}
+
+std::string FilterGraphManager::make_key(const FilterGraph::Format &format, const std::string &description)
+{
+    char key[128];
+    std::snprintf(key, sizeof(key), "%dx%d:%d:%d/%d:%d/%d|", format.width, format.height, int(format.pixelFormat),
+                  format.timeBase.num, format.timeBase.den, format.sampleAspect.num, format.sampleAspect.den);
+
+    return key + description;
+}
+
+FilterThread::FilterThread(int queueSize)
+    : m_frames(queueSize)
+{
+    m_frames.monitor().setMetricsName("filter.frames");
+}
+
+FilterThread::~FilterThread()
+{
+    stop();
+}
+
+void FilterThread::start(FilterGraphManager *manager, AVRational timeBase, const std::string &description, const Output &output)
+{
+    stop();
+
+    m_manager = manager;
+    m_graph = nullptr;
+    m_timeBase = timeBase;
+    m_description = description;
+    m_output = output;
+    m_frames.init();
+    m_runnable = true;
+    m_thread = std::thread(&FilterThread::run, this);
+}
+
+void FilterThread::push(AVFrame *frame)
+{
+    if (!isRunning()) return;
+
+    AVFramePtr ref = makeFrame();
+    if (!ref) return;
+    av_frame_move_ref(ref.get(), frame);
+    //队列里存裸指针，出队的一方负责释放
+    m_frames.enqueue(ref.release());
+}
+
+void FilterThread::finish()
+{
+    if (!isRunning()) return;
+
+    m_frames.enqueue(nullptr);
+    m_thread.join();
+}
+
+void FilterThread::stop()
+{
+    if (!isRunning()) return;
+
+    //过滤线程看到标记后只释放剩余的帧不再处理，很快就能腾出位置放入结束标记
+    //队列是单消费者的，这里不能替它出队
+    m_runnable = false;
+    m_frames.enqueue(nullptr);
+    m_thread.join();
+}
+
+void FilterThread::run()
+{
+    TRACE_THREAD_NAME("FilterThread");
+    AVFramePtr filtered = makeFrame();
+
+    while (true) {
+        AVFramePtr frame(m_frames.dequeue());
+        if (!frame) break;
+
+        if (m_runnable) {
+            //分辨率或格式中途变化时换成对应的过滤图
+            FilterGraph *graph = m_manager->acquire(m_graph, frame.get(), m_timeBase, m_description);
+            if (graph) {
+                m_graph = graph;
+                if (graph->push(frame.get()) >= 0) {
+                    while (graph->pull(filtered.get()) >= 0) {
+                        if (m_runnable) m_output(filtered.get());
+                        av_frame_unref(filtered.get());
+                    }
+                }
+            }
+        }
+    }
+}
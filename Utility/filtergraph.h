@@ -0,0 +1,186 @@
+#ifndef FILTERGRAPH_H
+#define FILTERGRAPH_H
+
+#include "avhandle.h"
+#include "meteredqueue.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * @brief FilterGraph
+ * @note buffer -> [description] -> buffersink 的视频过滤图，拥有并负责释放 AVFilterGraph
+ *       输入格式(分辨率、像素格式、时间基)在 init() 时固定，格式变化时需要换一个过滤图(见 FilterGraphManager)
+ */
+class FilterGraph
+{
+public:
+    struct Format
+    {
+        int width;
+        int height;
+        AVPixelFormat pixelFormat;
+        AVRational timeBase;
+        AVRational sampleAspect;
+    };
+
+    struct Statistics
+    {
+        int64_t pushed;
+        int64_t pulled;
+        //送入和取出的累计耗时(ns)，过滤在取出时进行，主要体现在 pullTime 中
+        int64_t pushTime;
+        int64_t pullTime;
+    };
+
+    FilterGraph();
+    ~FilterGraph();
+
+    /**
+     * @brief init
+     * @param threads 过滤图的线程数(nb_threads)，0 为 libavfilter 自动选择(CPU核心数)，1 为单线程；
+     *        只有支持 slice 线程的过滤器(scale、overlay 等)会用到，subtitles(libass)本身是单线程的
+     */
+    bool init(const Format &format, const std::string &description, int threads = 0);
+    void release();
+    bool isValid() const { return m_graph != nullptr; }
+
+    const Format &format() const { return m_format; }
+    const std::string &description() const { return m_description; }
+    //输入帧的格式是否与 init() 时一致
+    bool accepts(const AVFrame *frame) const;
+
+    /**
+     * @brief push
+     * @param frame nullptr 表示输入结束
+     * @param keepRef 为false时直接接管 frame 中的引用(无拷贝、无额外引用)，返回后 frame 为空；
+     *        只有调用者之后还要使用 frame 时才需要为true
+     * @return 与 av_buffersrc_add_frame_flags 相同
+     */
+    int push(AVFrame *frame, bool keepRef = false);
+    /**
+     * @brief pull
+     * @return 与 av_buffersink_get_frame 相同，AVERROR(EAGAIN) 表示需要更多输入
+     */
+    int pull(AVFrame *frame);
+    //丢弃过滤图中残留的帧，复用之前调用
+    void drain();
+
+    Statistics statistics() const { return m_statistics; }
+    //过滤图中各个过滤器的名称，如 "in(buffer) -> Parsed_subtitles_0(subtitles) -> out(buffersink)"
+    std::string filters() const;
+
+private:
+    FilterGraph(const FilterGraph &) = delete;
+    FilterGraph &operator=(const FilterGraph &) = delete;
+
+    Format m_format;
+    std::string m_description;
+    AVFilterGraphPtr m_graph;
+    AVFilterContext *m_buffersrc = nullptr;
+    AVFilterContext *m_buffersink = nullptr;
+    Statistics m_statistics;
+};
+
+/**
+ * @brief FilterGraphManager
+ * @note 按 (输入格式, 过滤描述) 缓存过滤图，重新打开同一个文件或分辨率来回切换时不必重建
+ *       (subtitles 等过滤器初始化时要加载字幕和字体，代价远大于单帧过滤)
+ *       超出容量时释放最久未使用的过滤图
+ */
+class FilterGraphManager
+{
+public:
+    FilterGraphManager(int capacity = 4);
+
+    /**
+     * @brief acquire
+     * @return 匹配的过滤图，创建失败返回nullptr；指针在被淘汰或 clear() 之前一直有效
+     */
+    FilterGraph *acquire(const FilterGraph::Format &format, const std::string &description);
+    /**
+     * @brief acquire
+     * @note 按 frame 的实际格式取得过滤图，current 已经匹配时直接返回，用于每帧调用
+     */
+    FilterGraph *acquire(FilterGraph *current, const AVFrame *frame, AVRational timeBase, const std::string &description);
+    void clear();
+    /**
+     * @brief setThreadCount
+     * @note 之后创建的过滤图使用的线程数(见 FilterGraph::init)，数量变化时清空缓存
+     */
+    void setThreadCount(int threads);
+    int threadCount() const { return m_threads; }
+
+    int created() const { return m_created; }
+    int reused() const { return m_reused; }
+
+private:
+    static std::string make_key(const FilterGraph::Format &format, const std::string &description);
+
+    struct Entry
+    {
+        std::string key;
+        std::unique_ptr<FilterGraph> graph;
+    };
+
+    int m_capacity;
+    int m_threads = 0;
+    //最近使用的在前
+    std::list<Entry> m_graphs;
+    int m_created = 0;
+    int m_reused = 0;
+};
+
+/**
+ * @brief FilterThread
+ * @note 在独立的线程中运行过滤图，解码线程只负责 push()，通过 AVFrame 队列连接(有背压)
+ *       过滤后的帧在过滤线程中交给 output 回调，libass 渲染较慢时与解码并行
+ *       运行期间 manager 只由过滤线程使用
+ */
+class FilterThread
+{
+public:
+    //在过滤线程中调用，frame 返回后即被 unref，不得保留
+    typedef std::function<void(AVFrame *frame)> Output;
+
+    FilterThread(int queueSize = 8);
+    ~FilterThread();
+
+    void start(FilterGraphManager *manager, AVRational timeBase, const std::string &description, const Output &output);
+    /**
+     * @brief push
+     * @note 移走 frame 中的引用(不拷贝)，返回后 frame 为空；队列满时阻塞
+     */
+    void push(AVFrame *frame);
+    //处理完已送入的帧后结束
+    void finish();
+    //丢弃还未处理的帧，立即结束
+    void stop();
+    bool isRunning() const { return m_thread.joinable(); }
+
+    //最后使用的过滤图，用于读取统计，结束后仍然有效(直到被 manager 淘汰)
+    FilterGraph *graph() const { return m_graph; }
+
+private:
+    FilterThread(const FilterThread &) = delete;
+    FilterThread &operator=(const FilterThread &) = delete;
+
+    void run();
+
+    //nullptr 表示结束
+    MeteredBufferQueue<AVFrame *> m_frames;
+    std::thread m_thread;
+    std::atomic_bool m_runnable { false };
+    FilterGraphManager *m_manager = nullptr;
+    FilterGraph *m_graph = nullptr;
+    AVRational m_timeBase { 0, 1 };
+    std::string m_description;
+    Output m_output;
+};
+
+#endif
@@ -0,0 +1,613 @@
+#include "imagedsp.h"
+
+extern "C"
+{
+#include <libavutil/cpu.h>
+}
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGEDSP_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define IMAGEDSP_NEON
+#include <arm_neon.h>
+#endif
+
+//GCC/Clang 需要按函数打开指令集，MSVC 可以直接使用 intrinsics
+#if defined(__GNUC__) || defined(__clang__)
+#define IMAGEDSP_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMAGEDSP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define IMAGEDSP_TARGET_SSE2
+#define IMAGEDSP_TARGET_AVX2
+#endif
+
+namespace
+{
+
+//一行 YUV -> RGB，NV12 时 u 为交错的 U V，v 不使用
+typedef void (*YuvRow)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, int, const ImageDsp::YuvCoefficients &);
+
+struct Kernels
+{
+    void (*blend)(uint8_t *, const uint8_t *, const uint8_t *, int);
+    //按 ImageDsp::RgbFormat 索引
+    YuvRow yuv420pToRgb[2];
+    YuvRow nv12ToRgb[2];
+};
+
+/*********************************** Scalar ***********************************/
+//标量实现同时作为参考实现，SIMD 实现与其逐位一致
+//x / 255 的四舍五入：t = x + 128, (t + (t >> 8)) >> 8，在 16 位内即可完成
+
+inline uint8_t blendPixel(int d, int s, int a)
+{
+    int t = d * (255 - a) + s * a + 128;
+    return uint8_t((t + (t >> 8)) >> 8);
+}
+
+void blend_c(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count)
+{
+    for (int i = 0; i < count; i++) {
+        if (alpha[i]) dst[i] = blendPixel(dst[i], src[i], alpha[i]);
+    }
+}
+
+/*
+ * YUV -> RGB：Y、U、V 左移 7 位后乘 Q13 系数取高 16 位(mulhi)，得到带 4 位小数的值，
+ * 加 8 后算术右移 4 位四舍五入，再饱和到 0 - 255；中间值都在 16 位有符号数范围内
+ */
+inline int mulhi(int a, int c)
+{
+    return (a * c) >> 16;
+}
+
+inline uint8_t clampRgb(int x)
+{
+    x >>= 4;
+    return uint8_t(x < 0 ? 0 : (x > 255 ? 255 : x));
+}
+
+template <ImageDsp::RgbFormat Format>
+inline void storePixel(uint8_t *dst, int y, int rv, int guv, int bu)
+{
+    uint8_t r = clampRgb(y + rv), g = clampRgb(y - guv), b = clampRgb(y + bu);
+    if (Format == ImageDsp::RGB24) {
+        dst[0] = r;
+        dst[1] = g;
+        dst[2] = b;
+    } else {
+        dst[0] = b;
+        dst[1] = g;
+        dst[2] = r;
+        dst[3] = 255;
+    }
+}
+
+template <bool Planar, ImageDsp::RgbFormat Format>
+void yuvRow_c(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count, const ImageDsp::YuvCoefficients &c)
+{
+    const int bytes = Format == ImageDsp::RGB24 ? 3 : 4;
+    for (int i = 0; i < count; i++) {
+        int j = i >> 1;
+        int cu = (Planar ? u[j] : u[j * 2]) * 128 - 128 * 128;
+        int cv = (Planar ? v[j] : u[j * 2 + 1]) * 128 - 128 * 128;
+        int luma = mulhi((y[i] - c.yOffset) * 128, c.y) + 8;
+        storePixel<Format>(dst + i * bytes, luma, mulhi(cv, c.rv), mulhi(cu, c.gu) + mulhi(cv, c.gv), mulhi(cu, c.bu));
+    }
+}
+
+//SIMD 处理完前 i 个像素后，剩余部分从这里开始
+template <bool Planar>
+inline const uint8_t *chromaAt(const uint8_t *chroma, int i)
+{
+    return chroma ? chroma + (Planar ? i / 2 : i) : nullptr;
+}
+
+const Kernels scalarKernels = {
+    blend_c,
+    { yuvRow_c<true, ImageDsp::RGB24>, yuvRow_c<true, ImageDsp::RGB32> },
+    { yuvRow_c<false, ImageDsp::RGB24>, yuvRow_c<false, ImageDsp::RGB32> }
+};
+
+#ifdef IMAGEDSP_X86
+/************************************ SSE2 ************************************/
+
+//8 个 16 位像素的混合，返回 16 位结果
+IMAGEDSP_TARGET_SSE2 inline __m128i blend8_sse2(__m128i d, __m128i s, __m128i a)
+{
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)), _mm_mullo_epi16(s, a));
+    t = _mm_add_epi16(t, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+IMAGEDSP_TARGET_SSE2 void blend_sse2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(alpha + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) == 0xFFFF) continue;
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = blend8_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(a, zero));
+        __m128i hi = blend8_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(a, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blend_c(dst + i, src + i, alpha + i, count - i);
+}
+
+struct YuvConstants_sse2
+{
+    __m128i y, yOffset, rv, gu, gv, bu;
+};
+
+IMAGEDSP_TARGET_SSE2 inline YuvConstants_sse2 yuvConstants_sse2(const ImageDsp::YuvCoefficients &c)
+{
+    YuvConstants_sse2 k = {
+        _mm_set1_epi16(c.y), _mm_set1_epi16(int16_t(c.yOffset * 128)), _mm_set1_epi16(c.rv),
+        _mm_set1_epi16(c.gu), _mm_set1_epi16(c.gv), _mm_set1_epi16(c.bu)
+    };
+    return k;
+}
+
+//16 个像素：y 为 16 个字节，u / v 为 8 个 16 位样本(每个对应两个像素)，得到 R G B 各 16 个字节
+IMAGEDSP_TARGET_SSE2 inline void yuv16_sse2(__m128i y, __m128i u, __m128i v, const YuvConstants_sse2 &k,
+                                             __m128i &r, __m128i &g, __m128i &b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128 * 128);
+    const __m128i round = _mm_set1_epi16(8);
+    u = _mm_sub_epi16(_mm_slli_epi16(u, 7), bias);
+    v = _mm_sub_epi16(_mm_slli_epi16(v, 7), bias);
+    __m128i rv = _mm_mulhi_epi16(v, k.rv);
+    __m128i guv = _mm_add_epi16(_mm_mulhi_epi16(u, k.gu), _mm_mulhi_epi16(v, k.gv));
+    __m128i bu = _mm_mulhi_epi16(u, k.bu);
+
+    __m128i lo = _mm_sub_epi16(_mm_slli_epi16(_mm_unpacklo_epi8(y, zero), 7), k.yOffset);
+    __m128i hi = _mm_sub_epi16(_mm_slli_epi16(_mm_unpackhi_epi8(y, zero), 7), k.yOffset);
+    lo = _mm_add_epi16(_mm_mulhi_epi16(lo, k.y), round);
+    hi = _mm_add_epi16(_mm_mulhi_epi16(hi, k.y), round);
+
+    r = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(lo, _mm_unpacklo_epi16(rv, rv)), 4),
+                         _mm_srai_epi16(_mm_add_epi16(hi, _mm_unpackhi_epi16(rv, rv)), 4));
+    g = _mm_packus_epi16(_mm_srai_epi16(_mm_sub_epi16(lo, _mm_unpacklo_epi16(guv, guv)), 4),
+                         _mm_srai_epi16(_mm_sub_epi16(hi, _mm_unpackhi_epi16(guv, guv)), 4));
+    b = _mm_packus_epi16(_mm_srai_epi16(_mm_add_epi16(lo, _mm_unpacklo_epi16(bu, bu)), 4),
+                         _mm_srai_epi16(_mm_add_epi16(hi, _mm_unpackhi_epi16(bu, bu)), 4));
+}
+
+IMAGEDSP_TARGET_SSE2 inline void storeRgb32_sse2(uint8_t *dst, __m128i r, __m128i g, __m128i b)
+{
+    const __m128i alpha = _mm_set1_epi8(char(0xFF));
+    __m128i bg = _mm_unpacklo_epi8(b, g);
+    __m128i ra = _mm_unpacklo_epi8(r, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_unpackhi_epi16(bg, ra));
+    bg = _mm_unpackhi_epi8(b, g);
+    ra = _mm_unpackhi_epi8(r, alpha);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), _mm_unpackhi_epi16(bg, ra));
+}
+
+//4 个 R G B x 像素去掉 x，压缩到低 12 个字节
+IMAGEDSP_TARGET_SSE2 inline __m128i pack24_sse2(__m128i x)
+{
+    //每个 64 位内第二个像素右移 8 位，接在第一个像素之后
+    x = _mm_or_si128(_mm_and_si128(x, _mm_set1_epi64x(0x0000000000FFFFFFLL)),
+                     _mm_and_si128(_mm_srli_epi64(x, 8), _mm_set1_epi64x(0x0000FFFFFF000000LL)));
+    //高 64 位的 6 个字节接在低 64 位的 6 个字节之后
+    return _mm_or_si128(_mm_and_si128(x, _mm_set_epi64x(0, 0x0000FFFFFFFFFFFFLL)),
+                        _mm_srli_si128(_mm_and_si128(x, _mm_set_epi64x(0x0000FFFFFFFFFFFFLL, 0)), 2));
+}
+
+//前三次 16 字节的写入各多写 4 个字节，由下一次覆盖；最后一次只写 12 个字节，不越过本组的 48 个字节
+IMAGEDSP_TARGET_SSE2 inline void storeRgb24_sse2(uint8_t *dst, __m128i r, __m128i g, __m128i b)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i bx = _mm_unpacklo_epi8(b, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), pack24_sse2(_mm_unpacklo_epi16(rg, bx)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), pack24_sse2(_mm_unpackhi_epi16(rg, bx)));
+    rg = _mm_unpackhi_epi8(r, g);
+    bx = _mm_unpackhi_epi8(b, zero);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 24), pack24_sse2(_mm_unpacklo_epi16(rg, bx)));
+    __m128i last = pack24_sse2(_mm_unpackhi_epi16(rg, bx));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 36), last);
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(last, 8));
+    std::memcpy(dst + 44, &tail, sizeof(tail));
+}
+
+template <bool Planar, ImageDsp::RgbFormat Format>
+IMAGEDSP_TARGET_SSE2 void yuvRow_sse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count,
+                                      const ImageDsp::YuvCoefficients &c)
+{
+    const int bytes = Format == ImageDsp::RGB24 ? 3 : 4;
+    const YuvConstants_sse2 k = yuvConstants_sse2(c);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lowBytes = _mm_set1_epi16(0xFF);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i cu, cv;
+        if (Planar) {
+            cu = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i / 2)), zero);
+            cv = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i / 2)), zero);
+        } else {
+            __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + i));
+            cu = _mm_and_si128(uv, lowBytes);
+            cv = _mm_srli_epi16(uv, 8);
+        }
+
+        __m128i r, g, b;
+        yuv16_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i)), cu, cv, k, r, g, b);
+        if (Format == ImageDsp::RGB24) storeRgb24_sse2(dst + i * bytes, r, g, b);
+        else storeRgb32_sse2(dst + i * bytes, r, g, b);
+    }
+    yuvRow_c<Planar, Format>(y + i, chromaAt<Planar>(u, i), chromaAt<Planar>(v, i), dst + i * bytes, count - i, c);
+}
+
+const Kernels sse2Kernels = {
+    blend_sse2,
+    { yuvRow_sse2<true, ImageDsp::RGB24>, yuvRow_sse2<true, ImageDsp::RGB32> },
+    { yuvRow_sse2<false, ImageDsp::RGB24>, yuvRow_sse2<false, ImageDsp::RGB32> }
+};
+
+/************************************ AVX2 ************************************/
+
+IMAGEDSP_TARGET_AVX2 inline __m256i blend16_avx2(__m256i d, __m256i s, __m256i a)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(_mm256_set1_epi16(255), a)), _mm256_mullo_epi16(s, a));
+    t = _mm256_add_epi16(t, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+IMAGEDSP_TARGET_AVX2 void blend_avx2(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(alpha + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, zero)) == -1) continue;
+
+        //unpack 和 packus 都在 128 位通道内进行，互为逆操作，结果顺序不变
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i lo = blend16_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(a, zero));
+        __m256i hi = blend16_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    blend_sse2(dst + i, src + i, alpha + i, count - i);
+}
+
+IMAGEDSP_TARGET_AVX2 inline __m256i rgb16_avx2(__m256i y0, __m256i y1, __m256i chroma, bool subtract)
+{
+    //permute 之后 unpacklo / unpackhi 分别是前 / 后 16 个像素的色度(每个样本重复两次)
+    chroma = _mm256_permute4x64_epi64(chroma, 0xD8);
+    __m256i lo = _mm256_unpacklo_epi16(chroma, chroma);
+    __m256i hi = _mm256_unpackhi_epi16(chroma, chroma);
+    lo = _mm256_srai_epi16(subtract ? _mm256_sub_epi16(y0, lo) : _mm256_add_epi16(y0, lo), 4);
+    hi = _mm256_srai_epi16(subtract ? _mm256_sub_epi16(y1, hi) : _mm256_add_epi16(y1, hi), 4);
+    //packus 在 128 位通道内交错两个参数，再用 permute 恢复像素顺序
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+}
+
+IMAGEDSP_TARGET_AVX2 inline void storeRgb32_avx2(uint8_t *dst, __m256i r, __m256i g, __m256i b)
+{
+    //unpack 在 128 位通道内进行：p0 为像素 0-3 和 16-19，p1 为 4-7 和 20-23，依此类推
+    const __m256i alpha = _mm256_set1_epi8(char(0xFF));
+    __m256i bg = _mm256_unpacklo_epi8(b, g);
+    __m256i ra = _mm256_unpacklo_epi8(r, alpha);
+    __m256i p0 = _mm256_unpacklo_epi16(bg, ra);
+    __m256i p1 = _mm256_unpackhi_epi16(bg, ra);
+    bg = _mm256_unpackhi_epi8(b, g);
+    ra = _mm256_unpackhi_epi8(r, alpha);
+    __m256i p2 = _mm256_unpacklo_epi16(bg, ra);
+    __m256i p3 = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(p0, p1, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(p2, p3, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 64), _mm256_permute2x128_si256(p0, p1, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+}
+
+IMAGEDSP_TARGET_AVX2 inline void storeRgb24_avx2(uint8_t *dst, __m256i r, __m256i g, __m256i b)
+{
+    //与 storeRgb32_avx2 相同地组成 R G B 0 像素，每 4 个像素用 pshufb 压缩为 12 字节，按像素顺序写入
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i rg = _mm256_unpacklo_epi8(r, g);
+    __m256i bx = _mm256_unpacklo_epi8(b, zero);
+    __m256i p0 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg, bx), pack);
+    __m256i p1 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg, bx), pack);
+    rg = _mm256_unpackhi_epi8(r, g);
+    bx = _mm256_unpackhi_epi8(b, zero);
+    __m256i p2 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(rg, bx), pack);
+    __m256i p3 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(rg, bx), pack);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(p0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 12), _mm256_castsi256_si128(p1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 24), _mm256_castsi256_si128(p2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 36), _mm256_castsi256_si128(p3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), _mm256_extracti128_si256(p0, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 60), _mm256_extracti128_si256(p1, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 72), _mm256_extracti128_si256(p2, 1));
+    //最后一组只写 12 个字节，不越过本组的 96 个字节
+    __m128i last = _mm256_extracti128_si256(p3, 1);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 84), last);
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(last, 8));
+    std::memcpy(dst + 92, &tail, sizeof(tail));
+}
+
+template <bool Planar, ImageDsp::RgbFormat Format>
+IMAGEDSP_TARGET_AVX2 void yuvRow_avx2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count,
+                                      const ImageDsp::YuvCoefficients &c)
+{
+    const int bytes = Format == ImageDsp::RGB24 ? 3 : 4;
+    const __m256i ky = _mm256_set1_epi16(c.y), yOffset = _mm256_set1_epi16(int16_t(c.yOffset * 128));
+    const __m256i krv = _mm256_set1_epi16(c.rv), kgu = _mm256_set1_epi16(c.gu);
+    const __m256i kgv = _mm256_set1_epi16(c.gv), kbu = _mm256_set1_epi16(c.bu);
+    const __m256i bias = _mm256_set1_epi16(128 * 128), round = _mm256_set1_epi16(8), lowBytes = _mm256_set1_epi16(0xFF);
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i cu, cv;
+        if (Planar) {
+            cu = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(u + i / 2)));
+            cv = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(v + i / 2)));
+        } else {
+            __m256i uv = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(u + i));
+            cu = _mm256_and_si256(uv, lowBytes);
+            cv = _mm256_srli_epi16(uv, 8);
+        }
+        cu = _mm256_sub_epi16(_mm256_slli_epi16(cu, 7), bias);
+        cv = _mm256_sub_epi16(_mm256_slli_epi16(cv, 7), bias);
+
+        __m256i y0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i)));
+        __m256i y1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y + i + 16)));
+        y0 = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_sub_epi16(_mm256_slli_epi16(y0, 7), yOffset), ky), round);
+        y1 = _mm256_add_epi16(_mm256_mulhi_epi16(_mm256_sub_epi16(_mm256_slli_epi16(y1, 7), yOffset), ky), round);
+
+        __m256i r = rgb16_avx2(y0, y1, _mm256_mulhi_epi16(cv, krv), false);
+        __m256i g = rgb16_avx2(y0, y1, _mm256_add_epi16(_mm256_mulhi_epi16(cu, kgu), _mm256_mulhi_epi16(cv, kgv)), true);
+        __m256i b = rgb16_avx2(y0, y1, _mm256_mulhi_epi16(cu, kbu), false);
+        if (Format == ImageDsp::RGB24) storeRgb24_avx2(dst + i * bytes, r, g, b);
+        else storeRgb32_avx2(dst + i * bytes, r, g, b);
+    }
+    yuvRow_sse2<Planar, Format>(y + i, chromaAt<Planar>(u, i), chromaAt<Planar>(v, i), dst + i * bytes, count - i, c);
+}
+
+const Kernels avx2Kernels = {
+    blend_avx2,
+    { yuvRow_avx2<true, ImageDsp::RGB24>, yuvRow_avx2<true, ImageDsp::RGB32> },
+    { yuvRow_avx2<false, ImageDsp::RGB24>, yuvRow_avx2<false, ImageDsp::RGB32> }
+};
+#endif //IMAGEDSP_X86
+
+#ifdef IMAGEDSP_NEON
+/************************************ NEON ************************************/
+
+inline uint8x8_t blend8_neon(uint8x8_t d, uint8x8_t s, uint8x8_t a)
+{
+    uint16x8_t t = vmull_u8(d, vsub_u8(vdup_n_u8(255), a));
+    t = vmlal_u8(t, s, a);
+    t = vaddq_u16(t, vdupq_n_u16(128));
+    return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+}
+
+void blend_neon(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t a = vld1q_u8(alpha + i);
+        uint64x2_t any = vreinterpretq_u64_u8(a);
+        if ((vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1)) == 0) continue;
+
+        uint8x16_t d = vld1q_u8(dst + i);
+        uint8x16_t s = vld1q_u8(src + i);
+        uint8x8_t lo = blend8_neon(vget_low_u8(d), vget_low_u8(s), vget_low_u8(a));
+        uint8x8_t hi = blend8_neon(vget_high_u8(d), vget_high_u8(s), vget_high_u8(a));
+        vst1q_u8(dst + i, vcombine_u8(lo, hi));
+    }
+    blend_c(dst + i, src + i, alpha + i, count - i);
+}
+
+//vqdmulh 为 (2 * a * b) >> 16，系数都是偶数，减半后与 mulhi 相同
+inline int16x8_t mulhi_neon(int16x8_t a, int16_t c)
+{
+    return vqdmulhq_n_s16(a, int16_t(c / 2));
+}
+
+inline uint8x16_t rgb16_neon(int16x8_t y0, int16x8_t y1, int16x8_t chroma, bool subtract)
+{
+    int16x8x2_t pairs = vzipq_s16(chroma, chroma);
+    int16x8_t lo = subtract ? vsubq_s16(y0, pairs.val[0]) : vaddq_s16(y0, pairs.val[0]);
+    int16x8_t hi = subtract ? vsubq_s16(y1, pairs.val[1]) : vaddq_s16(y1, pairs.val[1]);
+    return vcombine_u8(vqshrun_n_s16(lo, 4), vqshrun_n_s16(hi, 4));
+}
+
+template <bool Planar, ImageDsp::RgbFormat Format>
+void yuvRow_neon(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count, const ImageDsp::YuvCoefficients &c)
+{
+    const int bytes = Format == ImageDsp::RGB24 ? 3 : 4;
+    const int16x8_t bias = vdupq_n_s16(128 * 128);
+    const int16x8_t yOffset = vdupq_n_s16(int16_t(c.yOffset * 128));
+    const int16x8_t round = vdupq_n_s16(8);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x8_t u8, v8;
+        if (Planar) {
+            u8 = vld1_u8(u + i / 2);
+            v8 = vld1_u8(v + i / 2);
+        } else {
+            uint8x8x2_t uv = vld2_u8(u + i);
+            u8 = uv.val[0];
+            v8 = uv.val[1];
+        }
+        int16x8_t cu = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(u8, 7)), bias);
+        int16x8_t cv = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(v8, 7)), bias);
+
+        uint8x16_t luma = vld1q_u8(y + i);
+        int16x8_t y0 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(luma), 7)), yOffset);
+        int16x8_t y1 = vsubq_s16(vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(luma), 7)), yOffset);
+        y0 = vaddq_s16(mulhi_neon(y0, c.y), round);
+        y1 = vaddq_s16(mulhi_neon(y1, c.y), round);
+
+        uint8x16_t r = rgb16_neon(y0, y1, mulhi_neon(cv, c.rv), false);
+        uint8x16_t g = rgb16_neon(y0, y1, vaddq_s16(mulhi_neon(cu, c.gu), mulhi_neon(cv, c.gv)), true);
+        uint8x16_t b = rgb16_neon(y0, y1, mulhi_neon(cu, c.bu), false);
+        if (Format == ImageDsp::RGB24) {
+            uint8x16x3_t rgb = { { r, g, b } };
+            vst3q_u8(dst + i * bytes, rgb);
+        } else {
+            uint8x16x4_t bgra = { { b, g, r, vdupq_n_u8(255) } };
+            vst4q_u8(dst + i * bytes, bgra);
+        }
+    }
+    yuvRow_c<Planar, Format>(y + i, chromaAt<Planar>(u, i), chromaAt<Planar>(v, i), dst + i * bytes, count - i, c);
+}
+
+const Kernels neonKernels = {
+    blend_neon,
+    { yuvRow_neon<true, ImageDsp::RGB24>, yuvRow_neon<true, ImageDsp::RGB32> },
+    { yuvRow_neon<false, ImageDsp::RGB24>, yuvRow_neon<false, ImageDsp::RGB32> }
+};
+#endif //IMAGEDSP_NEON
+
+const Kernels *kernelsFor(ImageDsp::Backend backend)
+{
+    switch (backend) {
+#ifdef IMAGEDSP_X86
+    case ImageDsp::SSE2: return &sse2Kernels;
+    case ImageDsp::AVX2: return &avx2Kernels;
+#endif
+#ifdef IMAGEDSP_NEON
+    case ImageDsp::NEON: return &neonKernels;
+#endif
+    default: return &scalarKernels;
+    }
+}
+
+bool isSupported(ImageDsp::Backend backend)
+{
+    int flags = av_get_cpu_flags();
+    switch (backend) {
+    case ImageDsp::Scalar: return true;
+#ifdef IMAGEDSP_X86
+    case ImageDsp::SSE2: return flags & AV_CPU_FLAG_SSE2;
+    case ImageDsp::AVX2: return flags & AV_CPU_FLAG_AVX2;
+#endif
+#ifdef IMAGEDSP_NEON
+    case ImageDsp::NEON: return flags & AV_CPU_FLAG_NEON;
+#endif
+    default: return false;
+    }
+}
+
+ImageDsp::Backend detectBackend()
+{
+    if (isSupported(ImageDsp::AVX2) && !(av_get_cpu_flags() & AV_CPU_FLAG_AVXSLOW)) return ImageDsp::AVX2;
+    if (isSupported(ImageDsp::SSE2)) return ImageDsp::SSE2;
+    if (isSupported(ImageDsp::NEON)) return ImageDsp::NEON;
+
+    return ImageDsp::Scalar;
+}
+
+std::atomic<ImageDsp::Backend> s_backend(ImageDsp::Auto);
+
+inline const Kernels *kernels()
+{
+    ImageDsp::Backend backend = s_backend.load(std::memory_order_relaxed);
+    if (backend == ImageDsp::Auto) {
+        backend = detectBackend();
+        s_backend.store(backend, std::memory_order_relaxed);
+    }
+
+    return kernelsFor(backend);
+}
+
+} //namespace
+
+ImageDsp::Backend ImageDsp::setBackend(Backend backend)
+{
+    if (backend == Auto) backend = detectBackend();
+    else if (!isSupported(backend)) backend = Scalar;
+    s_backend.store(backend);
+
+    return backend;
+}
+
+ImageDsp::Backend ImageDsp::backend()
+{
+    kernels();
+    return s_backend.load();
+}
+
+const char *ImageDsp::backendName(Backend backend)
+{
+    switch (backend) {
+    case Scalar: return "Scalar";
+    case SSE2: return "SSE2";
+    case AVX2: return "AVX2";
+    case NEON: return "NEON";
+    default: return "Auto";
+    }
+}
+
+void ImageDsp::lumaWeights(ColorMatrix matrix, double &kr, double &kb)
+{
+    switch (matrix) {
+    case BT709:
+        kr = 0.2126; kb = 0.0722;
+        break;
+    case BT2020:
+        kr = 0.2627; kb = 0.0593;
+        break;
+    default:
+        kr = 0.299; kb = 0.114;
+        break;
+    }
+}
+
+ImageDsp::YuvCoefficients ImageDsp::yuvCoefficients(ColorMatrix matrix, bool fullRange)
+{
+    double kr, kb;
+    lumaWeights(matrix, kr, kb);
+    double kg = 1.0 - kr - kb;
+    //有限范围：Y 为 16 - 235，U / V 为 16 - 240
+    double yScale = fullRange ? 1.0 : 255.0 / 219.0;
+    double cScale = fullRange ? 1.0 : 255.0 / 224.0;
+    auto q13 = [](double x) { return int16_t(2 * std::lround(x * 4096.0)); };
+
+    YuvCoefficients c;
+    c.y = q13(yScale);
+    c.yOffset = fullRange ? 0 : 16;
+    c.rv = q13(2.0 * (1.0 - kr) * cScale);
+    c.gu = q13(2.0 * (1.0 - kb) * kb / kg * cScale);
+    c.gv = q13(2.0 * (1.0 - kr) * kr / kg * cScale);
+    c.bu = q13(2.0 * (1.0 - kb) * cScale);
+
+    return c;
+}
+
+void ImageDsp::blend(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count)
+{
+    kernels()->blend(dst, src, alpha, count);
+}
+
+void ImageDsp::yuv420pToRgb(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count,
+                            const YuvCoefficients &coefficients, RgbFormat format)
+{
+    kernels()->yuv420pToRgb[format](y, u, v, dst, count, coefficients);
+}
+
+void ImageDsp::nv12ToRgb(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int count,
+                         const YuvCoefficients &coefficients, RgbFormat format)
+{
+    kernels()->nv12ToRgb[format](y, uv, nullptr, dst, count, coefficients);
+}
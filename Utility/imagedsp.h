@@ -0,0 +1,82 @@
+#ifndef IMAGEDSP_H
+#define IMAGEDSP_H
+
+#include <cstdint>
+
+/**
+ * @brief ImageDsp
+ * @note 8 位图像平面的逐行处理，与 PcmDsp 一样在运行时按 CPU 特性选择 AVX2 / SSE2 / NEON 实现
+ */
+class ImageDsp
+{
+public:
+    enum Backend
+    {
+        Auto = 0,
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    /**
+     * @brief setBackend
+     * @note 强制使用某个实现(主要用于测试和基准)，不支持的实现会回退到 Scalar
+     * @return 实际使用的实现
+     */
+    static Backend setBackend(Backend backend);
+    static Backend backend();
+    static const char *backendName(Backend backend);
+
+    enum ColorMatrix
+    {
+        BT601,
+        BT709,
+        BT2020
+    };
+
+    //YUV -> RGB 输出的字节顺序
+    enum RgbFormat
+    {
+        RGB24,  //R G B，即 AV_PIX_FMT_RGB24 / QImage::Format_RGB888
+        RGB32   //B G R 0xFF，即 AV_PIX_FMT_BGRA / 小端下的 QImage::Format_RGB32
+    };
+
+    /**
+     * @brief YuvCoefficients
+     * @note Q13 定点系数，均为偶数(NEON 的 vqdmulh 自带乘 2，系数减半后结果与 x86 的 mulhi 逐位一致)
+     */
+    struct YuvCoefficients
+    {
+        int16_t y;
+        int16_t yOffset;
+        int16_t rv;
+        int16_t gu;
+        int16_t gv;
+        int16_t bu;
+    };
+
+    static YuvCoefficients yuvCoefficients(ColorMatrix matrix, bool fullRange);
+    //矩阵的亮度权重 Kr / Kb(Kg = 1 - Kr - Kb)
+    static void lumaWeights(ColorMatrix matrix, double &kr, double &kb);
+
+    /**
+     * @brief blend
+     * @note 非预乘 alpha 混合一行：dst = (dst * (255 - alpha) + src * alpha) / 255，四舍五入
+     *       alpha 全为 0 的部分会被跳过，适合大部分透明的字幕位图
+     */
+    static void blend(uint8_t *dst, const uint8_t *src, const uint8_t *alpha, int count);
+
+    /**
+     * @brief yuv420pToRgb
+     * @note 不缩放地转换一行，u / v 各有 (count + 1) / 2 个样本(水平 2:1，YUV422P 的行同样适用)
+     *       与 swscale 的差别不超过 1 - 2，各个实现之间逐位一致
+     */
+    static void yuv420pToRgb(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int count,
+                             const YuvCoefficients &coefficients, RgbFormat format);
+    //uv 为交错的 U V 样本
+    static void nv12ToRgb(const uint8_t *y, const uint8_t *uv, uint8_t *dst, int count,
+                          const YuvCoefficients &coefficients, RgbFormat format);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef METEREDQUEUE_H
+#define METEREDQUEUE_H
+
+#include "bufferqueue.h"
+#include "metrics.h"
+#include "mpmcqueue.h"
+#include "tracing.h"
+
+#include <string>
+
+/**
+ * @brief MeteredQueueMonitor
+ * @note 把队列的运行指标登记到 Metrics(见 QueueMetrics)，阻塞的等待同时记为追踪区间
+ *       Metrics 关闭时每次操作只多一次原子变量读取；需要链接 metrics.cpp / tracing.cpp(MediaCore 已包含)
+ */
+class MeteredQueueMonitor
+{
+public:
+    //以 name 为前缀登记运行指标
+    void setMetricsName(const std::string &name) {
+        m_metrics = QueueMetrics::create(name);
+    }
+
+    bool isActive() const {
+        return m_metrics.isActive();
+    }
+
+    int64_t timestamp() const {
+        return isActive() ? Metrics::now() : 0;
+    }
+
+    template <class Wait> void waitFull(const Wait &wait) {
+        TRACE_SCOPE("queue_full");
+        int64_t begin = timestamp();
+        wait();
+        if (begin) m_metrics.fullWait->record(Metrics::now() - begin);
+    }
+
+    template <class Wait> void waitEmpty(const Wait &wait) {
+        TRACE_SCOPE("queue_empty");
+        int64_t begin = timestamp();
+        wait();
+        if (begin) m_metrics.emptyWait->record(Metrics::now() - begin);
+    }
+
+    void enqueued(int depth) {
+        m_metrics.enqueued->add();
+        m_metrics.depth->set(depth);
+    }
+
+    void dequeued(int64_t enqueueTime, int depth) {
+        //入队时 Metrics 尚未打开的元素没有时间戳
+        if (enqueueTime > 0) m_metrics.latency->record(Metrics::now() - enqueueTime);
+        m_metrics.depth->set(depth);
+    }
+
+    void reset() {
+        if (m_metrics.depth) m_metrics.depth->set(0);
+    }
+
+private:
+    QueueMetrics m_metrics;
+};
+
+template <class T> using MeteredBufferQueue = BufferQueue<T, MeteredQueueMonitor>;
+template <class T> using MeteredMpmcQueue = MpmcQueue<T, MeteredQueueMonitor>;
+
+#endif // METEREDQUEUE_H
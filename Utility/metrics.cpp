@@ -0,0 +1,245 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+std::atomic_bool Metrics::s_enabled { false };
+
+namespace
+{
+
+struct Registry
+{
+    std::mutex mutex;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+template <class T>
+T *find_or_create(std::map<std::string, std::unique_ptr<T>> &metrics, const std::string &name)
+{
+    std::lock_guard<std::mutex> locker(registry().mutex);
+    std::unique_ptr<T> &metric = metrics[name];
+    if (!metric) metric.reset(new T);
+
+    return metric.get();
+}
+
+//最高位的位置，value 必须大于 0
+inline int highest_bit(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return int(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+} //namespace
+
+void Histogram::record(int64_t value)
+{
+    if (value < 0) value = 0;
+
+    m_buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    int64_t min = m_min.load(std::memory_order_relaxed);
+    while (value < min && !m_min.compare_exchange_weak(min, value, std::memory_order_relaxed));
+    int64_t max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+int64_t Histogram::percentile(double percentile) const
+{
+    int64_t total = count();
+    if (total == 0) return 0;
+
+    //按名次取，至少是第 1 个
+    int64_t rank = int64_t(percentile / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+
+    int64_t seen = 0;
+    int64_t max = m_max.load(std::memory_order_relaxed);
+    for (int i = 0; i < BucketCount; i++) {
+        seen += int64_t(m_buckets[i].load(std::memory_order_relaxed));
+        if (seen >= rank) return std::min(bucket_upper(i), max);
+    }
+
+    return max;
+}
+
+Histogram::Snapshot Histogram::snapshot() const
+{
+    Snapshot snapshot;
+    snapshot.count = count();
+    snapshot.min = snapshot.count > 0 ? m_min.load(std::memory_order_relaxed) : 0;
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    snapshot.mean = snapshot.count > 0 ? double(m_sum.load(std::memory_order_relaxed)) / snapshot.count : 0.0;
+    snapshot.p50 = percentile(50.0);
+    snapshot.p90 = percentile(90.0);
+    snapshot.p99 = percentile(99.0);
+    snapshot.p999 = percentile(99.9);
+
+    return snapshot;
+}
+
+void Histogram::reset()
+{
+    for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(INT64_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+int Histogram::bucket_index(int64_t value)
+{
+    //小于 16 的值每个数一格，之后每个 2 的幂区间 [2^e, 2^(e+1)) 分为 16 格
+    if (value < SubBuckets) return int(value);
+
+    int exponent = highest_bit(uint64_t(value));
+    int sub = int(value >> (exponent - 4)) - SubBuckets;
+    return SubBuckets + (exponent - 4) * SubBuckets + sub;
+}
+
+int64_t Histogram::bucket_upper(int index)
+{
+    if (index < SubBuckets) return index;
+
+    int exponent = (index - SubBuckets) / SubBuckets + 4;
+    int64_t sub = (index - SubBuckets) % SubBuckets;
+    return ((SubBuckets + sub + 1) << (exponent - 4)) - 1;
+}
+
+Counter *Metrics::counter(const std::string &name)
+{
+    return find_or_create(registry().counters, name);
+}
+
+Gauge *Metrics::gauge(const std::string &name)
+{
+    return find_or_create(registry().gauges, name);
+}
+
+Histogram *Metrics::histogram(const std::string &name)
+{
+    return find_or_create(registry().histograms, name);
+}
+
+std::string Metrics::report()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mutex);
+    std::string text;
+    char line[256];
+
+    for (const auto &counter : r.counters) {
+        std::snprintf(line, sizeof(line), "%-32s %lld\n", counter.first.c_str(), static_cast<long long>(counter.second->value()));
+        text += line;
+    }
+    for (const auto &gauge : r.gauges) {
+        std::snprintf(line, sizeof(line), "%-32s %lld (max %lld)\n", gauge.first.c_str(),
+                      static_cast<long long>(gauge.second->value()), static_cast<long long>(gauge.second->max()));
+        text += line;
+    }
+    for (const auto &histogram : r.histograms) {
+        Histogram::Snapshot s = histogram.second->snapshot();
+        std::snprintf(line, sizeof(line), "%-32s n %lld  mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms\n",
+                      histogram.first.c_str(), static_cast<long long>(s.count), s.mean / 1e6, s.p50 / 1e6, s.p90 / 1e6,
+                      s.p99 / 1e6, s.p999 / 1e6, s.max / 1e6);
+        text += line;
+    }
+
+    return text;
+}
+
+void Metrics::reset()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mutex);
+    for (auto &counter : r.counters) counter.second->reset();
+    for (auto &gauge : r.gauges) gauge.second->reset();
+    for (auto &histogram : r.histograms) histogram.second->reset();
+}
+
+QueueMetrics QueueMetrics::create(const std::string &name)
+{
+    QueueMetrics metrics;
+    if (name.empty()) return metrics;
+
+    metrics.depth = Metrics::gauge(name + ".depth");
+    metrics.latency = Metrics::histogram(name + ".latency");
+    metrics.fullWait = Metrics::histogram(name + ".full_wait");
+    metrics.emptyWait = Metrics::histogram(name + ".empty_wait");
+    metrics.enqueued = Metrics::counter(name + ".enqueued");
+
+    return metrics;
+}
+
+void MetricsReporter::start(int intervalMs, const Output &output)
+{
+    stop();
+
+    m_output = output;
+    m_runnable = true;
+    m_thread = std::thread(&MetricsReporter::run, this, intervalMs > 0 ? intervalMs : 1000);
+}
+
+bool MetricsReporter::startFromEnvironment(const char *variable)
+{
+    const char *value = std::getenv(variable);
+    int seconds = value ? std::atoi(value) : 0;
+    if (seconds <= 0) return false;
+
+    Metrics::setEnabled(true);
+    start(seconds * 1000, [](const std::string &report) {
+        std::fprintf(stderr, "==== metrics ====\n%s", report.c_str());
+        std::fflush(stderr);
+    });
+
+    return true;
+}
+
+void MetricsReporter::stop()
+{
+    if (!m_thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_runnable = false;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+
+    m_output(Metrics::report());
+}
+
+void MetricsReporter::run(int intervalMs)
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+    while (m_runnable) {
+        if (m_condition.wait_for(locker, std::chrono::milliseconds(intervalMs), [this] { return !m_runnable; })) break;
+
+        locker.unlock();
+        m_output(Metrics::report());
+        locker.lock();
+    }
+}
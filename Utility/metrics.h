@@ -0,0 +1,174 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Counter
+ * @note 只增不减的计数(入队数、丢帧数...)
+ */
+class Counter
+{
+public:
+    void add(int64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+    void reset() { m_value.store(0, std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value { 0 };
+};
+
+/**
+ * @brief Gauge
+ * @note 当前值(队列深度...)，同时记录出现过的最大值
+ */
+class Gauge
+{
+public:
+    void set(int64_t value) {
+        m_value.store(value, std::memory_order_relaxed);
+        int64_t max = m_max.load(std::memory_order_relaxed);
+        while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+    }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+    int64_t max() const { return m_max.load(std::memory_order_relaxed); }
+    void reset() {
+        m_value.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> m_value { 0 };
+    std::atomic<int64_t> m_max { 0 };
+};
+
+/**
+ * @brief Histogram
+ * @note HDR 风格的对数-线性直方图：每个 2 的幂区间再均分为 16 格，任意量级的相对误差不超过 1/16
+ *       记录只是几次 relaxed 原子加，没有锁，可以在多个线程中同时记录
+ *       数值一般为纳秒，负数按 0 记录
+ */
+class Histogram
+{
+public:
+    struct Snapshot
+    {
+        int64_t count;
+        int64_t min;
+        int64_t max;
+        double mean;
+        int64_t p50;
+        int64_t p90;
+        int64_t p99;
+        int64_t p999;
+    };
+
+    static const int SubBuckets = 16;
+    static const int BucketCount = SubBuckets + (63 - 4) * SubBuckets;
+
+    void record(int64_t value);
+    //percentile 为 0 - 100，返回所在格子的上界(不超过记录到的最大值)
+    int64_t percentile(double percentile) const;
+    int64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    static int bucket_index(int64_t value);
+    static int64_t bucket_upper(int index);
+
+    std::atomic<uint64_t> m_buckets[BucketCount] = { };
+    std::atomic<int64_t> m_count { 0 };
+    std::atomic<int64_t> m_sum { 0 };
+    std::atomic<int64_t> m_min { INT64_MAX };
+    std::atomic<int64_t> m_max { 0 };
+};
+
+/**
+ * @brief Metrics
+ * @note 按名称登记的运行指标，返回的指针在进程内一直有效，调用者取一次后缓存即可
+ *       默认关闭：BufferQueue / StreamDecoder 等只检查一次 isEnabled()，不取时间也不记录
+ */
+class Metrics
+{
+public:
+    static Counter *counter(const std::string &name);
+    static Gauge *gauge(const std::string &name);
+    static Histogram *histogram(const std::string &name);
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //所有指标按名称排序的文本，直方图以毫秒显示
+    static std::string report();
+    static void reset();
+
+private:
+    static std::atomic_bool s_enabled;
+};
+
+/**
+ * @brief QueueMetrics
+ * @note 一个队列的全部指标，name 为空时全部为 nullptr(不记录)
+ *       <name>.depth 深度，<name>.latency 入队到出队的延迟，
+ *       <name>.full_wait / <name>.empty_wait 队列满 / 空时阻塞的时间，<name>.enqueued 入队数
+ */
+struct QueueMetrics
+{
+    Gauge *depth = nullptr;
+    Histogram *latency = nullptr;
+    Histogram *fullWait = nullptr;
+    Histogram *emptyWait = nullptr;
+    Counter *enqueued = nullptr;
+
+    static QueueMetrics create(const std::string &name);
+    bool isActive() const { return depth && Metrics::isEnabled(); }
+};
+
+/**
+ * @brief MetricsReporter
+ * @note 在后台线程中每隔 intervalMs 把 Metrics::report() 交给 output，stop() 时再输出一次
+ */
+class MetricsReporter
+{
+public:
+    typedef std::function<void(const std::string &report)> Output;
+
+    MetricsReporter() { }
+    ~MetricsReporter() { stop(); }
+
+    MetricsReporter(const MetricsReporter &) = delete;
+    MetricsReporter &operator=(const MetricsReporter &) = delete;
+
+    void start(int intervalMs, const Output &output);
+    /**
+     * @brief startFromEnvironment
+     * @note 环境变量 variable 为正整数(秒)时打开 Metrics 并定期输出到 stderr
+     * @return 是否已启动
+     */
+    bool startFromEnvironment(const char *variable = "METRICS_INTERVAL");
+    void stop();
+
+private:
+    void run(int intervalMs);
+
+    Output m_output;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_runnable = false;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,213 @@
+#ifndef MPMCQUEUE_H
+#define MPMCQUEUE_H
+
+#include "queuemonitor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief MpmcQueue
+ * @note 有界的多生产者多消费者队列(Vyukov)：每个槽带序号，生产者/消费者各自用 CAS 抢占下标，
+ *       抢到后只写自己的槽，槽的序号表示它当前可写还是可读，因此多个线程同时入队/出队也不会互相覆盖
+ *       下标为 64 位，不会溢出；容量向上取整为 2 的幂
+ *       Monitor 为监视策略(见 NullQueueMonitor)，默认不记录任何指标
+ *       tryEnqueue() / tryDequeue() 不加锁；enqueue() / dequeue() 在满/空时短暂自旋，之后在条件变量上等待
+ *       与 BufferQueue 相同，结束时由调用者送入结束标记(如 nullptr)唤醒消费者
+ *       用于 VideoTest 转换线程交回结果(多生产者)、AudioTest 峰值分析的分发(多消费者)
+ *       和 PlayerTest 的包队列(停止时由其他线程清空并送入结束标记)；
+ *       只有一个生产者和一个消费者时用 BufferQueue
+ */
+template <class T, class Monitor = NullQueueMonitor> class MpmcQueue
+{
+public:
+    explicit MpmcQueue(int capacity = 64) {
+        size_t size = 2;
+        while (size < size_t(capacity > 0 ? capacity : 1)) size <<= 1;
+        m_mask = size - 1;
+        m_slots.reset(new Slot[size]);
+        for (size_t i = 0; i < size; i++) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    Monitor &monitor() {
+        return m_monitor;
+    }
+
+    bool tryEnqueue(const T &element) {
+        if (!push(element)) return false;
+
+        notify(m_consumersWaiting, m_notEmpty);
+        return true;
+    }
+
+    bool tryDequeue(T &element) {
+        if (!pop(element)) return false;
+
+        notify(m_producersWaiting, m_notFull);
+        return true;
+    }
+
+    //队列满时阻塞
+    void enqueue(const T &element) {
+        if (!push(element) && !spin([&] { return push(element); })) {
+            m_monitor.waitFull([&] { wait(m_producersWaiting, m_notFull, [&] { return push(element); }); });
+        }
+        notify(m_consumersWaiting, m_notEmpty);
+    }
+
+    //队列空时阻塞
+    T dequeue() {
+        T element;
+        if (!pop(element) && !spin([&] { return pop(element); })) {
+            m_monitor.waitEmpty([&] { wait(m_consumersWaiting, m_notEmpty, [&] { return pop(element); }); });
+        }
+        notify(m_producersWaiting, m_notFull);
+
+        return element;
+    }
+
+    /**
+     * @brief tryDequeue
+     * @note 与 BufferQueue::tryDequeue() 相同，失败返回默认构造的T元素
+     */
+    T tryDequeue() {
+        T element = T();
+        tryDequeue(element);
+        return element;
+    }
+
+    //其他线程同时操作时只是近似值
+    int size() const {
+        int64_t size = int64_t(m_enqueuePos.load(std::memory_order_relaxed) - m_dequeuePos.load(std::memory_order_relaxed));
+        return size < 0 ? 0 : int(size);
+    }
+
+    int capacity() const {
+        return int(m_mask + 1);
+    }
+
+    //丢弃所有元素，阻塞在 enqueue() 的生产者随之被唤醒
+    void clear() {
+        T element;
+        while (tryDequeue(element));
+    }
+
+private:
+    //满/空时先自旋这么多次再进入等待，交接频繁时可以省掉一次系统调用
+    static const int SpinCount = 64;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        T element;
+        int64_t enqueueTime = 0;
+    };
+
+    //只写槽，不通知等待者(可能在持有 m_mutex 时调用)
+    bool push(const T &element) {
+        uint64_t position = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &m_slots[position & m_mask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(sequence) - int64_t(position);
+            if (diff == 0) {
+                //槽可写，抢占这个下标；失败时 position 更新为最新值重试
+                if (m_enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                //槽还没被消费：队列满
+                return false;
+            } else {
+                position = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->element = element;
+        slot->enqueueTime = m_monitor.timestamp();
+        slot->sequence.store(position + 1, std::memory_order_release);
+        if (m_monitor.isActive()) m_monitor.enqueued(size());
+
+        return true;
+    }
+
+    bool pop(T &element) {
+        uint64_t position = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot *slot;
+        while (true) {
+            slot = &m_slots[position & m_mask];
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            int64_t diff = int64_t(sequence) - int64_t(position + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                //槽还没被写入：队列空
+                return false;
+            } else {
+                position = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        element = std::move(slot->element);
+        slot->element = T();
+        int64_t enqueueTime = slot->enqueueTime;
+        //下一轮(position + 容量)的生产者可以写这个槽了
+        slot->sequence.store(position + m_mask + 1, std::memory_order_release);
+        if (m_monitor.isActive()) m_monitor.dequeued(enqueueTime, size());
+
+        return true;
+    }
+
+    template <class Try>
+    static bool spin(const Try &attempt) {
+        for (int i = 0; i < SpinCount; i++) {
+            std::this_thread::yield();
+            if (attempt()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * 等待方在锁内先登记再重试，通知方在改变槽之后检查登记数(中间有全屏障)，
+     * 两者至少有一方能看到对方，不会丢失唤醒；没有等待者时通知方不加锁
+     */
+    template <class Try>
+    void wait(std::atomic_int &waiting, std::condition_variable &condition, const Try &attempt) {
+        std::unique_lock<std::mutex> locker(m_mutex);
+        waiting.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        condition.wait(locker, attempt);
+        waiting.fetch_sub(1);
+    }
+
+    void notify(std::atomic_int &waiting, std::condition_variable &condition) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed) == 0) return;
+
+        { std::lock_guard<std::mutex> locker(m_mutex); }
+        condition.notify_all();
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    uint64_t m_mask;
+    //生产者和消费者的下标分开在不同的缓存行
+    char m_pad0[64];
+    std::atomic<uint64_t> m_enqueuePos { 0 };
+    char m_pad1[64];
+    std::atomic<uint64_t> m_dequeuePos { 0 };
+    char m_pad2[64];
+    std::atomic_int m_producersWaiting { 0 };
+    std::atomic_int m_consumersWaiting { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    Monitor m_monitor;
+};
+
+#endif // MPMCQUEUE_H
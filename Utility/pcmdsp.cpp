@@ -0,0 +1,832 @@
+#include "pcmdsp.h"
+
+extern "C"
+{
+#include <libavutil/cpu.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PCMDSP_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PCMDSP_NEON
+#include <arm_neon.h>
+#endif
+
+//GCC/Clang 需要按函数打开指令集，MSVC 可以直接使用 intrinsics
+#if defined(__GNUC__) || defined(__clang__)
+#define PCMDSP_TARGET_SSE2 __attribute__((target("sse2")))
+#define PCMDSP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PCMDSP_TARGET_SSE2
+#define PCMDSP_TARGET_AVX2
+#endif
+
+namespace
+{
+
+//float 能表示的小于 2^31 的最大值，用于饱和
+const float S32_MAX_F = 2147483520.0f;
+const float S32_MIN_F = -2147483648.0f;
+const float S32_SCALE = 2147483648.0f;
+const float S16_MAX_F = 32767.0f;
+const float S16_MIN_F = -32768.0f;
+const float S16_SCALE = 32768.0f;
+
+struct Kernels
+{
+    void (*gainS32)(int32_t *, int, float);
+    void (*gainS16)(int16_t *, int, float);
+    void (*gainFlt)(float *, int, float);
+    void (*mixS32)(int32_t *, const int32_t *, int);
+    void (*mixS16)(int16_t *, const int16_t *, int);
+    void (*mixFlt)(float *, const float *, int);
+    void (*s32ToS16)(int16_t *, const int32_t *, int);
+    void (*s16ToS32)(int32_t *, const int16_t *, int);
+    void (*s32ToFlt)(float *, const int32_t *, int);
+    void (*fltToS32)(int32_t *, const float *, int);
+    void (*s16ToFlt)(float *, const int16_t *, int);
+    void (*fltToS16)(int16_t *, const float *, int);
+    void (*interleave2)(int32_t *, const int32_t *, const int32_t *, int);
+    void (*deinterleave2)(int32_t *, int32_t *, const int32_t *, int);
+};
+
+/*********************************** Scalar ***********************************/
+//标量实现同时作为参考实现，SIMD 实现的舍入和饱和方式与其保持一致
+
+inline float clampf(float x, float lo, float hi)
+{
+    return std::min(std::max(x, lo), hi);
+}
+
+void gainS32_c(int32_t *samples, int count, float gain)
+{
+    for (int i = 0; i < count; i++)
+        samples[i] = int32_t(std::lrint(clampf(float(samples[i]) * gain, S32_MIN_F, S32_MAX_F)));
+}
+
+void gainS16_c(int16_t *samples, int count, float gain)
+{
+    for (int i = 0; i < count; i++)
+        samples[i] = int16_t(std::lrint(clampf(float(samples[i]) * gain, S16_MIN_F, S16_MAX_F)));
+}
+
+void gainFlt_c(float *samples, int count, float gain)
+{
+    for (int i = 0; i < count; i++)
+        samples[i] *= gain;
+}
+
+void mixS32_c(int32_t *dst, const int32_t *src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int64_t sum = int64_t(dst[i]) + src[i];
+        dst[i] = int32_t(std::min<int64_t>(std::max<int64_t>(sum, INT32_MIN), INT32_MAX));
+    }
+}
+
+void mixS16_c(int16_t *dst, const int16_t *src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        int sum = int(dst[i]) + src[i];
+        dst[i] = int16_t(std::min(std::max(sum, int(INT16_MIN)), int(INT16_MAX)));
+    }
+}
+
+void mixFlt_c(float *dst, const float *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] += src[i];
+}
+
+void s32ToS16_c(int16_t *dst, const int32_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = int16_t(src[i] >> 16);
+}
+
+void s16ToS32_c(int32_t *dst, const int16_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = int32_t(uint32_t(uint16_t(src[i])) << 16);
+}
+
+void s32ToFlt_c(float *dst, const int32_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = float(src[i]) * (1.0f / S32_SCALE);
+}
+
+void fltToS32_c(int32_t *dst, const float *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = int32_t(std::lrint(clampf(src[i] * S32_SCALE, S32_MIN_F, S32_MAX_F)));
+}
+
+void s16ToFlt_c(float *dst, const int16_t *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = float(src[i]) * (1.0f / S16_SCALE);
+}
+
+void fltToS16_c(int16_t *dst, const float *src, int count)
+{
+    for (int i = 0; i < count; i++)
+        dst[i] = int16_t(std::lrint(clampf(src[i] * S16_SCALE, S16_MIN_F, S16_MAX_F)));
+}
+
+void interleave2_c(int32_t *dst, const int32_t *left, const int32_t *right, int frames)
+{
+    for (int i = 0; i < frames; i++) {
+        dst[2 * i] = left[i];
+        dst[2 * i + 1] = right[i];
+    }
+}
+
+void deinterleave2_c(int32_t *left, int32_t *right, const int32_t *src, int frames)
+{
+    for (int i = 0; i < frames; i++) {
+        left[i] = src[2 * i];
+        right[i] = src[2 * i + 1];
+    }
+}
+
+const Kernels scalarKernels = {
+    gainS32_c, gainS16_c, gainFlt_c,
+    mixS32_c, mixS16_c, mixFlt_c,
+    s32ToS16_c, s16ToS32_c, s32ToFlt_c, fltToS32_c, s16ToFlt_c, fltToS16_c,
+    interleave2_c, deinterleave2_c
+};
+
+#ifdef PCMDSP_X86
+/************************************ SSE2 ************************************/
+
+PCMDSP_TARGET_SSE2 inline __m128i clampCvtS32_sse2(__m128 x)
+{
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, _mm_set1_ps(S32_MIN_F)), _mm_set1_ps(S32_MAX_F)));
+}
+
+PCMDSP_TARGET_SSE2 inline __m128i clampCvtS16_sse2(__m128 x)
+{
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, _mm_set1_ps(S16_MIN_F)), _mm_set1_ps(S16_MAX_F)));
+}
+
+PCMDSP_TARGET_SSE2 void gainS32_sse2(int32_t *samples, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(samples + i), clampCvtS32_sse2(_mm_mul_ps(x, g)));
+    }
+    gainS32_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_SSE2 void gainS16_sse2(int16_t *samples, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        __m128i r = _mm_packs_epi32(clampCvtS16_sse2(_mm_mul_ps(lo, g)), clampCvtS16_sse2(_mm_mul_ps(hi, g)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(samples + i), r);
+    }
+    gainS16_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_SSE2 void gainFlt_sse2(float *samples, int count, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+    gainFlt_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_SSE2 void mixS32_sse2(int32_t *dst, const int32_t *src, int count)
+{
+    const __m128i maxv = _mm_set1_epi32(INT32_MAX);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i s = _mm_add_epi32(a, b);
+        //同号相加结果变号即溢出，溢出时按 a 的符号取 INT32_MAX / INT32_MIN
+        __m128i overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, s), _mm_xor_si128(b, s)), 31);
+        __m128i saturated = _mm_xor_si128(_mm_srai_epi32(a, 31), maxv);
+        s = _mm_or_si128(_mm_and_si128(overflow, saturated), _mm_andnot_si128(overflow, s));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), s);
+    }
+    mixS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void mixS16_sse2(int16_t *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epi16(a, b));
+    }
+    mixS16_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void mixFlt_sse2(float *dst, const float *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    mixFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void s32ToS16_sse2(int16_t *dst, const int32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), 16);
+        __m128i hi = _mm_srai_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4)), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    s32ToS16_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void s16ToS32_sse2(int32_t *dst, const int16_t *src, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi16(zero, x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 4), _mm_unpackhi_epi16(zero, x));
+    }
+    s16ToS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void s32ToFlt_sse2(float *dst, const int32_t *src, int count)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / S32_SCALE);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(x, scale));
+    }
+    s32ToFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void fltToS32_sse2(int32_t *dst, const float *src, int count)
+{
+    const __m128 scale = _mm_set1_ps(S32_SCALE);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i x = clampCvtS32_sse2(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), x);
+    }
+    fltToS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void s16ToFlt_sse2(float *dst, const int16_t *src, int count)
+{
+    const __m128 scale = _mm_set1_ps(1.0f / S16_SCALE);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(lo, scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(hi, scale));
+    }
+    s16ToFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void fltToS16_sse2(int16_t *dst, const float *src, int count)
+{
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = clampCvtS16_sse2(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+        __m128i hi = clampCvtS16_sse2(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    fltToS16_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_SSE2 void interleave2_sse2(int32_t *dst, const int32_t *left, const int32_t *right, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), _mm_unpacklo_epi32(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i + 4), _mm_unpackhi_epi32(l, r));
+    }
+    interleave2_c(dst + 2 * i, left + i, right + i, frames - i);
+}
+
+PCMDSP_TARGET_SSE2 void deinterleave2_sse2(int32_t *left, int32_t *right, const int32_t *src, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        //[L0 R0 L1 R1] [L2 R2 L3 R3] -> [L0 L1 R0 R1] [L2 L3 R2 R3]
+        __m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i)), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(left + i), _mm_unpacklo_epi64(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(right + i), _mm_unpackhi_epi64(a, b));
+    }
+    deinterleave2_c(left + i, right + i, src + 2 * i, frames - i);
+}
+
+const Kernels sse2Kernels = {
+    gainS32_sse2, gainS16_sse2, gainFlt_sse2,
+    mixS32_sse2, mixS16_sse2, mixFlt_sse2,
+    s32ToS16_sse2, s16ToS32_sse2, s32ToFlt_sse2, fltToS32_sse2, s16ToFlt_sse2, fltToS16_sse2,
+    interleave2_sse2, deinterleave2_sse2
+};
+
+/************************************ AVX2 ************************************/
+
+PCMDSP_TARGET_AVX2 inline __m256i clampCvtS32_avx2(__m256 x)
+{
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(S32_MIN_F)), _mm256_set1_ps(S32_MAX_F)));
+}
+
+PCMDSP_TARGET_AVX2 inline __m256i clampCvtS16_avx2(__m256 x)
+{
+    return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(S16_MIN_F)), _mm256_set1_ps(S16_MAX_F)));
+}
+
+//_mm256_packs_epi32 按 128 位通道分别打包，需要重新排列 64 位块
+PCMDSP_TARGET_AVX2 inline __m256i packS32ToS16_avx2(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+PCMDSP_TARGET_AVX2 void gainS32_avx2(int32_t *samples, int count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(samples + i), clampCvtS32_avx2(_mm256_mul_ps(x, g)));
+    }
+    gainS32_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_AVX2 void gainS16_avx2(int16_t *samples, int count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i))));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i + 8))));
+        __m256i r = packS32ToS16_avx2(clampCvtS16_avx2(_mm256_mul_ps(lo, g)), clampCvtS16_avx2(_mm256_mul_ps(hi, g)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(samples + i), r);
+    }
+    gainS16_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_AVX2 void gainFlt_avx2(float *samples, int count, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), g));
+    gainFlt_c(samples + i, count - i, gain);
+}
+
+PCMDSP_TARGET_AVX2 void mixS32_avx2(int32_t *dst, const int32_t *src, int count)
+{
+    const __m256i maxv = _mm256_set1_epi32(INT32_MAX);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i s = _mm256_add_epi32(a, b);
+        __m256i overflow = _mm256_srai_epi32(_mm256_and_si256(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s)), 31);
+        __m256i saturated = _mm256_xor_si256(_mm256_srai_epi32(a, 31), maxv);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_blendv_epi8(s, saturated, overflow));
+    }
+    mixS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void mixS16_avx2(int16_t *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epi16(a, b));
+    }
+    mixS16_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void mixFlt_avx2(float *dst, const float *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    mixFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void s32ToS16_avx2(int16_t *dst, const int32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)), 16);
+        __m256i hi = _mm256_srai_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i + 8)), 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packS32ToS16_avx2(lo, hi));
+    }
+    s32ToS16_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void s16ToS32_avx2(int32_t *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_slli_epi32(x, 16));
+    }
+    s16ToS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void s32ToFlt_avx2(float *dst, const int32_t *src, int count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / S32_SCALE);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(x, scale));
+    }
+    s32ToFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void fltToS32_avx2(int32_t *dst, const float *src, int count)
+{
+    const __m256 scale = _mm256_set1_ps(S32_SCALE);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = clampCvtS32_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), x);
+    }
+    fltToS32_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void s16ToFlt_avx2(float *dst, const int16_t *src, int count)
+{
+    const __m256 scale = _mm256_set1_ps(1.0f / S16_SCALE);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(x, scale));
+    }
+    s16ToFlt_c(dst + i, src + i, count - i);
+}
+
+PCMDSP_TARGET_AVX2 void fltToS16_avx2(int16_t *dst, const float *src, int count)
+{
+    const __m256 scale = _mm256_set1_ps(S16_SCALE);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = clampCvtS16_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i), scale));
+        __m256i hi = clampCvtS16_avx2(_mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packS32ToS16_avx2(lo, hi));
+    }
+    fltToS16_c(dst + i, src + i, count - i);
+}
+
+//交错/解交错受内存带宽限制，AVX2 下沿用 SSE2 实现
+const Kernels avx2Kernels = {
+    gainS32_avx2, gainS16_avx2, gainFlt_avx2,
+    mixS32_avx2, mixS16_avx2, mixFlt_avx2,
+    s32ToS16_avx2, s16ToS32_avx2, s32ToFlt_avx2, fltToS32_avx2, s16ToFlt_avx2, fltToS16_avx2,
+    interleave2_sse2, deinterleave2_sse2
+};
+#endif //PCMDSP_X86
+
+#ifdef PCMDSP_NEON
+/************************************ NEON ************************************/
+
+inline int32x4_t clampCvtS32_neon(float32x4_t x)
+{
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(S32_MIN_F)), vdupq_n_f32(S32_MAX_F));
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(x);
+#else
+    //ARMv7 没有就近舍入的转换指令：|x| < 2^23 时 |x| + 2^23 - 2^23 按 NEON 固定的就近偶数舍入为整数，
+    //与标量的 lrint 相同(0.5 -> 0, 1.5 -> 2)；|x| >= 2^23 的 float 本身就是整数，再恢复符号后截断
+    const float32x4_t two23 = vdupq_n_f32(8388608.0f);
+    float32x4_t magnitude = vabsq_f32(x);
+    float32x4_t rounded = vsubq_f32(vaddq_f32(magnitude, two23), two23);
+    rounded = vbslq_f32(vcltq_f32(magnitude, two23), rounded, magnitude);
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+    return vcvtq_s32_f32(vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(rounded), sign)));
+#endif
+}
+
+inline int32x4_t clampCvtS16_neon(float32x4_t x)
+{
+    return clampCvtS32_neon(vminq_f32(vmaxq_f32(x, vdupq_n_f32(S16_MIN_F)), vdupq_n_f32(S16_MAX_F)));
+}
+
+void gainS32_neon(int32_t *samples, int count, float gain)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(samples + i)), gain);
+        vst1q_s32(samples + i, clampCvtS32_neon(x));
+    }
+    gainS32_c(samples + i, count - i, gain);
+}
+
+void gainS16_neon(int16_t *samples, int count, float gain)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(samples + i);
+        float32x4_t lo = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), gain);
+        float32x4_t hi = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), gain);
+        vst1q_s16(samples + i, vcombine_s16(vqmovn_s32(clampCvtS16_neon(lo)), vqmovn_s32(clampCvtS16_neon(hi))));
+    }
+    gainS16_c(samples + i, count - i, gain);
+}
+
+void gainFlt_neon(float *samples, int count, float gain)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+    gainFlt_c(samples + i, count - i, gain);
+}
+
+void mixS32_neon(int32_t *dst, const int32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32(dst + i, vqaddq_s32(vld1q_s32(dst + i), vld1q_s32(src + i)));
+    mixS32_c(dst + i, src + i, count - i);
+}
+
+void mixS16_neon(int16_t *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        vst1q_s16(dst + i, vqaddq_s16(vld1q_s16(dst + i), vld1q_s16(src + i)));
+    mixS16_c(dst + i, src + i, count - i);
+}
+
+void mixFlt_neon(float *dst, const float *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    mixFlt_c(dst + i, src + i, count - i);
+}
+
+void s32ToS16_neon(int16_t *dst, const int32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1_s16(dst + i, vshrn_n_s32(vld1q_s32(src + i), 16));
+    s32ToS16_c(dst + i, src + i, count - i);
+}
+
+void s16ToS32_neon(int32_t *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32(dst + i, vshll_n_s16(vld1_s16(src + i), 16));
+    s16ToS32_c(dst + i, src + i, count - i);
+}
+
+void s32ToFlt_neon(float *dst, const int32_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(src + i)), 1.0f / S32_SCALE));
+    s32ToFlt_c(dst + i, src + i, count - i);
+}
+
+void fltToS32_neon(int32_t *dst, const float *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_s32(dst + i, clampCvtS32_neon(vmulq_n_f32(vld1q_f32(src + i), S32_SCALE)));
+    fltToS32_c(dst + i, src + i, count - i);
+}
+
+void s16ToFlt_neon(float *dst, const int16_t *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(src + i))), 1.0f / S16_SCALE));
+    s16ToFlt_c(dst + i, src + i, count - i);
+}
+
+void fltToS16_neon(int16_t *dst, const float *src, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1_s16(dst + i, vqmovn_s32(clampCvtS16_neon(vmulq_n_f32(vld1q_f32(src + i), S16_SCALE))));
+    fltToS16_c(dst + i, src + i, count - i);
+}
+
+void interleave2_neon(int32_t *dst, const int32_t *left, const int32_t *right, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int32x4x2_t lr;
+        lr.val[0] = vld1q_s32(left + i);
+        lr.val[1] = vld1q_s32(right + i);
+        vst2q_s32(dst + 2 * i, lr);
+    }
+    interleave2_c(dst + 2 * i, left + i, right + i, frames - i);
+}
+
+void deinterleave2_neon(int32_t *left, int32_t *right, const int32_t *src, int frames)
+{
+    int i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int32x4x2_t lr = vld2q_s32(src + 2 * i);
+        vst1q_s32(left + i, lr.val[0]);
+        vst1q_s32(right + i, lr.val[1]);
+    }
+    deinterleave2_c(left + i, right + i, src + 2 * i, frames - i);
+}
+
+const Kernels neonKernels = {
+    gainS32_neon, gainS16_neon, gainFlt_neon,
+    mixS32_neon, mixS16_neon, mixFlt_neon,
+    s32ToS16_neon, s16ToS32_neon, s32ToFlt_neon, fltToS32_neon, s16ToFlt_neon, fltToS16_neon,
+    interleave2_neon, deinterleave2_neon
+};
+#endif //PCMDSP_NEON
+
+const Kernels *kernelsFor(PcmDsp::Backend backend)
+{
+    switch (backend) {
+#ifdef PCMDSP_X86
+    case PcmDsp::SSE2: return &sse2Kernels;
+    case PcmDsp::AVX2: return &avx2Kernels;
+#endif
+#ifdef PCMDSP_NEON
+    case PcmDsp::NEON: return &neonKernels;
+#endif
+    default: return &scalarKernels;
+    }
+}
+
+bool isSupported(PcmDsp::Backend backend)
+{
+    int flags = av_get_cpu_flags();
+    switch (backend) {
+    case PcmDsp::Scalar: return true;
+#ifdef PCMDSP_X86
+    case PcmDsp::SSE2: return flags & AV_CPU_FLAG_SSE2;
+    case PcmDsp::AVX2: return flags & AV_CPU_FLAG_AVX2;
+#endif
+#ifdef PCMDSP_NEON
+    case PcmDsp::NEON: return flags & AV_CPU_FLAG_NEON;
+#endif
+    default: return false;
+    }
+}
+
+PcmDsp::Backend detectBackend()
+{
+    //AVXSLOW 的 CPU(如 Bulldozer) 上 256 位指令反而更慢
+    if (isSupported(PcmDsp::AVX2) && !(av_get_cpu_flags() & AV_CPU_FLAG_AVXSLOW)) return PcmDsp::AVX2;
+    if (isSupported(PcmDsp::SSE2)) return PcmDsp::SSE2;
+    if (isSupported(PcmDsp::NEON)) return PcmDsp::NEON;
+
+    return PcmDsp::Scalar;
+}
+
+std::atomic<PcmDsp::Backend> s_backend(PcmDsp::Auto);
+
+inline const Kernels *kernels()
+{
+    PcmDsp::Backend backend = s_backend.load(std::memory_order_relaxed);
+    if (backend == PcmDsp::Auto) {
+        backend = detectBackend();
+        s_backend.store(backend, std::memory_order_relaxed);
+    }
+
+    return kernelsFor(backend);
+}
+
+} //namespace
+
+PcmDsp::Backend PcmDsp::setBackend(Backend backend)
+{
+    if (backend == Auto) backend = detectBackend();
+    else if (!isSupported(backend)) backend = Scalar;
+    s_backend.store(backend);
+
+    return backend;
+}
+
+PcmDsp::Backend PcmDsp::backend()
+{
+    kernels();
+    return s_backend.load();
+}
+
+const char *PcmDsp::backendName(Backend backend)
+{
+    switch (backend) {
+    case Scalar: return "Scalar";
+    case SSE2: return "SSE2";
+    case AVX2: return "AVX2";
+    case NEON: return "NEON";
+    default: return "Auto";
+    }
+}
+
+void PcmDsp::applyGain(int32_t *samples, int count, float gain)
+{
+    kernels()->gainS32(samples, count, gain);
+}
+
+void PcmDsp::applyGain(int16_t *samples, int count, float gain)
+{
+    kernels()->gainS16(samples, count, gain);
+}
+
+void PcmDsp::applyGain(float *samples, int count, float gain)
+{
+    kernels()->gainFlt(samples, count, gain);
+}
+
+void PcmDsp::mix(int32_t *dst, const int32_t *src, int count)
+{
+    kernels()->mixS32(dst, src, count);
+}
+
+void PcmDsp::mix(int16_t *dst, const int16_t *src, int count)
+{
+    kernels()->mixS16(dst, src, count);
+}
+
+void PcmDsp::mix(float *dst, const float *src, int count)
+{
+    kernels()->mixFlt(dst, src, count);
+}
+
+void PcmDsp::convert(int16_t *dst, const int32_t *src, int count)
+{
+    kernels()->s32ToS16(dst, src, count);
+}
+
+void PcmDsp::convert(int32_t *dst, const int16_t *src, int count)
+{
+    kernels()->s16ToS32(dst, src, count);
+}
+
+void PcmDsp::convert(float *dst, const int32_t *src, int count)
+{
+    kernels()->s32ToFlt(dst, src, count);
+}
+
+void PcmDsp::convert(int32_t *dst, const float *src, int count)
+{
+    kernels()->fltToS32(dst, src, count);
+}
+
+void PcmDsp::convert(float *dst, const int16_t *src, int count)
+{
+    kernels()->s16ToFlt(dst, src, count);
+}
+
+void PcmDsp::convert(int16_t *dst, const float *src, int count)
+{
+    kernels()->fltToS16(dst, src, count);
+}
+
+void PcmDsp::interleave(int32_t *dst, const int32_t * const *src, int channels, int frames)
+{
+    if (channels == 2) {
+        kernels()->interleave2(dst, src[0], src[1], frames);
+    } else {
+        for (int i = 0; i < frames; i++)
+            for (int c = 0; c < channels; c++)
+                *dst++ = src[c][i];
+    }
+}
+
+void PcmDsp::deinterleave(int32_t * const *dst, const int32_t *src, int channels, int frames)
+{
+    if (channels == 2) {
+        kernels()->deinterleave2(dst[0], dst[1], src, frames);
+    } else {
+        for (int i = 0; i < frames; i++)
+            for (int c = 0; c < channels; c++)
+                dst[c][i] = *src++;
+    }
+}
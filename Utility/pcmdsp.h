@@ -0,0 +1,56 @@
+#ifndef PCMDSP_H
+#define PCMDSP_H
+
+#include <cstdint>
+
+/**
+ * @brief PcmDsp
+ * @note PCM 音频处理：增益、混音(饱和)、格式转换、交错/解交错
+ *       内部按 CPU 特性(AVX2 / SSE2 / NEON)在运行时选择实现，没有可用指令集时使用标量实现
+ *       所有 count 均为采样点总数(即 帧数 * 声道数)
+ */
+class PcmDsp
+{
+public:
+    enum Backend
+    {
+        Auto = 0,
+        Scalar,
+        SSE2,
+        AVX2,
+        NEON
+    };
+
+    /**
+     * @brief setBackend
+     * @note 强制使用某个实现(主要用于测试和基准)，不支持的实现会回退到 Scalar
+     * @return 实际使用的实现
+     */
+    static Backend setBackend(Backend backend);
+    static Backend backend();
+    static const char *backendName(Backend backend);
+
+    //增益，原地修改，整数格式带饱和
+    static void applyGain(int32_t *samples, int count, float gain);
+    static void applyGain(int16_t *samples, int count, float gain);
+    static void applyGain(float *samples, int count, float gain);
+
+    //混音，dst += src，整数格式带饱和
+    static void mix(int32_t *dst, const int32_t *src, int count);
+    static void mix(int16_t *dst, const int16_t *src, int count);
+    static void mix(float *dst, const float *src, int count);
+
+    //格式转换，浮点范围为[-1.0, 1.0)
+    static void convert(int16_t *dst, const int32_t *src, int count);
+    static void convert(int32_t *dst, const int16_t *src, int count);
+    static void convert(float *dst, const int32_t *src, int count);
+    static void convert(int32_t *dst, const float *src, int count);
+    static void convert(float *dst, const int16_t *src, int count);
+    static void convert(int16_t *dst, const float *src, int count);
+
+    //交错/解交错(32位采样，S32 和 float 通用)，frames 为每个声道的采样数
+    static void interleave(int32_t *dst, const int32_t * const *src, int channels, int frames);
+    static void deinterleave(int32_t * const *dst, const int32_t *src, int channels, int frames);
+};
+
+#endif
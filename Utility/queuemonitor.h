@@ -0,0 +1,31 @@
+#ifndef QUEUEMONITOR_H
+#define QUEUEMONITOR_H
+
+#include <cstdint>
+
+/**
+ * @brief NullQueueMonitor
+ * @note BufferQueue / MpmcQueue 的监视策略(模板参数 Monitor)的默认值：什么都不记录，编译后没有额外代码
+ *       队列本身不依赖 Metrics / Tracing；需要运行指标时使用 meteredqueue.h 中的 MeteredQueueMonitor
+ *
+ *       策略需要提供的接口：
+ *       isActive()          是否在记录，为false时队列跳过下面的 enqueued() / dequeued()
+ *       timestamp()         入队时间戳，不记录时为0
+ *       waitFull(wait)      队列满、即将阻塞时调用，由策略执行 wait()
+ *       waitEmpty(wait)     队列空、即将阻塞时调用
+ *       enqueued(depth)     入队后的深度
+ *       dequeued(t, depth)  出队，t 为该元素的 timestamp()
+ *       reset()             队列被清空
+ */
+struct NullQueueMonitor
+{
+    bool isActive() const { return false; }
+    int64_t timestamp() const { return 0; }
+    template <class Wait> void waitFull(const Wait &wait) { wait(); }
+    template <class Wait> void waitEmpty(const Wait &wait) { wait(); }
+    void enqueued(int) { }
+    void dequeued(int64_t, int) { }
+    void reset() { }
+};
+
+#endif // QUEUEMONITOR_H
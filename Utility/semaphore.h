@@ -17,28 +17,27 @@ public:
 
     void acquire(int i = 1) {
         if (i <= 0) return;
+        if (take(i)) return;
 
+        //被唤醒后重新检查：虚假唤醒或被其他线程抢先时继续等待
         std::unique_lock<std::mutex> lock(m_mutex);
-        if (m_semaphore.load() < i) {
-            m_conditionVar.wait(lock);
-        }
-        m_semaphore.fetch_sub(i);
+        m_conditionVar.wait(lock, [this, i] { return take(i); });
     }
 
     bool tryAcquire(int i = 1) {
         if (i <= 0) return false;
 
-        if (m_semaphore.load() >= i) {
-            m_semaphore.fetch_sub(i);
-            return true;
-        } else return false;
+        return take(i);
     }
 
     void release(int i = 1) {
         if (i <= 0) return;
 
         m_semaphore.fetch_add(i);
-        m_conditionVar.notify_one();
+        //加锁后再通知：等待方在检查计数和进入等待之间持有锁，不会错过这次唤醒
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        if (i == 1) m_conditionVar.notify_one();
+        else m_conditionVar.notify_all();
     }
 
     int available() const {
@@ -46,6 +45,15 @@ public:
     }
 
 private:
+    //计数足够时减去 i，与其他 acquire / tryAcquire 竞争时不会减成负数
+    bool take(int i) {
+        int value = m_semaphore.load();
+        while (value >= i) {
+            if (m_semaphore.compare_exchange_weak(value, value - i)) return true;
+        }
+        return false;
+    }
+
     std::condition_variable m_conditionVar;
     std::atomic_int m_semaphore;
     std::mutex m_mutex;
@@ -6,6 +6,7 @@
 class SpinLock
 {
 public:
+    SpinLock() { }
     SpinLock(const SpinLock &) = delete;
     SpinLock& operator=(const SpinLock &) = delete;
 
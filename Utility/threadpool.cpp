@@ -0,0 +1,172 @@
+#include "threadpool.h"
+#include "tracing.h"
+
+#include <string>
+
+namespace
+{
+
+//当前线程所属的线程池和序号
+thread_local const ThreadPool *t_pool = nullptr;
+thread_local int t_worker = -1;
+
+} //namespace
+
+ThreadPool::ThreadPool(int threads)
+{
+    if (threads <= 0) threads = int(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 1;
+
+    for (int i = 0; i < threads; i++) m_workers.emplace_back(new Worker);
+    for (int i = 0; i < threads; i++) m_workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    waitForDone();
+
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeup.notify_all();
+    for (auto &worker : m_workers) worker->thread.join();
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(const Task &task, Priority priority, int affinity)
+{
+    if (!task) return;
+    if (priority < High || priority >= PriorityCount) priority = Normal;
+
+    int index;
+    if (affinity >= 0) index = affinity % threadCount();
+    else if (t_pool == this) index = t_worker;
+    else index = int(m_nextWorker++ % uint32_t(threadCount()));
+
+    m_unfinished++;
+    {
+        //m_queued 与队列在同一把锁内修改，大于 0 时一定有任务可取
+        Worker &worker = *m_workers[index];
+        std::lock_guard<std::mutex> locker(worker.mutex);
+        worker.queues[priority].push_back(task);
+        m_queued++;
+    }
+
+    //加锁后再通知：工作线程在检查 m_queued 和进入等待之间持有锁，不会错过
+    { std::lock_guard<std::mutex> locker(m_mutex); }
+    m_wakeup.notify_one();
+}
+
+void ThreadPool::waitForDone()
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+    m_done.wait(locker, [this] { return m_unfinished.load() == 0; });
+}
+
+int ThreadPool::currentWorker() const
+{
+    return t_pool == this ? t_worker : -1;
+}
+
+bool ThreadPool::take(int index, Task &task)
+{
+    int count = threadCount();
+    for (int priority = High; priority < PriorityCount; priority++) {
+        //先取自己的队头
+        {
+            Worker &worker = *m_workers[index];
+            std::lock_guard<std::mutex> locker(worker.mutex);
+            std::deque<Task> &queue = worker.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                m_queued--;
+                return true;
+            }
+        }
+
+        //再从下一个线程开始依次偷队尾
+        for (int i = 1; i < count; i++) {
+            Worker &victim = *m_workers[(index + i) % count];
+            std::lock_guard<std::mutex> locker(victim.mutex);
+            std::deque<Task> &queue = victim.queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                m_queued--;
+                m_stolen++;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::run(int index)
+{
+    t_pool = this;
+    t_worker = index;
+    TRACE_THREAD_NAME("PoolWorker" + std::to_string(index));
+
+    Task task;
+    while (true) {
+        if (take(index, task)) {
+            {
+                TRACE_SCOPE("pool_task");
+                task();
+            }
+            task = nullptr;
+            m_executed++;
+
+            if (--m_unfinished == 0) {
+                { std::lock_guard<std::mutex> locker(m_mutex); }
+                m_done.notify_all();
+            }
+            continue;
+        }
+
+        //m_queued 只计还在队列里的任务，这里返回后重试 take() 时任务要么还在，要么已被别的线程取走使计数归零，
+        //不会在取不到任务的情况下空转
+        std::unique_lock<std::mutex> locker(m_mutex);
+        m_wakeup.wait(locker, [this] { return m_stopping || m_queued.load() > 0; });
+        if (m_stopping && m_queued.load() == 0) break;
+    }
+}
+
+void TaskGroup::submit(const ThreadPool::Task &task, ThreadPool::Priority priority, int affinity)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_pending++;
+    }
+    m_pool.submit([this, task]() {
+        task();
+        finish();
+    }, priority, affinity);
+}
+
+void TaskGroup::wait()
+{
+    std::unique_lock<std::mutex> locker(m_mutex);
+    m_done.wait(locker, [this] { return m_pending == 0; });
+}
+
+int TaskGroup::pending() const
+{
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_pending;
+}
+
+void TaskGroup::finish()
+{
+    //在锁内通知：wait() 返回(TaskGroup 可能随即析构)时本函数已经不再访问成员
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (--m_pending == 0) m_done.notify_all();
+}
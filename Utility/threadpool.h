@@ -0,0 +1,175 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ThreadPool
+ * @note 工作窃取线程池：每个工作线程有自己的任务队列(每个优先级一个)，自己的队列空了再去别的线程的队列里偷
+ *       工作线程按提交顺序(队头)执行自己的任务，偷的时候从队尾取，与队列的主人竞争最少
+ *       高优先级的任务(包括别的线程队列里的)总是先于低优先级的任务执行
+ */
+class ThreadPool
+{
+public:
+    enum Priority
+    {
+        High = 0,
+        Normal,
+        Low,
+        PriorityCount
+    };
+
+    typedef std::function<void()> Task;
+
+    struct Statistics
+    {
+        int64_t executed;
+        //从其他工作线程的队列中偷来执行的任务数
+        int64_t stolen;
+    };
+
+    //threads 为0时使用逻辑核数
+    explicit ThreadPool(int threads = 0);
+    //等待已提交的任务全部完成后结束
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    //进程内共享的线程池，第一次调用时创建
+    static ThreadPool &instance();
+
+    /**
+     * @brief submit
+     * @param affinity 亲和提示：放入第 affinity 个工作线程(取模)的队列，仍可能被其他线程偷走
+     *                 为-1时，工作线程提交的任务放入自己的队列，其他线程提交的轮流分配
+     */
+    void submit(const Task &task, Priority priority = Normal, int affinity = -1);
+    //阻塞到已提交的任务全部完成(包括其他调用者提交的)，只等自己的一批任务时用 TaskGroup
+    void waitForDone();
+
+    int threadCount() const { return int(m_workers.size()); }
+    /**
+     * @brief currentWorker
+     * @return 调用线程在本线程池中的序号(0 到 threadCount() - 1)，不是本线程池的工作线程时返回-1
+     *         可以用来索引每个工作线程独占的资源(如 SwsContext)
+     */
+    int currentWorker() const;
+
+    Statistics statistics() const { return Statistics { m_executed.load(), m_stolen.load() }; }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> queues[PriorityCount];
+        std::thread thread;
+    };
+
+    void run(int index);
+    bool take(int index, Task &task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_done;
+    //各个队列中的任务总数(入队/出队时在队列的锁内修改)，工作线程据此决定是否休眠
+    std::atomic<int64_t> m_queued { 0 };
+    //已提交还未完成的任务数
+    std::atomic<int64_t> m_unfinished { 0 };
+    std::atomic<uint32_t> m_nextWorker { 0 };
+    std::atomic<int64_t> m_executed { 0 };
+    std::atomic<int64_t> m_stolen { 0 };
+    bool m_stopping = false;
+};
+
+/**
+ * @brief TaskGroup
+ * @note 经由线程池提交的一批任务，wait() 只等这一批完成，不受共享线程池中其他任务的影响
+ *       析构时等待，任务可以安全地引用与 TaskGroup 同一作用域的局部变量
+ */
+class TaskGroup
+{
+public:
+    explicit TaskGroup(ThreadPool &pool) : m_pool(pool) { }
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    //参数与 ThreadPool::submit() 相同
+    void submit(const ThreadPool::Task &task, ThreadPool::Priority priority = ThreadPool::Normal, int affinity = -1);
+    //阻塞到本组已提交的任务全部完成
+    void wait();
+    //本组已提交还未完成的任务数
+    int pending() const;
+
+private:
+    void finish();
+
+    ThreadPool &m_pool;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    int m_pending = 0;
+};
+
+/**
+ * @brief OrderedOutput
+ * @note 多个任务乱序完成时，按序号(从 0 开始连续编号)依次输出结果
+ *       push() 可以在任意线程调用，输出函数在锁内调用，同一时刻只有一个线程在输出
+ */
+template <class T> class OrderedOutput
+{
+public:
+    typedef std::function<void(T &value)> Output;
+
+    explicit OrderedOutput(const Output &output = Output()) : m_output(output) { }
+
+    void setOutput(const Output &output) {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_output = output;
+    }
+
+    //丢弃暂存的结果，下一个输出的序号为 next
+    void reset(uint64_t next = 0) {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_pending.clear();
+        m_next = next;
+    }
+
+    void push(uint64_t sequence, T value) {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (sequence < m_next) return;
+
+        m_pending.emplace(sequence, std::move(value));
+        while (!m_pending.empty() && m_pending.begin()->first == m_next) {
+            if (m_output) m_output(m_pending.begin()->second);
+            m_pending.erase(m_pending.begin());
+            m_next++;
+        }
+    }
+
+    //下一个等待输出的序号
+    uint64_t next() const {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        return m_next;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::map<uint64_t, T> m_pending;
+    uint64_t m_next = 0;
+    Output m_output;
+};
+
+#endif // THREADPOOL_H
@@ -0,0 +1,207 @@
+#include "tracing.h"
+#include "spinlock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t begin;
+    //完整事件为持续时间，计数器为数值
+    int64_t value;
+    uint32_t tid;
+    char phase;
+};
+
+/**
+ * 线程缓冲只有所属线程写入，锁只在 dump() / clear() 读取时才会有竞争
+ * 线程退出后缓冲不释放，标记为空闲，之后新建的线程接着使用(保留其中的旧事件)
+ */
+struct ThreadBuffer
+{
+    SpinLock lock;
+    std::vector<TraceEvent> events;
+    uint64_t written = 0;
+    bool retired = false;
+};
+
+struct Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    std::atomic_bool enabled { true };
+    std::atomic<uint32_t> nextTid { 1 };
+};
+
+Registry &registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+struct ThreadSlot
+{
+    ThreadBuffer *buffer = nullptr;
+    uint32_t tid = 0;
+
+    ~ThreadSlot() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> locker(registry().mutex);
+        buffer->retired = true;
+    }
+};
+
+ThreadSlot &thread_slot()
+{
+    thread_local ThreadSlot slot;
+    if (slot.tid == 0) slot.tid = registry().nextTid++;
+    if (!slot.buffer) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> locker(r.mutex);
+        for (auto &buffer : r.buffers) {
+            if (buffer->retired) {
+                buffer->retired = false;
+                slot.buffer = buffer.get();
+                break;
+            }
+        }
+        if (!slot.buffer) {
+            r.buffers.emplace_back(new ThreadBuffer);
+            r.buffers.back()->events.resize(Tracing::BufferEvents);
+            slot.buffer = r.buffers.back().get();
+        }
+    }
+
+    return slot;
+}
+
+void record(const char *name, char phase, int64_t begin, int64_t value)
+{
+    if (!registry().enabled.load(std::memory_order_relaxed)) return;
+
+    ThreadSlot &slot = thread_slot();
+    ThreadBuffer *buffer = slot.buffer;
+    buffer->lock.lock();
+    TraceEvent &event = buffer->events[buffer->written++ % Tracing::BufferEvents];
+    event.name = name;
+    event.begin = begin;
+    event.value = value;
+    event.tid = slot.tid;
+    event.phase = phase;
+    buffer->lock.unlock();
+}
+
+void write_string(FILE *file, const char *text)
+{
+    std::fputc('"', file);
+    for (const char *c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') std::fputc('\\', file);
+        if (static_cast<unsigned char>(*c) >= 0x20) std::fputc(*c, file);
+    }
+    std::fputc('"', file);
+}
+
+} //namespace
+
+void Tracing::setEnabled(bool enabled)
+{
+    registry().enabled = enabled;
+}
+
+bool Tracing::isEnabled()
+{
+    return registry().enabled.load(std::memory_order_relaxed);
+}
+
+void Tracing::complete(const char *name, int64_t begin, int64_t end)
+{
+    record(name, 'X', begin, end - begin);
+}
+
+void Tracing::counter(const char *name, int64_t value)
+{
+    record(name, 'C', now(), value);
+}
+
+void Tracing::setThreadName(const std::string &name)
+{
+    uint32_t tid = thread_slot().tid;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mutex);
+    r.threadNames.emplace_back(tid, name);
+}
+
+bool Tracing::dump(const std::string &filename)
+{
+    //先复制出来再写文件，写入线程只被阻塞一次拷贝的时间
+    std::vector<TraceEvent> events;
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> locker(r.mutex);
+        for (auto &buffer : r.buffers) {
+            buffer->lock.lock();
+            uint64_t count = std::min<uint64_t>(buffer->written, BufferEvents);
+            for (uint64_t i = buffer->written - count; i < buffer->written; i++)
+                events.push_back(buffer->events[i % BufferEvents]);
+            buffer->lock.unlock();
+        }
+        threadNames = r.threadNames;
+    }
+
+    FILE *file = std::fopen(filename.c_str(), "w");
+    if (!file) return false;
+
+    //时间戳以最早的事件为零点，单位为微秒
+    int64_t origin = 0;
+    for (size_t i = 0; i < events.size(); i++)
+        if (i == 0 || events[i].begin < origin) origin = events[i].begin;
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto &thread : threadNames) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                     first ? "" : ",\n", thread.first);
+        write_string(file, thread.second.c_str());
+        std::fprintf(file, "}}");
+        first = false;
+    }
+    for (const TraceEvent &event : events) {
+        std::fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+        write_string(file, event.name);
+        if (event.phase == 'X') {
+            std::fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.tid, (event.begin - origin) / 1000.0, event.value / 1000.0);
+        } else {
+            std::fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+                         event.tid, (event.begin - origin) / 1000.0, static_cast<long long>(event.value));
+        }
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+
+    bool success = std::ferror(file) == 0;
+    std::fclose(file);
+
+    return success;
+}
+
+void Tracing::clear()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> locker(r.mutex);
+    for (auto &buffer : r.buffers) {
+        buffer->lock.lock();
+        buffer->written = 0;
+        buffer->lock.unlock();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Tracing
+ * @note 热路径追踪：每个线程写自己的环形缓冲(满了覆盖最旧的事件)，写入时不与其他线程竞争
+ *       dump() 导出 Chrome trace JSON，可以直接拖进 Perfetto(ui.perfetto.dev) 或 chrome://tracing
+ *       只有定义了 ENABLE_TRACING(qmake CONFIG+=tracing)时 TRACE_* 宏才生效，否则展开为空，没有任何开销
+ */
+class Tracing
+{
+public:
+    //每个线程缓冲的事件数
+    static const int BufferEvents = 1 << 16;
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    //运行时开关，关闭时记录函数只检查一次原子变量
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    //name 必须是静态字符串(只保存指针)
+    static void complete(const char *name, int64_t begin, int64_t end);
+    static void counter(const char *name, int64_t value);
+    static void setThreadName(const std::string &name);
+
+    /**
+     * @brief dump
+     * @note 写出所有线程(包括已退出的线程)缓冲中的事件，可以在任意线程、任意时刻调用
+     */
+    static bool dump(const std::string &filename);
+    static void clear();
+};
+
+/**
+ * @brief TraceScope
+ * @note 构造到析构之间记为一个完整事件，name 为 nullptr 时不记录
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : m_name(name && Tracing::isEnabled() ? name : nullptr), m_begin(m_name ? Tracing::now() : 0) { }
+    ~TraceScope() {
+        if (m_name) Tracing::complete(m_name, m_begin, Tracing::now());
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    int64_t m_begin;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_TRACING
+//记录当前作用域
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+//condition 成立时才记录当前作用域(如只记录真正阻塞的等待)
+#define TRACE_SCOPE_IF(condition, name) TraceScope TRACE_CONCAT(traceScope, __LINE__)((condition) ? (name) : nullptr)
+#define TRACE_COUNTER(name, value) Tracing::counter(name, int64_t(value))
+#define TRACE_THREAD_NAME(name) Tracing::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) do { } while (0)
+#define TRACE_SCOPE_IF(condition, name) do { } while (0)
+#define TRACE_COUNTER(name, value) do { } while (0)
+#define TRACE_THREAD_NAME(name) do { } while (0)
+#endif
+
+#endif // TRACING_H
@@ -1,11 +1,37 @@
 #include "mainwindow.h"
+#include "metrics.h"
+#include "paintbenchmark.h"
 #include <QApplication>
 
+//用法: VideoTest [--format rgb888|rgb32|argb32pm] [--paint-benchmark] [文件]，不带文件时拖入播放
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
+    //METRICS_INTERVAL=秒 时打开运行指标，定期输出到 stderr(video.paint 为每帧画图的耗时)
+    MetricsReporter metrics;
+    metrics.startFromEnvironment();
+
+    QStringList arguments = QApplication::arguments();
+    QString filename;
+    QImage::Format format = QImage::Format_RGB32;
+
+    for (int i = 1; i < arguments.size(); i++) {
+        if (arguments.at(i) == "--paint-benchmark") {
+            return runPaintBenchmark();
+        } else if (arguments.at(i) == "--format" && i + 1 < arguments.size()) {
+            QString name = arguments.at(++i);
+            if (name == "rgb888") format = QImage::Format_RGB888;
+            else if (name == "argb32pm") format = QImage::Format_ARGB32_Premultiplied;
+            else format = QImage::Format_RGB32;
+        } else {
+            filename = arguments.at(i);
+        }
+    }
+
     MainWindow window;
+    window.setFrameFormat(format);
     window.show();
+    if (!filename.isEmpty()) window.open(filename);
 
     return app.exec();
 }
@@ -1,27 +1,49 @@
 #include "mainwindow.h"
+#include "imageconverter.h"
+#include "mediapipeline.h"
+#include "metrics.h"
+#include "mpmcqueue.h"
+#include "tracing.h"
 
 extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
-#include <libavutil/imgutils.h>
-#include <libswscale/swscale.h>
 }
 
 #include <QApplication>
+#include <QDateTime>
 #include <QDropEvent>
 #include <QHBoxLayout>
 #include <QMimeData>
 #include <QPushButton>
 #include <QPainter>
 #include <QScreen>
+#include <QShortcut>
 #include <QTimer>
 #include <QDebug>
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace
+{
+
+//转换完成的帧，由工作线程交回解码线程
+struct ConvertedFrame
+{
+    uint64_t index = 0;
+    QImage image;
+};
+
+} //namespace
+
 VideoDecoder::VideoDecoder(QObject *parent)
     : QThread (parent)
+    , m_convertPool(std::max(1, std::min(4, QThread::idealThreadCount())))
 {
-
+    m_frameQueue.monitor().setMetricsName("video.frames");
 }
 
 VideoDecoder::~VideoDecoder()
@@ -37,12 +59,16 @@ void VideoDecoder::stop()
     wait();
 }
 
-void VideoDecoder::open(const QString &filename)
+void VideoDecoder::open(const QString &filename, QImage::Format format)
 {
     stop();
 
+    if (format != QImage::Format_RGB888 && format != QImage::Format_ARGB32_Premultiplied)
+        format = QImage::Format_RGB32;
+
     m_mutex.lock();
     m_filename = filename;
+    m_format = format;
     m_runnable = true;
     m_mutex.unlock();
 
@@ -59,110 +85,107 @@ QImage VideoDecoder::currentFrame()
 
 void VideoDecoder::run()
 {
+    TRACE_THREAD_NAME("VideoDecoder");
     demuxing_decoding();
 }
 
 void VideoDecoder::demuxing_decoding()
 {
-    AVFormatContext *formatContext = nullptr;
-    AVCodecContext *codecContext = nullptr;
-    AVCodec *videoDecoder = nullptr;
+    MediaSource source;
+    StreamDecoder decoder;
+    MediaPipeline pipeline;
     AVStream *videoStream = nullptr;
     int videoIndex = -1;
 
     //打开输入文件，并分配格式上下文
-    avformat_open_input(&formatContext, m_filename.toStdString().c_str(), nullptr, nullptr);
-    avformat_find_stream_info(formatContext, nullptr);
-
-    //找到视频流的索引
-    videoIndex = av_find_best_stream(formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
-
-    if (videoIndex < 0) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    videoStream = formatContext->streams[videoIndex];
-
-    if (!videoStream) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    videoDecoder = avcodec_find_decoder(videoStream->codecpar->codec_id);
+    decoder.setMetricsName("video.decoder");
 
-    if (!videoDecoder) {
+    if (!source.open(m_filename.toStdString())) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    codecContext = avcodec_alloc_context3(videoDecoder);
 
-    if (!codecContext) {
+    //找到视频流的索引，并打开解码器
+    videoIndex = source.findStream(AVMEDIA_TYPE_VIDEO);
+    videoStream = source.stream(videoIndex);
+    if (!decoder.open(videoStream)) {
         qDebug() << "Has Error: line =" << __LINE__;
         return;
     }
-    avcodec_parameters_to_context(codecContext, videoStream->codecpar);
-
-    if (!codecContext) {
-        qDebug() << "Has Error: line =" << __LINE__;
-        return;
-    }
-    avcodec_open2(codecContext, videoDecoder, nullptr);
 
     //打印相关信息
-    av_dump_format(formatContext, 0, "format", 0);
-    fflush(stderr);
+    source.dump();
 
-    m_fps = videoStream->avg_frame_rate.num / videoStream->avg_frame_rate.den;
-    m_width = codecContext->width;
-    m_height = codecContext->height;
+    m_fps = videoStream->avg_frame_rate.num > 0 ? qRound(av_q2d(videoStream->avg_frame_rate)) : 25;
+    m_width = decoder.context()->width;
+    m_height = decoder.context()->height;
 
     emit resolved();
 
-    SwsContext *swsContext = sws_getContext(m_width, m_height, codecContext->pix_fmt, m_width, m_height, AV_PIX_FMT_RGB24,
-                                            SWS_BILINEAR, nullptr, nullptr, nullptr);
-    //分配并初始化一个临时的帧和包
-    AVPacket *packet = av_packet_alloc();
-    AVFrame *frame = av_frame_alloc();
-    packet->data = nullptr;
-    packet->size = 0;
-
-    //读取下一帧
-    while (m_runnable && av_read_frame(formatContext, packet) >= 0) {
-
-        if (packet->stream_index == videoIndex) {
-            //发送给解码器
-            int ret = avcodec_send_packet(codecContext, packet);
-
-            while (ret >= 0) {
-                //从解码器接收解码后的帧
-                ret = avcodec_receive_frame(codecContext, frame);
-
-                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) break;
-                else if (ret < 0) goto Run_End;
-
-                int dst_linesize[4];
-                uint8_t *dst_data[4];
-                av_image_alloc(dst_data, dst_linesize, m_width, m_height, AV_PIX_FMT_RGB24, 1);
-                sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
-                QImage image = QImage(dst_data[0], m_width, m_height, QImage::Format_RGB888).copy();
-                av_freep(&dst_data[0]);
+    //QImage 的 32 位格式为本机字节序的 0xAARRGGBB，即 AV_PIX_FMT_RGB32；视频不透明，alpha 为 255 时预乘与否相同
+    const QImage::Format format = m_format;
+    const AVPixelFormat pixelFormat = format == QImage::Format_RGB888 ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_RGB32;
+
+    //RGB转换交给专用线程池，解码线程只复制帧的引用；每个工作线程独占一个 ImageConverter(SwsContext 不能共享)
+    ThreadPool &pool = m_convertPool;
+    std::vector<std::unique_ptr<ImageConverter>> converters;
+    for (int i = 0; i < pool.threadCount(); i++) converters.emplace_back(new ImageConverter);
+    //在途的转换任务数有上限，超过时解码线程先等结果，也限制了暂存的乱序帧
+    const int maxPending = pool.threadCount() * 2;
+    //工作线程把结果交回解码线程(多生产者)，容量不小于在途数，工作线程不会阻塞
+    MpmcQueue<ConvertedFrame> converted(maxPending);
+    TaskGroup tasks(pool);
+    int pending = 0;
+    bool failed = false;
+    uint64_t sequence = 0;
+    //转换完成的先后不定，按解码顺序放入帧队列；只有解码线程会阻塞在帧队列上
+    OrderedOutput<QImage> output([&](QImage &image) {
+        if (image.isNull()) failed = true;
+        else if (m_runnable) m_frameQueue.enqueue(image);
+    });
+    auto collect = [&](ConvertedFrame frame) {
+        pending--;
+        output.push(frame.index, frame.image);
+    };
+
+    pipeline.addDecoder(&decoder);
+    pipeline.addStage(videoIndex, [&](AVFrame *frame) {
+        ConvertedFrame done;
+        while (converted.tryDequeue(done)) collect(done);
+        while (pending >= maxPending) collect(converted.dequeue());
+
+        std::shared_ptr<AVFrame> ref(av_frame_clone(frame), AVFrameDeleter());
+        if (failed || !ref) {
+            pipeline.stop(AVERROR(EINVAL));
+            return false;
+        }
 
-                m_frameQueue.enqueue(image);
+        pending++;
+        uint64_t index = sequence++;
+        tasks.submit([&, ref, index]() {
+            //直接写入QImage的缓冲避免额外拷贝，SwsContext 在各帧之间复用
+            ConvertedFrame result;
+            result.index = index;
+            result.image = QImage(m_width, m_height, format);
+            uint8_t *dst_data[4] = { result.image.bits(), nullptr, nullptr, nullptr };
+            int dst_linesize[4] = { result.image.bytesPerLine(), 0, 0, 0 };
+            ImageConverter &converter = *converters[pool.currentWorker()];
+            if (!converter.convert(ref.get(), m_width, m_height, pixelFormat, dst_data, dst_linesize))
+                result.image = QImage();
+
+            converted.enqueue(result);
+        });
+        return true;
+    });
 
-                av_frame_unref(frame);
-            }
-        }
+    if (pipeline.run(source, m_runnable) < 0)
+        qDebug() << "Has Error: line =" << __LINE__;
 
-        av_packet_unref(packet);
-    }
+    //输出剩下的帧；任务引用了这里的局部变量，本组全部完成后才能返回
+    while (pending > 0) collect(converted.dequeue());
+    tasks.wait();
 
-Run_End:
     m_fps = m_width = m_height = 0;
-
-    if (frame) av_frame_free(&frame);
-    if (packet) av_packet_free(&packet);
-    if (swsContext) sws_freeContext(swsContext);
-    if (codecContext) avcodec_free_context(&codecContext);
-    if (formatContext) avformat_close_input(&formatContext);
 }
 
 MainWindow::MainWindow(QWidget *parent)
@@ -172,6 +195,17 @@ MainWindow::MainWindow(QWidget *parent)
     setGeometry(size.width(), size.height(), 600, 500);
     setAcceptDrops(true);
 
+#ifdef ENABLE_TRACING
+    //F12 导出追踪数据(Chrome trace JSON)，拖进 Perfetto 查看
+    QShortcut *traceShortcut = new QShortcut(QKeySequence(Qt::Key_F12), this);
+    connect(traceShortcut, &QShortcut::activated, this, []() {
+        QString filename = QDateTime::currentDateTime().toString("'trace_'yyyyMMdd_hhmmss'.json'");
+        qDebug() << "[Trace:" << filename << (Tracing::dump(filename.toStdString()) ? "]" : "failed]");
+    });
+#endif
+    TRACE_THREAD_NAME("GUI");
+    m_paintTime = Metrics::histogram("video.paint");
+
     QWidget *widget = new QWidget(this);
     widget->setFixedSize(200, 50);
     QHBoxLayout *layout = new QHBoxLayout(widget);
@@ -208,13 +242,23 @@ MainWindow::~MainWindow()
 
 }
 
+void MainWindow::open(const QString &filename)
+{
+    m_timer->stop();
+    m_decoder->open(filename, m_frameFormat);
+}
+
 void MainWindow::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
+    TRACE_SCOPE("paint");
     QPainter painter(this);
-    if (!m_currentFrame.isNull())
+    if (!m_currentFrame.isNull()) {
+        //格式与后备缓冲不同时，drawImage 内部要先逐行转换，这部分耗时都在 GUI 线程
+        int64_t begin = Metrics::isEnabled() ? Metrics::now() : 0;
         painter.drawImage(rect(), m_currentFrame);
-    else {
+        if (begin) m_paintTime->record(Metrics::now() - begin);
+    } else {
         QString text("<请拖入视频>");
         QFont f = font();
         f.setPointSize(20);
@@ -236,7 +280,7 @@ void MainWindow::dropEvent(QDropEvent *event)
     const QMimeData *mimeData = event->mimeData();
     if(mimeData->hasUrls()) {
         QList<QUrl> urlList = mimeData->urls();
-        m_decoder->open(urlList[0].toLocalFile());
+        open(urlList[0].toLocalFile());
     }
 }
 
@@ -1,13 +1,17 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include "bufferqueue.h"
+#include "meteredqueue.h"
+#include "threadpool.h"
 
+#include <QImage>
 #include <QMainWindow>
 #include <QMutex>
 #include <QQueue>
 #include <QThread>
 
+#include <atomic>
+
 class VideoDecoder : public QThread
 {
     Q_OBJECT
@@ -17,7 +21,12 @@ public:
     ~VideoDecoder();
 
     void stop();
-    void open(const QString &filename);
+    /**
+     * @brief open
+     * @param format 输出帧的格式：Format_RGB32 / Format_ARGB32_Premultiplied 与窗口的后备缓冲相同，
+     *        drawImage 时不需要逐帧转换；Format_RGB888 为原来的格式，用于对比，其他格式按 Format_RGB32 处理
+     */
+    void open(const QString &filename, QImage::Format format = QImage::Format_RGB32);
 
     int fps() const { return m_fps; }
     int width() const { return m_width; }
@@ -34,13 +43,17 @@ protected:
 private:
     void demuxing_decoding();
 
-    bool m_runnable = true;
+    std::atomic_bool m_runnable { true };
     QMutex m_mutex;
     QString m_filename;
-    BufferQueue<QImage> m_frameQueue;
+    MeteredBufferQueue<QImage> m_frameQueue;
+    //RGB 转换专用的线程池：不与 ThreadPool::instance() 的其他用户互相阻塞
+    ThreadPool m_convertPool;
+    QImage::Format m_format = QImage::Format_RGB32;
     int m_fps, m_width, m_height;
 };
 
+class Histogram;
 class QPushButton;
 class MainWindow : public QMainWindow
 {
@@ -50,6 +63,10 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    //之后打开的视频使用的帧格式
+    void setFrameFormat(QImage::Format format) { m_frameFormat = format; }
+    void open(const QString &filename);
+
 signals:
     void needUpdate();
 
@@ -61,6 +78,9 @@ protected:
 private:
     QTimer *m_timer;
     QImage m_currentFrame;
+    QImage::Format m_frameFormat = QImage::Format_RGB32;
+    //video.paint：每帧 drawImage 的耗时
+    Histogram *m_paintTime;
     VideoDecoder *m_decoder;
     QPushButton *m_suspendButton;
     QPushButton *m_resumeButton;
@@ -0,0 +1,87 @@
+#include "paintbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+
+#include <cstdio>
+
+namespace
+{
+
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int FRAMES = 40;
+const int ROUNDS = 5;
+
+struct PaintFormat
+{
+    const char *name;
+    QImage::Format format;
+};
+
+const PaintFormat FORMATS[] = {
+    { "RGB888", QImage::Format_RGB888 },
+    { "RGB32", QImage::Format_RGB32 },
+    { "ARGB32_Premultiplied", QImage::Format_ARGB32_Premultiplied }
+};
+
+//先生成 RGB888 再转换，各个格式的内容相同
+QImage make_frame(QImage::Format format)
+{
+    QImage image(WIDTH, HEIGHT, QImage::Format_RGB888);
+    for (int y = 0; y < HEIGHT; y++) {
+        uchar *line = image.scanLine(y);
+        for (int x = 0; x < WIDTH; x++) {
+            line[x * 3] = uchar(x + y);
+            line[x * 3 + 1] = uchar(x * 2 - y);
+            line[x * 3 + 2] = uchar(y * 3);
+        }
+    }
+
+    return format == QImage::Format_RGB888 ? image : image.convertToFormat(format);
+}
+
+//与 paintEvent 相同，每帧新建 QPainter 画满目标，返回最快一轮中每帧的毫秒数
+double paint(const QImage &frame, QImage &target)
+{
+    double best = 0.0;
+    for (int round = 0; round < ROUNDS; round++) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < FRAMES; i++) {
+            QPainter painter(&target);
+            painter.drawImage(target.rect(), frame);
+        }
+        double ms = timer.nsecsElapsed() / 1e6 / FRAMES;
+        if (round == 0 || ms < best) best = ms;
+    }
+
+    return best;
+}
+
+} //namespace
+
+int runPaintBenchmark()
+{
+    //光栅窗口的后备缓冲一般为 ARGB32_Premultiplied；窗口与视频同样大小，以及缩小到 720p 两种情况
+    const QSize targets[] = { QSize(WIDTH, HEIGHT), QSize(1280, 720) };
+
+    std::printf("==== Paint %dx%d frame (QPainter::drawImage onto ARGB32_Premultiplied) ====\n", WIDTH, HEIGHT);
+    for (const QSize &size : targets) {
+        QImage backingStore(size, QImage::Format_ARGB32_Premultiplied);
+        backingStore.fill(Qt::black);
+
+        char target[32];
+        std::snprintf(target, sizeof(target), "-> %dx%d", size.width(), size.height());
+        double baseline = 0.0;
+        for (const PaintFormat &format : FORMATS) {
+            double ms = paint(make_frame(format.format), backingStore);
+            if (format.format == QImage::Format_RGB888) baseline = ms;
+            std::printf("%-14s %-22s %8.3f ms / frame  x%.2f\n", target, format.name, ms, baseline / ms);
+        }
+    }
+    std::fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef PAINTBENCHMARK_H
+#define PAINTBENCHMARK_H
+
+/**
+ * @brief runPaintBenchmark
+ * @note 与 MainWindow::paintEvent 相同地用 QPainter::drawImage 把 1080p 帧画到后备缓冲格式的图像上，
+ *       对比解码器输出 Format_RGB888 / Format_RGB32 / Format_ARGB32_Premultiplied 时 GUI 线程每帧的耗时
+ * @return 进程的退出码
+ */
+int runPaintBenchmark();
+
+#endif // PAINTBENCHMARK_H